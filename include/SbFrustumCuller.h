@@ -0,0 +1,206 @@
+#ifndef SB_FRUSTUM_CULLER_H
+#define SB_FRUSTUM_CULLER_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Hierarchical view frustum culling of a quadtree.
+/// \file SbFrustumCuller.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// Bounding boxes of the tiles of a terrain quadtree are nested, so a tile
+/// completely inside of a plane of the view volume has all its descendants
+/// inside of it too. The ::SbFrustumCuller class tests boxes only against the
+/// planes not containing their parents and starts with the plane which
+/// rejected the box in the previous frame.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbLinear.h>
+#include <Inventor/SbBox.h>
+
+/** Hierarchical view frustum culler of a quadtree.
+Classifies axis aligned boxes of the nodes of a tree against the six planes
+of the view volume. Culling flags of a node have bits 0 to 5 set for planes
+which contain the box completely, ::CULL_IN marks the box completely inside
+of the view volume and ::CULL_OUT completely outside of some plane. Flags of
+a parent are passed to its children, so planes containing the parent are not
+tested again. For every node the plane which rejected it last is remembered
+and tested first, as it most likely rejects the node again. */
+class SbFrustumCuller
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates a culler of a tree without nodes. */
+    SbFrustumCuller();
+    /** Destructor.
+    Releases the remembered planes of the nodes. */
+    ~SbFrustumCuller();
+    /** Sets number of nodes.
+    Allocates the remembered planes of \p count nodes of the tree.
+    \param count Number of nodes of the tree. */
+    void setNodeCount(const int count);
+    /** Sets view volume.
+    Takes the planes of the view volume \p view_volume.
+    \param view_volume View volume of the current frame. */
+    void setViewVolume(const SbViewVolume & view_volume);
+    /** Computes culling flags of a box.
+    Tests the box of the node \p node against the planes of the view volume
+    which are not marked as containing the box in \p flags yet.
+    \param node Index of the node in the tree.
+    \param flags Flags inherited from the parent of the node.
+    \param min_x Minimal x coordinate of the box.
+    \param min_y Minimal y coordinate of the box.
+    \param min_z Minimal z coordinate of the box.
+    \param max_x Maximal x coordinate of the box.
+    \param max_y Maximal y coordinate of the box.
+    \param max_z Maximal z coordinate of the box.
+    \return Culling flags of the node. */
+    inline int cull(const int node, int flags, const float min_x,
+      const float min_y, const float min_z, const float max_x,
+      const float max_y, const float max_z);
+    /** Computes culling flags of a box.
+    \param node Index of the node in the tree.
+    \param flags Flags inherited from the parent of the node.
+    \param box Bounding box of the node.
+    \return Culling flags of the node. */
+    inline int cull(const int node, const int flags, const SbBox3f & box);
+    /** Resets number of tests.
+    Called at the beginning of every frame. */
+    void resetTestCount();
+    /** Returns number of tests.
+    \return Number of box-plane tests since the last reset. */
+    int getTestCount() const;
+    /* Data members. */
+    /// Culling flags of a box completely inside of the view volume.
+    static const int CULL_IN;
+    /// Culling flag of a box completely outside of the view volume.
+    static const int CULL_OUT;
+  private:
+    /* Methods. */
+    /** Tests a box against a plane.
+    \param plane Index of the plane.
+    \param min_x Minimal x coordinate of the box.
+    \param min_y Minimal y coordinate of the box.
+    \param min_z Minimal z coordinate of the box.
+    \param max_x Maximal x coordinate of the box.
+    \param max_y Maximal y coordinate of the box.
+    \param max_z Maximal z coordinate of the box.
+    \return -1 for the box outside of the plane, 1 for the box inside of it
+    and 0 for the box intersecting it. */
+    inline int testPlane(const int plane, const float min_x,
+      const float min_y, const float min_z, const float max_x,
+      const float max_y, const float max_z);
+    /* Data members. */
+    /// Components of the normals of the planes pointing inside.
+    float normals[6][3];
+    /// Distances of the planes from the origin.
+    float distances[6];
+    /// Plane which rejected every node last.
+    unsigned char * last_planes;
+    /// Number of nodes.
+    int node_count;
+    /// Number of box-plane tests since the last reset.
+    int test_count;
+};
+
+/******************************************************************************
+* SbFrustumCuller - public
+******************************************************************************/
+
+inline int SbFrustumCuller::cull(const int node, int flags, const float min_x,
+  const float min_y, const float min_z, const float max_x, const float max_y,
+  const float max_z)
+{
+  /* The plane which rejected the node last is tested first. */
+  int last_plane = last_planes[node];
+  int mask = 1 << last_plane;
+  if (!(flags & mask))
+  {
+    int result = testPlane(last_plane, min_x, min_y, min_z, max_x, max_y,
+      max_z);
+    if (result < 0)
+    {
+      return CULL_OUT;
+    }
+    if (result > 0)
+    {
+      flags |= mask;
+    }
+  }
+
+  /* Only planes which do not contain the box of the parent are tested. */
+  mask = 0x01;
+  for (int I = 0; I < 6; ++I, mask <<= 1)
+  {
+    if (!(flags & mask) && (I != last_plane))
+    {
+      int result = testPlane(I, min_x, min_y, min_z, max_x, max_y, max_z);
+      if (result < 0)
+      {
+        last_planes[node] = static_cast<unsigned char>(I);
+        return CULL_OUT;
+      }
+      if (result > 0)
+      {
+        flags |= mask;
+      }
+    }
+  }
+  return flags;
+}
+
+inline int SbFrustumCuller::cull(const int node, const int flags,
+  const SbBox3f & box)
+{
+  const SbVec3f & min = box.getMin();
+  const SbVec3f & max = box.getMax();
+  return cull(node, flags, min[0], min[1], min[2], max[0], max[1], max[2]);
+}
+
+/******************************************************************************
+* SbFrustumCuller - private
+******************************************************************************/
+
+inline int SbFrustumCuller::testPlane(const int plane, const float min_x,
+  const float min_y, const float min_z, const float max_x, const float max_y,
+  const float max_z)
+{
+  ++test_count;
+
+  /* The box is outside if its corner farthest along the normal is outside
+  and inside if its nearest corner is inside. */
+  const float * normal = normals[plane];
+  float far_distance = (normal[0] * ((normal[0] >= 0.0f) ? max_x : min_x)) +
+    (normal[1] * ((normal[1] >= 0.0f) ? max_y : min_y)) +
+    (normal[2] * ((normal[2] >= 0.0f) ? max_z : min_z)) - distances[plane];
+  if (far_distance < 0.0f)
+  {
+    return -1;
+  }
+  float near_distance = (normal[0] * ((normal[0] >= 0.0f) ? min_x : max_x)) +
+    (normal[1] * ((normal[1] >= 0.0f) ? min_y : max_y)) +
+    (normal[2] * ((normal[2] >= 0.0f) ? min_z : max_z)) - distances[plane];
+  return (near_distance >= 0.0f) ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef SB_GL_VERTEX_BUFFER_H
+#define SB_GL_VERTEX_BUFFER_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Vertex buffer of a height map.
+/// \file SbGLVertexBuffer.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// Vertices of the height map do not change during rendering, only the
+/// triangulation does. The ::SbGLVertexBuffer class keeps the coordinates,
+/// normals and texture coordinates of the map in a vertex buffer object, so
+/// the terrain algorithms can draw their triangulation with indexed calls.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbLinear.h>
+#include <Inventor/system/inttypes.h>
+
+// OpenGL includes
+#if defined(__WIN32__) || defined(_WIN32)
+  #include <windows.h>
+#endif
+#include <GL/gl.h>
+
+/** Vertex buffer of a height map.
+Holds pointers to the vertex arrays of a height map and binds them as OpenGL
+vertex arrays. If the OpenGL context supports vertex buffer objects, the
+arrays are uploaded to one buffer object in the first ::SbGLVertexBuffer::bind
+call for the context, otherwise client side arrays are used. The arrays have
+to stay valid while the buffer is used, changes of the coordinates have to be
+uploaded by ::SbGLVertexBuffer::updateCoords. */
+class SbGLVertexBuffer
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates an empty buffer. */
+    SbGLVertexBuffer();
+    /** Destructor.
+    Schedules deletion of the buffer object in its OpenGL context. */
+    ~SbGLVertexBuffer();
+    /** Sets vertex arrays.
+    Sets arrays of \p count vertices. The buffer object is uploaded again
+    in the next ::SbGLVertexBuffer::bind call.
+    \param coords Coordinates of the vertices.
+    \param normals Normals of the vertices, can be \p NULL.
+    \param texture_coords Texture coordinates of the vertices, can be
+    \p NULL.
+    \param count Number of vertices. */
+    void setArrays(const SbVec3f * coords, const SbVec3f * normals,
+      const SbVec2f * texture_coords, const int count);
+    /** Sets coordinates.
+    Replaces the coordinates of the vertices by the array \p coords of the
+    same size. The buffer object is uploaded again in the next
+    ::SbGLVertexBuffer::bind call with the \p GL_DYNAMIC_DRAW usage, as the
+    replaced coordinates are expected to be updated.
+    \param coords Coordinates of the vertices. */
+    void setCoords(const SbVec3f * coords);
+    /** Updates coordinates.
+    Uploads \p count changed coordinates from the vertex \p first to the
+    buffer object. Client side arrays and buffer objects which are going to
+    be uploaded again are not touched.
+    \param context_id Identifier of the current OpenGL context.
+    \param first Index of the first changed vertex.
+    \param count Number of the changed vertices. */
+    void updateCoords(const uint32_t context_id, const int first,
+      const int count);
+    /** Binds vertex arrays.
+    Enables the vertex array and, if requested and available, the normal
+    and texture coordinate arrays. Client array state is pushed and has to
+    be restored by ::SbGLVertexBuffer::unbind.
+    \param context_id Identifier of the current OpenGL context.
+    \param is_normals Use normals of the vertices.
+    \param is_texture Use texture coordinates of the vertices. */
+    void bind(const uint32_t context_id, const SbBool is_normals,
+      const SbBool is_texture);
+    /** Unbinds vertex arrays.
+    Restores client array state saved by ::SbGLVertexBuffer::bind. */
+    void unbind();
+    /** Returns whether a buffer object is used.
+    \return \p TRUE if the arrays are in a vertex buffer object. */
+    SbBool isBufferObject() const;
+  private:
+    /* Methods. */
+    /** Uploads the arrays.
+    Creates the buffer object in the context \p context_id and fills it
+    with the arrays. */
+    void upload(const uint32_t context_id);
+    /** Deletes a buffer object.
+    Called by Coin when the OpenGL context of the buffer is current.
+    \param closure Name of the buffer object stored in the pointer.
+    \param context_id Identifier of the OpenGL context. */
+    static void deleteBufferCB(void * closure, uint32_t context_id);
+    /* Data members. */
+    /// Coordinates of the vertices.
+    const SbVec3f * coords;
+    /// Normals of the vertices.
+    const SbVec3f * normals;
+    /// Texture coordinates of the vertices.
+    const SbVec2f * texture_coords;
+    /// Number of vertices.
+    int count;
+    /// Name of the buffer object, 0 if there is none.
+    GLuint buffer;
+    /// OpenGL context of the buffer object.
+    uint32_t context_id;
+    /// Flag of changed arrays.
+    SbBool is_dirty;
+    /// Flag of coordinates updated by ::SbGLVertexBuffer::updateCoords.
+    SbBool is_dynamic;
+    /// Flag of usage of the buffer object in the bound state.
+    SbBool is_bound_buffer;
+};
+
+#endif
@@ -0,0 +1,121 @@
+#ifndef SB_HORIZON_CULLER_H
+#define SB_HORIZON_CULLER_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Horizon occlusion culling of a height map.
+/// \file SbHorizonCuller.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// A height map seen from a low camera hides most of the terrain behind its
+/// nearest ridges. The ::SbHorizonCuller class keeps the horizon formed by
+/// the tiles drawn so far and tests bounding boxes of the following tiles
+/// against it, so tiles processed front to back are culled on the CPU
+/// without any occlusion queries.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbLinear.h>
+#include <Inventor/SbBox.h>
+
+/** Horizon occlusion culler of a height map.
+The horizon buffer has ::RESOLUTION columns of azimuth around the camera
+and stores for every column the slope of the lowest ray which is not hidden
+by the terrain yet. The terrain is a height field with the z axis up, so
+every tile hides the rays passing below its minimal height over its area.
+Only columns completely covered by a tile are raised by it. A box is
+occluded if its highest point is below the horizon in all columns it covers.
+This is valid only if boxes are tested and added in front to back order,
+which can be obtained by the quadtree traversal of ::getChildOrder. */
+class SbHorizonCuller
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates a culler with an empty horizon. */
+    SbHorizonCuller();
+    /** Destructor.
+    Releases the horizon buffer. */
+    ~SbHorizonCuller();
+    /** Resets horizon.
+    Clears the horizon buffer for the camera at the position \p eye. Called
+    at the beginning of every frame.
+    \param eye Position of the camera. */
+    void reset(const SbVec3f & eye);
+    /** Tests a box against the horizon.
+    \param min_x Minimal x coordinate of the box.
+    \param min_y Minimal y coordinate of the box.
+    \param max_x Maximal x coordinate of the box.
+    \param max_y Maximal y coordinate of the box.
+    \param max_z Maximal z coordinate of the box.
+    \return \p TRUE if the box is completely hidden behind the horizon. */
+    SbBool isOccluded(const float min_x, const float min_y, const float max_x,
+      const float max_y, const float max_z) const;
+    /** Tests a box against the horizon.
+    \param box Tested box.
+    \return \p TRUE if the box is completely hidden behind the horizon. */
+    SbBool isOccluded(const SbBox3f & box) const;
+    /** Adds a tile to the horizon.
+    Raises the horizon by the terrain below the minimal height of a drawn
+    tile.
+    \param min_x Minimal x coordinate of the tile.
+    \param min_y Minimal y coordinate of the tile.
+    \param min_z Minimal z coordinate of the tile.
+    \param max_x Maximal x coordinate of the tile.
+    \param max_y Maximal y coordinate of the tile. */
+    void addOccluder(const float min_x, const float min_y, const float min_z,
+      const float max_x, const float max_y);
+    /** Adds a tile to the horizon.
+    \param box Bounding box of the tile. */
+    void addOccluder(const SbBox3f & box);
+    /** Returns front to back order of quadtree children.
+    Orders four children of a quadtree node so that every ray from the
+    camera passes them in this order.
+    \param boxes Bounding boxes of the children.
+    \param order Indices of the children from the nearest one. */
+    void getChildOrder(const SbBox3f * boxes, int order[4]) const;
+    /* Data members. */
+    /// Number of columns of the horizon buffer.
+    static const int RESOLUTION;
+  private:
+    /* Methods. */
+    /** Computes columns and distances of a rectangle.
+    \param min_x Minimal x coordinate of the rectangle.
+    \param min_y Minimal y coordinate of the rectangle.
+    \param max_x Maximal x coordinate of the rectangle.
+    \param max_y Maximal y coordinate of the rectangle.
+    \param first First azimuth of the rectangle in units of columns.
+    \param last Last azimuth of the rectangle in units of columns.
+    \param near_distance Horizontal distance of the nearest point.
+    \param far_distance Horizontal distance of the farthest point.
+    \return \p FALSE if the camera is above the rectangle. */
+    SbBool getColumns(const float min_x, const float min_y, const float max_x,
+      const float max_y, float & first, float & last, float & near_distance,
+      float & far_distance) const;
+    /* Data members. */
+    /// Slopes of the horizon in all columns.
+    float * horizon;
+    /// Position of the camera.
+    SbVec3f eye;
+};
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef SB_TASK_POOL_H
+#define SB_TASK_POOL_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Pool of worker threads.
+/// \file SbTaskPool.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// Preprocessing of the terrain algorithms consists of many independent
+/// tasks. The ::SbTaskPool class runs them on a set of worker threads built
+/// on the Coin threads abstraction.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/threads/SbThread.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbCondVar.h>
+
+/** Pool of worker threads.
+Tasks added by ::SbTaskPool::addTask are executed by the worker threads in
+the order of their addition. ::SbTaskPool::waitAll blocks until all added
+tasks are finished and executes the waiting tasks in the calling thread
+meanwhile. The calling thread is one of the threads of the pool, a pool
+with \p N threads starts \p N - 1 workers, a pool with one thread does
+not start any. */
+class SbTaskPool
+{
+  public:
+    /* Types. */
+    /// Function executed by a task.
+    typedef void SbTaskFunc(void * closure);
+    /* Methods. */
+    /** Constructor.
+    Creates a pool with \p thread_count threads including the calling one.
+    \param thread_count Number of threads, 0 means number of processors. */
+    SbTaskPool(const int thread_count = 0);
+    /** Destructor.
+    Waits for all tasks and stops the worker threads. */
+    ~SbTaskPool();
+    /** Adds a task.
+    The task calls the function \p func with the argument \p closure.
+    \param func Function of the task.
+    \param closure Argument of the function. */
+    void addTask(SbTaskFunc * func, void * closure);
+    /** Waits for all tasks.
+    Returns after all tasks added to the pool are finished. */
+    void waitAll();
+    /** Returns number of threads.
+    \return Number of threads executing the tasks. */
+    int getThreadCount() const;
+    /** Returns number of processors.
+    \return Number of processors available to the program, at least 1. */
+    static int getProcessorCount();
+  private:
+    /** Task of the pool. */
+    struct SbTask
+    {
+      /// Function of the task.
+      SbTaskFunc * func;
+      /// Argument of the function.
+      void * closure;
+    };
+    /* Methods. */
+    /** Main function of the worker threads.
+    \param pool Pointer to the ::SbTaskPool instance.
+    \return Always \p NULL. */
+    static void * workerMain(void * pool);
+    /** Executes a task.
+    Takes the next waiting task and executes it. Must be called with the
+    mutex locked, unlocks it during the execution.
+    \return \p FALSE if there was no waiting task. */
+    SbBool runTask();
+    /* Data members. */
+    /// Worker threads.
+    SbList<SbThread *> threads;
+    /// Added tasks.
+    SbList<SbTask> tasks;
+    /// Index of the next waiting task.
+    int next_task;
+    /// Number of unfinished tasks.
+    int pending_count;
+    /// Number of threads executing the tasks.
+    int thread_count;
+    /// Flag of the end of the worker threads.
+    SbBool is_exit;
+    /// Mutex of the tasks.
+    SbMutex mutex;
+    /// Condition of a new task or of the end.
+    SbCondVar task_cond;
+    /// Condition of finish of all tasks.
+    SbCondVar done_cond;
+};
+
+#endif
@@ -91,8 +91,8 @@ struct SbChunkedLoDTileTree
     /* Methods. */
     /** Constructor.
     Creates instance of ::SbChunkedLoDTileTree with given number of tiles
-    in tree \e tree_size and initializes tiles in this tree to have square of
-    \e tile_size number of vertex indices and default all other values.
+    in tree \e tree_size. Tiles have empty lists of vertex indices, which
+    are filled with square of \e tile_size indices by the preprocessing.
     \param tree_size Number of tiles in tile quad-tree.
     \param tile_size Size of tile side. Number of its vertex indices is equal
       to square of this value. */
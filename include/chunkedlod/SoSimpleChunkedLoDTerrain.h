@@ -54,6 +54,9 @@
 
 // Local includes.
 #include <chunkedlod/SbChunkedLoDPrimitives.h>
+#include <SbFrustumCuller.h>
+#include <SbHorizonCuller.h>
+#include <SbTaskPool.h>
 
 /** Terrain rendered by Chunked LoD algorithm.
 This is a scene graph node representing terrain rendered by Chunked LoD
@@ -87,6 +90,22 @@ class SoSimpleChunkedLoDTerrain : public SoShape
     SoSFBool frustumCulling;
     /// Flag of frozen algorithm.
     SoSFBool freeze;
+    /// Flag of culling of tiles hidden behind the horizon of nearer tiles.
+    SoSFBool occlusionCulling;
+    /// Number of threads of the preprocessing, 0 means number of processors.
+    SoSFInt32 threadCount;
+    /* Methods. */
+    /** Returns number of culling tests.
+    \return Number of box-plane tests of the frustum culling in the last
+    frame. */
+    int getCullTestCount() const;
+    /** Preprocesses the heightmap.
+    Builds the tile quad-tree of the heightmap \e coords on a pool of
+    \e threadCount threads. The first render calls it with the coordinates
+    of the scene graph, a direct call measures the preprocessing. The
+    sizes and the thread count are read from the fields.
+    \param coords Coordinates of the heightmap of the \e mapSize size. */
+    void preprocess(const SbVec3f * coords);
   protected:
     /* Methods. */
     /** Renders terrain.
@@ -146,6 +165,21 @@ class SoSimpleChunkedLoDTerrain : public SoShape
       instance.
     \param sensor Sensor which called this callback. */
     static void freezeChangedCB(void * instance, SoSensor * sensor);
+    /** Callback for change of SoSimpleChunkedLoDTerrain::occlusionCulling
+    field.
+    Sets internal value of SoSimpleChunkedLoDTerrain::occlusionCulling field
+    to new value when this fields has changed.
+    \param instance Pointer to affected ::SoSimpleChunkedLoDTerrain class
+      instance.
+    \param sensor Sensor which called this callback. */
+    static void occlusionCullingChangedCB(void * instance, SoSensor * sensor);
+    /** Callback for change of SoSimpleChunkedLoDTerrain::threadCount field.
+    Sets internal value of SoSimpleChunkedLoDTerrain::threadCount field to
+    new value when this fields has changed.
+    \param instance Pointer to affected ::SoSimpleChunkedLoDTerrain class
+      instance.
+    \param sensor Sensor which called this callback. */
+    static void threadCountChangedCB(void * instance, SoSensor * sensor);
     /* Elements shortcuts. */
     /// Coordinates of input heightmap.
     const SbVec3f * coords;
@@ -160,6 +194,10 @@ class SoSimpleChunkedLoDTerrain : public SoShape
     /* Internal data. */
     /// Tile quad-tree.
     SbChunkedLoDTileTree * tile_tree;
+    /// Hierarchical frustum culler of the tile quad-tree.
+    SbFrustumCuller frustum_culler;
+    /// Horizon occlusion culler of rendered tiles.
+    SbHorizonCuller horizon_culler;
     /// Distance constant for coumputing dynamic part of error metric.
     float distance_const;
     /// Flag that texture is pressent and should be rendered.
@@ -177,6 +215,10 @@ class SoSimpleChunkedLoDTerrain : public SoShape
     SbBool is_frustum_culling;
     /// Internal value of SoSimpleChunkedLoDTerrain::freeze field.
     SbBool is_freeze;
+    /// Internal value of SoSimpleChunkedLoDTerrain::occlusionCulling field.
+    SbBool is_occlusion_culling;
+    /// Internal value of SoSimpleChunkedLoDTerrain::threadCount field.
+    int thread_count;
     /* Sensors. */
     /// Sensor watching SoSimpleChunkedLoDTerrain::mapSize field changes.
     SoFieldSensor * map_size_sensor;
@@ -188,19 +230,51 @@ class SoSimpleChunkedLoDTerrain : public SoShape
     SoFieldSensor * frustum_culling_sensor;
     /// Sensor watching SoSimpleChunkedLoDTerrain::freeze field changes.
     SoFieldSensor * freeze_sensor;
+    /// Sensor watching SoSimpleChunkedLoDTerrain::occlusionCulling field
+    /// changes.
+    SoFieldSensor * occlusion_culling_sensor;
+    /// Sensor watching SoSimpleChunkedLoDTerrain::threadCount field changes.
+    SoFieldSensor * thread_count_sensor;
     /* Constants. */
     /// Constants for default pixel error of tile.
     static const int DEFAULT_PIXEL_ERROR;
   private:
+    /* Types. */
+    /** Task of the parallel preprocessing. */
+    struct SbChunkedLoDInitTask
+    {
+      /// Preprocessed terrain.
+      SoSimpleChunkedLoDTerrain * terrain;
+      /// Index of root tile of the initialised subtree.
+      int index;
+      /// Bounding rectangle of heightmap coordinates of the subtree.
+      SbBox2s coord_box;
+    };
     /* Methods. */
     /** Initialises tile quad-tree.
     Intializes tile quad-tree in recursive way starting with root or subroot
     tile on index \e index with coordinates of input heightmap bounded by
     \e coord_box rectangle. It parses tree bottom-up acctually but should be
-    called with \e index value setted to zero.
+    called with \e index value setted to zero. Subtrees \e depth levels below
+    the root tile are expected to be initialised by tasks already, negative
+    \e depth initialises whole tree.
     \param index Index of root tile, should be setted always to zero.
-    \param coord_box Bounding rectangle of input heightmap coordinates. */
-    SbBox3f initTree(const int index, SbBox2s coord_box);
+    \param coord_box Bounding rectangle of input heightmap coordinates.
+    \param depth Number of initialised levels below the root tile.
+    \return Bounding box of the subtree. */
+    SbBox3f initTree(const int index, SbBox2s coord_box, const int depth);
+    /** Collects tasks of the parallel preprocessing.
+    Appends a task for every subtree \e depth levels below the tile on index
+    \e index to \e tasks.
+    \param index Index of root tile of the subtrees.
+    \param coord_box Bounding rectangle of input heightmap coordinates.
+    \param depth Number of levels of the subtrees below the root tile.
+    \param tasks List of the tasks. */
+    void initTasks(const int index, SbBox2s coord_box, const int depth,
+      SbList<SbChunkedLoDInitTask> & tasks);
+    /** Initialises subtree of a task.
+    \param task Pointer to a ::SbChunkedLoDInitTask instance. */
+    static void initTask(void * task);
     /** Initialises quad-tree tile.
     Initialises quad-tree tile \e tile geometry, static part of error metric
     and bounding box. Parametr \e index is index of tile in quad-tree and
@@ -254,10 +328,15 @@ class SoSimpleChunkedLoDTerrain : public SoShape
     /** Renders tile tree.
     Renders whole terrain on appropriate level of detail starting with root
     tile on index \e index in tile quad-tree. This index should be always setted
-    to zere when called not recursively.
+    to zere when called not recursively. Subtrees outside of view volume are
+    skipped, tiles are tested only against planes not containing their parent.
+    With occlusion culling children are traversed front to back and subtrees
+    hidden behind horizon of rendered tiles are skipped too.
     \param action Object with scene graph informations.
-    \param index Index of root tile, should be always setted to zero. */
-    void renderTree(SoGLRenderAction * action, const int index);
+    \param index Index of root tile, should be always setted to zero.
+    \param cull_flags Culling flags of parent tile, see ::SbFrustumCuller. */
+    void renderTree(SoGLRenderAction * action, const int index,
+      int cull_flags);
     /** Destructor.
     Privatised because Coin handles nodes memory frees itself. */
     virtual ~SoSimpleChunkedLoDTerrain();
@@ -9,10 +9,10 @@
 /// \author Radek Barton - xbarto33
 /// \date 30.01.2006
 ///
-/// Zde jsou definov�y z�ladn�datov�typy algoritmu Geo Mip-Mapping.
-/// Kvadrantov strom dladic ve t��::SbGeoMipmapTileTree rekurzivn�/// rozd�uje vkovou mapu ter�u na dladice t�y SbGeoMipmapTile. V jeho
-/// horn�h patrech jsou dladice pouze virtu�n� tj. ty, kter�neobsahuj�/// vlastn�geometrii, ale jenom sv�potomky. Dladice na nejni�rovni
-/// stromu obsahuj�pole jednotlivch rovn�detail dladice ve t��/// ::SbGeoMipmapTileLevel, jen u geometrii zahrnuj�
+/// Basic data types of the Geo Mip-Mapping algorithm. The tile quadtree
+/// ::SbGeoMipmapTileTree recursively divides the height map to tiles. Its
+/// inner nodes are virtual tiles ::SbGeoMipmapTile without own geometry, the
+/// leaf tiles are stored in flat arrays of the tree.
 //////////////////////////////////////////////////////////////////////////////
 // Copyright (C) 2006 Radek Barton
 //
@@ -39,85 +39,38 @@
 #include <debug.h>
 #include <utils.h>
 
-/** �ove�detail dladice algoritmu Geo Mip-Mapping.
-Tato t�a obsahuje indexy vrchol geometrie rovn�detail jedn�dladice.
-D�e je zde statick��st chybov�metriky platn�pro tuto rove� kter�se
-pedpo�ta v dob�na�t��vstupn�vkov�mapy. */
-struct SbGeoMipmapTileLevel
-{
-  public:
-    /* Metody */
-    /** Konstruktor.
-    Inicializuje instanci t�y ::SbGeoMipmapTileLevel, aby obsahovala
-    pole vrchol rovn�detail dladice \p vertices s celkovou statickou
-    �st�chybov�metriky \p error.
-    \param error Chyba statick��sti chybov�metriky.
-    \param vertices Pole vrchol geometrie rovn�detail dladice. */
-    SbGeoMipmapTileLevel(float error = 0.0f, int * vertices = NULL);
-    /** Destruktor.
-    Uvoln�pole vrchol rovn�detail dladice a deinicalizuje instanci
-    t�y SbGeoMipmapTileLevel. */
-    ~SbGeoMipmapTileLevel();
-    /* Datove polozky */
-    /// Statick��st chybov�metriky rovn�detail dladice.
-    float error;
-    /// Vrcholy geometrie rovn�detail dladice.
-    int * vertices;
-};
-
-/** Dladice algoritmu Geo Mip-Mapping.
-Z t�hto dladic se vytvo�kvadrantov strom dladic slou��pro vpo�t
-oez���pohledovm t�esem. Pokud je ukazatel na rovn�datail dladice
-roven \p NULL, jedn�se o virtu�n�dladici v horn�h rovn�h stromu. */
+/** Node of the tile quadtree of the Geo Mip-Mapping algorithm.
+Inner nodes of the quadtree are virtual tiles used for hierarchical frustum
+culling. Leaf tiles of the bottom level are not stored as nodes but in flat
+arrays of ::SbGeoMipmapTileTree. */
 struct SbGeoMipmapTile
 {
   public:
     /* Metody */
     /** Konstruktor.
-    Vytvo�instanci t�y ::SbGeoMipmapTile a inicializuje jeho datov�    prvky na hodnoty \p levels, \p left, \p right, \p top, \p bottom, \p level,
-    \p bounds a \p center.
-    \param levels Ukazatel na pole rovn�detail dladice.
-    \param left Ukazatel na lev�o souseda dladice.
-    \param right Ukazatel na prav�o souseda dladice.
-    \param top Ukazatel na horn�o souseda dladice.
-    \param bottom Ukazatel na doln�o souseda dladice.
-    \param level �slo rovn�detail, kter�se m�vykreslit.
-    \param bounds Ohrani�n�vrchol dladice.
-    \param center Sted ohrani�n�vrchol dladice. */
-    SbGeoMipmapTile(SbGeoMipmapTileLevel * levels = NULL,
-      SbGeoMipmapTile * left = NULL, SbGeoMipmapTile * right = NULL,
-      SbGeoMipmapTile * top = NULL, SbGeoMipmapTile * bottom = NULL,
-      int level = LEVEL_NONE, SbBox3f bounds = SbBox3f(),
-      SbVec3f center = SbVec3f());
-    /** Destruktor.
-    Zru�instanci t�y ::SbGeoMipmapTile a uvoln�pole rovni detail
-    dladice. */
-    ~SbGeoMipmapTile();
+    Creates a node with the bounds \p bounds and the visibility \p level.
+    \param level ::LEVEL_NONE if the node is culled, 0 otherwise.
+    \param bounds Bounds of the vertices of the node. */
+    SbGeoMipmapTile(int level = LEVEL_NONE, SbBox3f bounds = SbBox3f());
     /* Datove polozky */
-    /// Ukazatel na pole rovn�detail dladice.
-    SbGeoMipmapTileLevel * levels;
-    /// Ukazatel na lev�o souseda dladice.
-    SbGeoMipmapTile * left;
-    /// Ukazatel na prav�o souseda dladice.
-    SbGeoMipmapTile * right;
-    /// Ukazatel na horn�o souseda dladice.
-    SbGeoMipmapTile * top;
-    /// Ukazatel na doln�o souseda dladice.
-    SbGeoMipmapTile * bottom;
-    /// �slo rovn�detail, kter�se m�vykreslit.
+    /// ::LEVEL_NONE if the node is culled, 0 otherwise.
     int level;
-    /// Ohrani�n�vrchol dladice.
+    /// Culling flags of the node in the current frame, see ::SbFrustumCuller.
+    int cull_flags;
+    /// Bounds of the vertices of the node.
     SbBox3f bounds;
-    /// Sted ohrani�n�vrchol dladice.
-    SbVec3f center;
     /* Konstanty. */
     /// �slo rovn�detail dladice, kter�se nem�vykreslovat vbec.
     static const int LEVEL_NONE;
 };
 
 /** Strom dladic algoritmu Geo Mip-Mapping.
-Kvadrantov strom dladic se vytvo�v prb�u na�t��vkov�mapy a napln�se dladicemi t�y ::SbGeoMipmapTile obsahuj��i jednotliv�rovn�detail
-dladice t�y ::SbGeoMipmapTileLevel. */
+The quadtree is created while the height map is loaded. Its inner nodes are
+virtual tiles ::SbGeoMipmapTile, the levels of detail of the leaf tiles share
+vertex templates relative to the first vertex of a tile.
+Leaf tiles are stored as structure of arrays indexed by their position in the
+bottom level of the quadtree, so the selection of levels of detail runs over
+contiguous arrays of bounds, centers and squared distance thresholds. */
 struct SbGeoMipmapTileTree
 {
   public:
@@ -127,11 +80,22 @@ struct SbGeoMipmapTileTree
     ::SbGeoMipmapTileTree obsahuj��o dladice o velikosti strany \p tile_size
     uspo�anch do �verce o stran�\p tile_count dladic.
     \param tile_count Po�t dladic na stranu vkov�mapy.
-    \param tile_size Velikost strany jedn�dladice. */
-    SbGeoMipmapTileTree(int tile_count, int tile_size);
+    \param tile_size Velikost strany jedn�dladice.
+    \param map_size Size of the side of the height map. */
+    SbGeoMipmapTileTree(int tile_count, int tile_size, int map_size);
     /** Destruktor.
     Zru�instanci t�y ::SbGeoMipmapTileTree a uvoln�pole velikost�rovn�    detail dladic i vechny dladice ve strom� */
     ~SbGeoMipmapTileTree();
+    /** Returns bounds of a leaf tile.
+    \param tile Index of the leaf tile.
+    \return Bounds of the vertices of the tile. */
+    inline SbBox3f getBounds(const int tile) const;
+    /** Returns error of a level of detail of a leaf tile.
+    \param tile Index of the leaf tile.
+    \param level Index of the level of detail.
+    \return Static part of the error metric of the level \p level of the
+    tile. */
+    inline float & getError(const int tile, const int level);
     /* Datove polozky. */
     /// Po�t dladic na stranu vstupn�vkov�mapy.
     int tile_count;
@@ -145,8 +109,65 @@ struct SbGeoMipmapTileTree
     int level_count;
     /// Pole velikost�stran pol�vrchol rovn�kad�dladice.
     int * level_sizes;
-    /// Pole jednotlivch dladic kvadrantov�o stromu dladic.
+    /// Vertices of every level of detail relative to the first vertex of a
+    /// tile, shared by all tiles.
+    int ** level_vertices;
+    /// Vertices of the previous level of detail left out by every level of
+    /// detail relative to the first vertex of a tile, shared by all tiles.
+    /// The last \p level_sizes[level] - 1 vertices lie in the bottom row and
+    /// the same number before them in the right column.
+    int ** morph_vertices;
+    /// Numbers of the vertices in ::morph_vertices for every level of detail.
+    int * morph_counts;
+    /// Height differences between the vertices of the height map and their
+    /// interpolation in the level of detail which leaves them out, \p NULL
+    /// until the morphing is used.
+    float * morph_deltas;
+    /// Virtual tiles of the quadtree above the bottom level.
     SbGeoMipmapTile * tiles;
+    /// Bounds of the whole height map.
+    SbBox3f bounds;
+    /* Leaf tiles. */
+    /// Indices of the first vertices of the leaf tiles in the height map.
+    int * base_vertices;
+    /// Static parts of the error metric of the levels of detail of the leaf
+    /// tiles, \p level_count for every tile.
+    float * errors;
+    /// Minimal x coordinates of the bounds of the leaf tiles.
+    float * min_x;
+    /// Minimal y coordinates of the bounds of the leaf tiles.
+    float * min_y;
+    /// Minimal z coordinates of the bounds of the leaf tiles.
+    float * min_z;
+    /// Maximal x coordinates of the bounds of the leaf tiles.
+    float * max_x;
+    /// Maximal y coordinates of the bounds of the leaf tiles.
+    float * max_y;
+    /// Maximal z coordinates of the bounds of the leaf tiles.
+    float * max_z;
+    /// X coordinates of the centers of the leaf tiles.
+    float * center_x;
+    /// Y coordinates of the centers of the leaf tiles.
+    float * center_y;
+    /// Z coordinates of the centers of the leaf tiles.
+    float * center_z;
+    /// Squared camera distances from which the levels of detail of the leaf
+    /// tiles are used, \p tile_count for every level of detail.
+    float * thresholds;
+    /// Squared camera distances of the centers of the leaf tiles.
+    float * distances;
+    /// Selected levels of detail of the leaf tiles.
+    int * levels;
+    /// Coarsest levels of detail of the leaf tiles allowed by the hysteresis
+    /// band in the current frame.
+    int * max_levels;
+    /// Levels of detail of the leaf tiles selected in the last frame,
+    /// including the culled tiles.
+    int * last_levels;
+    /// Right neighbours of the leaf tiles or -1.
+    int * right_tiles;
+    /// Bottom neighbours of the leaf tiles or -1.
+    int * bottom_tiles;
   private:
     /** Kop�ovac�konstruktor.
     Zprivatizov�, aby se zabr�ilo vytv�en�kopi�kvadrantov�o stromu dladic.
@@ -154,4 +175,19 @@ struct SbGeoMipmapTileTree
     SbGeoMipmapTileTree(const SbGeoMipmapTileTree & old_tree);
 };
 
+/******************************************************************************
+* SbGeoMipmapTileTree - public
+******************************************************************************/
+
+inline SbBox3f SbGeoMipmapTileTree::getBounds(const int tile) const
+{
+  return SbBox3f(min_x[tile], min_y[tile], min_z[tile], max_x[tile],
+    max_y[tile], max_z[tile]);
+}
+
+inline float & SbGeoMipmapTileTree::getError(const int tile, const int level)
+{
+  return errors[(tile * level_count) + level];
+}
+
 #endif
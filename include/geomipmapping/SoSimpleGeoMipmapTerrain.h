@@ -36,7 +36,9 @@
 #include <Inventor/SbBasic.h>
 #include <Inventor/SbLinear.h>
 #include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/fields/SoSFBool.h>
+#include <Inventor/fields/SoSFFloat.h>
 #include <Inventor/fields/SoSFInt32.h>
 #include <Inventor/nodes/SoShape.h>
 #include <Inventor/elements/SoCoordinateElement.h>
@@ -57,12 +59,19 @@
   #include <windows.h>
 #endif
 #include <GL/gl.h>
+#ifndef APIENTRY
+  #define APIENTRY
+#endif
 
 // ostatni includy
 #include <assert.h>
 
 // lokalni includy
 #include <geomipmapping/SbGeoMipmapPrimitives.h>
+#include <SbGLVertexBuffer.h>
+#include <SbFrustumCuller.h>
+#include <SbHorizonCuller.h>
+#include <SbTaskPool.h>
 #include <profiler/PrProfiler.h>
 #include <debug.h>
 
@@ -94,7 +103,43 @@ class SoSimpleGeoMipmapTerrain : public SoShape
     SoSFBool frustumCulling;
     /// P�nak "zmrazen� vykreslov��ter�u.
     SoSFBool freeze;
+    /// Flag of culling of tiles hidden behind the horizon of nearer tiles.
+    SoSFBool occlusionCulling;
+    /// Relative width of the band around the distance thresholds in which
+    /// a leaf tile keeps its level of detail of the last frame.
+    SoSFFloat levelHysteresis;
+    /// Flag of geomorphing of the tiles towards their next levels of detail.
+    SoSFBool morphing;
+    /// Number of threads of the preprocessing, 0 means number of processors.
+    SoSFInt32 threadCount;
+    /* Metody */
+    /** Returns number of culling tests.
+    \return Number of box-plane tests of the frustum culling in the last
+    frame. */
+    int getCullTestCount() const;
+    /** Preprocesses the height map.
+    Builds the tile quadtree of the height map \p coords on a pool of
+    \p threadCount threads. The first render calls it with the coordinates
+    of the scene graph, a direct call measures the preprocessing. The
+    sizes and the thread count are read from the fields.
+    \param coords Points of the height map of the \p mapSize size. */
+    void preprocess(const SbVec3f * coords);
   protected:
+    /* Typy. */
+    /** Task of the parallel preprocessing. */
+    struct SbGeoMipmapInitTask
+    {
+      /// Preprocessed terrain.
+      SoSimpleGeoMipmapTerrain * terrain;
+      /// Index of the root of the initialized subtree.
+      int index;
+      /// Index range of the height map covered by the subtree.
+      SbBox2s coord_box;
+    };
+    /// Type of \p glMultiDrawElementsBaseVertex.
+    typedef void (APIENTRY * SbGLMultiDrawElementsBaseVertex)(GLenum mode,
+      const GLsizei * count, GLenum type, const GLvoid * const * indices,
+      GLsizei draw_count, const GLint * base_vertex);
     /* Metody */
     /** Vykreslen�ter�u.
     Pi prvn� sput��vybuduje ze vstupn�vkov�mapy kvadrantov strom
@@ -119,42 +164,141 @@ class SoSimpleGeoMipmapTerrain : public SoShape
     \p coord_box slou�k ped���rozsahu index bod vstupn�vkov�mapy.
     \param index Index koene inicializovan�o podstromu stromu dladic.
     \param coord_box Rozsah index bod vstupn�vkov�mapy.
-    \return */
-    SbBox3f initTree(const int index, SbBox2s coord_box);
-    /** Inicializace jedn�dladice.
-    Inicializuje jednu dladici \p tile kvadrantov�o stromu dladic v�tn�    jej�h rovn�detail body vstupn�vkov�mapy v rozsahu index
-    \p coord_box.
-    \param tile Dladice, kter�se m�inicializovat.
-    \param coord_box Rozsah index vstupn�vkov�mapy na zem�dladice. */
-    inline void initTile(SbGeoMipmapTile & tile, SbBox2s coord_box);
-    /** Inicializace rovn�detail dladice.
-    Inicializuje rove�detail \p level o velikosti strany \p level_size
-    podle ji zinicializovan�vy�rovn�detail dladice \p parent.
-    \param level Inicializovan�rove�detail dladice.
-    \param parent Ji inicializovan�vy�rove�detail dladice.
-    \param level_size Velikost strany rovn�detail dladice. */
-    inline void initLevel(SbGeoMipmapTileLevel & level,
-      SbGeoMipmapTileLevel & parent, const int level_size);
-    /** Pepo�t��kvadrantov�o stromu dladic.
-    Podle vpo�u dynamick��sti chybov�metriky a podle pozice pohledov�o
-    t�esa vybere u kad�dladice stromu p�lunou rove�detail. Toto
-    prov��rekurzivn�od indexu podstromu \p index. Parametr \p render_parent
-    slou�k propagaci informace zda se se vykresluje rodi�vsk�dladice koene
-    podstromu.
-    \param index Index koene podstromu stromu dladic.
-    \param render_parent P�nak toho, e se rodi�koene podstromu vykresluje. */
-    void recomputeTree(const int index, const SbBool render_parent);
-    /** Vykreslen�kvadrantov�o stromu dladic.
-    Rekurzivn�projde kvadrantovm stromem dladic podle indexu koene \p index
-    a vykresl�jeho dladice s vybranou rovn�detail.
-    \param action Objekt nesouc�informace o grafu sc�y.
-    \param index Index koene podstromu stromu dladic. */
-    void renderTree(SoAction * action, const int index);
-    /** Vb� rovn�detail dladice.
-    Podle chybov�metriky vybere spr�nou rove�detail dladice, kter�se m�    vykreslit.
-    \param tile Dladice, u n�vb� prob��
-    \return Index vybran�rovn�detail. */
-    inline int pickLevel(const SbGeoMipmapTile & tile) const;
+    \param depth Number of initialized levels below the root, deeper
+    subtrees are already initialized by tasks. Negative value initializes
+    the whole subtree.
+    \return Bounds of the subtree. */
+    SbBox3f initTree(const int index, SbBox2s coord_box, const int depth);
+    /** Collects tasks of the parallel preprocessing.
+    Appends a task for every subtree \p depth levels below the tile
+    \p index to \p tasks.
+    \param index Index of the root of the subtree.
+    \param coord_box Index range of the height map covered by the subtree.
+    \param depth Number of levels of the subtrees below the root.
+    \param tasks List of the tasks. */
+    void initTasks(const int index, SbBox2s coord_box, const int depth,
+      SbList<SbGeoMipmapInitTask> & tasks);
+    /** Initializes a subtree of a task.
+    \param task Pointer to a ::SbGeoMipmapInitTask instance. */
+    static void initTask(void * task);
+    /** Initializes a leaf tile.
+    Computes the errors of the levels of detail of the leaf tile \p tile
+    from the points of the height map in the index range \p coord_box and
+    stores its first vertex, bounds and center to the arrays of the tree.
+    \param tile Index of the leaf tile.
+    \param coord_box Index range of the height map covered by the tile.
+    \return Bounds of the vertices of the tile. */
+    inline SbBox3f initTile(const int tile, SbBox2s coord_box);
+    /** Initializes a level of detail of a leaf tile.
+    Computes the static part of the error metric of the level \p level of
+    the leaf tile \p tile from its already initialized finer level.
+    \param tile Index of the leaf tile.
+    \param level Index of the initialized level of detail. */
+    inline void initLevel(const int tile, const int level);
+    /** Initializes index buffers of the levels of detail.
+    Builds the triangles of the inner parts and of the stitching of all
+    levels of detail, shared by all tiles. */
+    void initIndices();
+    /** Initializes the inner part of a level of detail.
+    Appends the triangles of the level \p level without the edges stitched
+    to the neighbours to \p indices.
+    \param level Index of the level of detail.
+    \param draw_right The right edge is stitched.
+    \param draw_bottom The bottom edge is stitched.
+    \param indices Vertex indices relative to the first vertex of a tile. */
+    void initBody(const int level, const SbBool draw_right,
+      const SbBool draw_bottom, SbList<GLuint> & indices);
+    /** Initializes stitching of a level of detail.
+    Appends the triangle fans connecting the level \p level to the right
+    neighbour of the level \p right_level and to the bottom neighbour of the
+    level \p bottom_level to \p indices. A neighbour of the same level is not
+    stitched.
+    \param level Index of the level of detail.
+    \param right_level Level of detail of the right neighbour.
+    \param bottom_level Level of detail of the bottom neighbour.
+    \param indices Vertex indices relative to the first vertex of a tile. */
+    void initStitch(const int level, const int right_level,
+      const int bottom_level, SbList<GLuint> & indices);
+    /** Initializes morphing targets of stitching.
+    Finds the triangles of the stitching \p stitch of the level \p level
+    which contain the vertices of the previous level left out by the level
+    and appends these vertices followed by the vertices of their triangles
+    to \p vertices and the barycentric coordinates in the triangles to
+    \p weights. Vertices of the right and bottom edges are left to the
+    neighbours.
+    \param level Index of the level of detail.
+    \param stitch Vertex indices of the triangles of the stitching.
+    \param vertices Morphed vertices and vertices of their triangles.
+    \param weights Barycentric coordinates of the morphed vertices. */
+    void initMorphStitch(const int level, const SbList<GLuint> & stitch,
+      SbList<int> & vertices, SbList<float> & weights);
+    /** Appends a triangle fan as triangles.
+    \param indices Vertex indices of triangles.
+    \param fan Vertex indices of the triangle fan. */
+    static void appendFan(SbList<GLuint> & indices,
+      const SbList<GLuint> & fan);
+    /** Selects levels of detail of the tiles.
+    Culls the virtual tiles in the order of the array of the tree, so a tile
+    is tested only against the planes of the view volume not containing its
+    parent, and selects the level of detail of all leaf tiles by comparison
+    of their squared camera distances with the thresholds of the levels in
+    loops over the arrays of the tree. A tile changes its level of the last
+    frame only if the distance leaves the hysteresis band around the
+    thresholds.
+    Culled leaf tiles get the level SbGeoMipmapTile::LEVEL_NONE. */
+    void recomputeTiles();
+    /** Recomputes the squared distance thresholds.
+    Computes the squared camera distances from which the levels of detail of
+    the leaf tiles are used for the current ::distance_const. Called only if
+    the constant changes by more than ::THRESHOLD_TOLERANCE, which happens
+    on changes of the pixel error, the viewport or the field of view. */
+    void updateThresholds();
+    /** Culls tiles hidden behind the horizon.
+    Traverses the tile quadtree front to back and culls tiles whose bounds
+    are below the horizon of the nearer visible leaf tiles, whole subtrees
+    of hidden virtual tiles at once. */
+    void cullOccluded();
+    /** Morphs tiles towards their next levels of detail.
+    Restores the vertices morphed in the last frame and moves the vertices
+    left out by the next level of detail of every visible leaf tile towards
+    their interpolation in that level, so the tiles reach the shape of the
+    next level before they switch to it. Vertices in the strips stitched to
+    the neighbours in the next level are morphed to the stitching triangles.
+    Vertices of shared edges are morphed by the tile which draws them.
+    Changed coordinates are uploaded to the vertex buffer. The morphed
+    coordinates and deltas are created in the first call with morphing.
+    \param context_id Identifier of the current OpenGL context. */
+    void morphTiles(const uint32_t context_id);
+    /** Initializes morphing deltas.
+    Allocates the morphing deltas of the tile tree and computes them for
+    the vertices left out by every level of detail of every leaf tile. */
+    void initMorphDeltas();
+    /** Returns the cell of a leaf tile in ::changed_tiles.
+    \param tile Index of the leaf tile.
+    \return Index of the tile in the order of rows of the height map. */
+    inline int getTileCell(const int tile) const;
+    /** Uploads coordinates of changed tiles.
+    Uploads the rows of the tiles marked in ::changed_tiles to the vertex
+    buffer in ranges joined across neighbouring tiles and rows, and clears
+    the marks.
+    \param context_id Identifier of the current OpenGL context. */
+    void uploadChangedTiles(const uint32_t context_id);
+    /** Adds a leaf tile to the draws of the frame.
+    Adds the inner part of the selected level of detail of the leaf tile
+    \p tile and the stitching to its right and bottom neighbours from the
+    shared index buffers.
+    \param tile Index of the leaf tile. */
+    void addTile(const int tile);
+    /** Adds shared indices to the draws of the frame.
+    \param indices Vertex indices relative to the first vertex of a tile.
+    \param base Index of the first vertex of the tile. */
+    inline void addDraw(const SbList<GLuint> & indices, const int base);
+    /** Initializes the draw function of an OpenGL context.
+    Looks up \p glMultiDrawElementsBaseVertex in the context \p context_id.
+    Without it the indices of the frame are moved by the base vertices of
+    the tiles and drawn by one \p glDrawElements call.
+    \param context_id Identifier of the OpenGL context. */
+    void initDrawFunc(const uint32_t context_id);
     /* Callbacky. */
     /** Callback zm�y pole \p mapSize.
     Pi zm��hodnoty pole \p mapSize nastav�jeho intern�reprezentaci novou
@@ -186,6 +330,26 @@ class SoSimpleGeoMipmapTerrain : public SoShape
     \param instance Ukazatel na instanci t�y SoSimpleGeoMipmapTerrain.
     \param sensor Senzor, kter callback vyvolal */
     static void freezeChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p occlusionCulling field change.
+    Updates the internal value of the \p occlusionCulling field.
+    \param instance Pointer to the SoSimpleGeoMipmapTerrain instance.
+    \param sensor Sensor which called the callback. */
+    static void occlusionCullingChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p levelHysteresis field change.
+    Updates the internal value of the \p levelHysteresis field.
+    \param instance Pointer to the SoSimpleGeoMipmapTerrain instance.
+    \param sensor Sensor which called the callback. */
+    static void levelHysteresisChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p morphing field change.
+    Updates the internal value of the \p morphing field.
+    \param instance Pointer to the SoSimpleGeoMipmapTerrain instance.
+    \param sensor Sensor which called the callback. */
+    static void morphingChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p threadCount field change.
+    Updates the internal value of the \p threadCount field.
+    \param instance Pointer to the SoSimpleGeoMipmapTerrain instance.
+    \param sensor Sensor which called the callback. */
+    static void threadCountChangedCB(void * instance, SoSensor * sensor);
     /* Zkratky elementu. */
     /// Body vykov�mapy.
     const SbVec3f * coords;
@@ -200,8 +364,51 @@ class SoSimpleGeoMipmapTerrain : public SoShape
     /* Datove polozky. */
     /// Kvadrantov strom dladic.
     SbGeoMipmapTileTree * tile_tree;
+    /// Hierarchical frustum culler of the tile quadtree.
+    SbFrustumCuller frustum_culler;
+    /// Horizon occlusion culler of the leaf tiles.
+    SbHorizonCuller horizon_culler;
     /// Konstanta pro vpo�t dynamick��sti chybov�metriky.
     float distance_const;
+    /// Value of ::distance_const for which the thresholds were computed.
+    float threshold_distance_const;
+    /// Indices of the inner parts of the levels of detail, four combinations
+    /// of stitched right and bottom edges for every level.
+    SbList<GLuint> * body_indices;
+    /// Indices of the stitching of the levels of detail, every combination
+    /// of levels of the right and bottom neighbours for every level.
+    SbList<GLuint> * stitch_indices;
+    /// Vertices in the triangles of ::stitch_indices morphed to them, every
+    /// one followed by the three vertices of its triangle.
+    SbList<int> * morph_stitch_vertices;
+    /// Barycentric coordinates of the vertices in ::morph_stitch_vertices.
+    SbList<float> * morph_stitch_weights;
+    /// Vertex buffer of the height map.
+    SbGLVertexBuffer vertex_buffer;
+    /// Index counts of the draws of the frame.
+    SbList<GLsizei> draw_counts;
+    /// Shared indices of the draws of the frame.
+    SbList<const GLvoid *> draw_indices;
+    /// Base vertices of the draws of the frame.
+    SbList<GLint> draw_bases;
+    /// Indices of the frame if the base vertex is not supported.
+    SbList<GLuint> frame_indices;
+    /// OpenGL context of ::multi_draw_func.
+    uint32_t draw_context_id;
+    /// Flag of initialized ::multi_draw_func.
+    SbBool is_draw_context;
+    /// \p glMultiDrawElementsBaseVertex of the context or \p NULL.
+    SbGLMultiDrawElementsBaseVertex multi_draw_func;
+    /// Coordinates of the height map with morphed heights, \p NULL until the
+    /// morphing is used.
+    SbVec3f * morph_coords;
+    /// Vertices morphed in the current frame.
+    SbList<int> morphed_vertices;
+    /// Leaf tiles morphed in the current frame.
+    SbList<int> morphed_tiles;
+    /// Flags of tiles with changed coordinates in the order of rows of the
+    /// height map, \p NULL until the morphing is used.
+    SbBool * changed_tiles;
     /// P�nak pouit�textury.
     SbBool is_texture;
     /// P�nak pouit�morm�.
@@ -217,6 +424,14 @@ class SoSimpleGeoMipmapTerrain : public SoShape
     SbBool is_frustum_culling;
     /// P�nak "zmrazen� vykreslov��ter�u.
     SbBool is_freeze;
+    /// Internal value of the \p occlusionCulling field.
+    SbBool is_occlusion_culling;
+    /// Internal value of the \p levelHysteresis field.
+    float level_hysteresis;
+    /// Internal value of the \p morphing field.
+    SbBool is_morphing;
+    /// Internal value of the \p threadCount field.
+    int thread_count;
     /* Sensory. */
     /// Senzor pole \p mapSize.
     SoFieldSensor * map_size_sensor;
@@ -228,9 +443,24 @@ class SoSimpleGeoMipmapTerrain : public SoShape
     SoFieldSensor * frustum_culling_sensor;
     /// Senzor pole \p freeze.
     SoFieldSensor * freeze_sensor;
+    /// Sensor of the \p occlusionCulling field.
+    SoFieldSensor * occlusion_culling_sensor;
+    /// Sensor of the \p levelHysteresis field.
+    SoFieldSensor * level_hysteresis_sensor;
+    /// Sensor of the \p morphing field.
+    SoFieldSensor * morphing_sensor;
+    /// Sensor of the \p threadCount field.
+    SoFieldSensor * thread_count_sensor;
     /* Konstanty. */
     /// Vchoz�hodnota chyby zobrazen�v pixelech.
     static const int DEFAULT_PIXEL_ERROR;
+    /// Default value of the \p levelHysteresis field.
+    static const float DEFAULT_LEVEL_HYSTERESIS;
+    /// Relative change of ::distance_const which rebuilds the thresholds.
+    static const float THRESHOLD_TOLERANCE;
+    /// Part of the distance range of a level of detail in which its tiles
+    /// morph towards the next level.
+    static const float MORPH_RANGE;
   private:
     /* Metody */
     /** Destruktor.
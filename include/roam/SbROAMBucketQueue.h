@@ -0,0 +1,212 @@
+#ifndef SB_ROAM_BUCKET_QUEUE_H
+#define SB_ROAM_BUCKET_QUEUE_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Bucketed priority queues of the ROAM algorithm.
+/// \file SbROAMBucketQueue.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// The split and merge queues only need an approximate order of their items,
+/// because the priorities change every frame anyway. The bucketed queues
+/// quantize the priority to a fixed number of buckets and keep an intrusive
+/// list of items in every bucket, so that insertion, removal and change of
+/// priority cost O(1) instead of O(log n) of the binary heap.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// OpenInventor includy
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+
+// standardni includy
+#include <cstring>
+
+// lokalni includy
+#include <roam/SbROAMSplitQueue.h>
+#include <roam/SbROAMMergeQueue.h>
+
+struct SbROAMQueueItem;
+
+/** Bucketed priority queue.
+Core of the bucketed split and merge queues. Priorities of the items are
+quantized to ::SbROAMBucketQueue::BUCKET_COUNT buckets by the exponent and the
+highest bits of the mantissa of their IEEE 754 representation, which gives
+a relative precision of about 1.6 percent over the whole range of the
+priorities. Items are also kept in a dense list, so that the queue may be
+iterated by index like the binary heap. Bounds of the non-empty buckets are
+maintained lazily, so that the search for maximum or minimum only walks over
+the buckets emptied since the last search. */
+class SbROAMBucketQueue
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates an empty queue with a room for \p init_size items.
+    \param init_size Initial size of the queue. */
+    SbROAMBucketQueue(const int init_size = 1024);
+    /** Destructor. */
+    ~SbROAMBucketQueue();
+    /** Empties the queue. */
+    void emptyQueue();
+    /** Inserts an item to the queue.
+    \param item Item to insert. */
+    void add(SbROAMQueueItem * item);
+    /** Removes an item from the queue.
+    \param item Item to remove. */
+    void remove(SbROAMQueueItem * item);
+    /** Updates position of an item.
+    Moves the item \p item to the bucket of its current priority.
+    \param item Item with changed priority. */
+    void update(SbROAMQueueItem * item);
+    /** Rebuilds the queue.
+    Puts all items to the buckets of their current priorities. */
+    void rebuild();
+    /** Returns an item with the highest priority.
+    \return Item from the highest non-empty bucket or \p NULL if the queue is
+    empty. */
+    SbROAMQueueItem * getMax();
+    /** Returns an item with the lowest priority.
+    \return Item from the lowest non-empty bucket or \p NULL if the queue is
+    empty. */
+    SbROAMQueueItem * getMin();
+    /** Returns an item by its index.
+    \param index Index of the item from 1 to ::SbROAMBucketQueue::size().
+    \return Item on the index \p index. */
+    inline SbROAMQueueItem * operator[](const int index);
+    /** Returns size of the queue.
+    \return Number of items in the queue. */
+    inline int size() const;
+    /** Returns the bucket of a priority.
+    Items in the same bucket are not ordered, so priorities of items taken
+    from different queues have to be compared by their buckets.
+    \param priority Priority of an item.
+    \return Index of the bucket for the priority \p priority. */
+    static inline int getBucket(const float priority);
+    /* Data members. */
+    /// Number of the buckets.
+    static const int BUCKET_COUNT = 1 << 14;
+  private:
+    /* Methods. */
+    /** Links an item to the bucket of its priority.
+    \param item Item to link. */
+    inline void link(SbROAMQueueItem * item);
+    /** Unlinks an item from its bucket.
+    \param item Item to unlink. */
+    inline void unlink(SbROAMQueueItem * item);
+    /* Data members. */
+    /// Dense list of all items in the queue.
+    SbList<SbROAMQueueItem *> items;
+    /// First items of the buckets.
+    SbROAMQueueItem ** buckets;
+    /// Upper bound of the non-empty buckets.
+    int max_bucket;
+    /// Lower bound of the non-empty buckets.
+    int min_bucket;
+};
+
+/** Bucketed split queue.
+Split queue with O(1) operations built on ::SbROAMBucketQueue. */
+class SbROAMBucketSplitQueue : public SbROAMSplitQueue
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates an empty queue with a room for \p init_size triangles.
+    \param init_size Initial size of the queue. */
+    SbROAMBucketSplitQueue(const int init_size = 1024);
+    /** Destructor. */
+    virtual ~SbROAMBucketSplitQueue();
+    virtual Type getType() const;
+    virtual void emptyQueue();
+    virtual void add(SbROAMSplitQueueTriangle * triangle);
+    virtual void remove(SbROAMSplitQueueTriangle * triangle);
+    virtual SbROAMSplitQueueTriangle * extractMax();
+    virtual SbROAMSplitQueueTriangle * getMax();
+    virtual SbROAMSplitQueueTriangle * operator[](const int index);
+    virtual int size() const;
+    virtual void update(SbROAMSplitQueueTriangle * triangle);
+    virtual void rebuild();
+  private:
+    /* Data members. */
+    /// Bucketed queue of the triangles.
+    SbROAMBucketQueue queue;
+};
+
+/** Bucketed merge queue.
+Merge queue with O(1) operations built on ::SbROAMBucketQueue. */
+class SbROAMBucketMergeQueue : public SbROAMMergeQueue
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates an empty queue with a room for \p init_size diamonds.
+    \param init_size Initial size of the queue. */
+    SbROAMBucketMergeQueue(const int init_size = 4096);
+    /** Destructor. */
+    virtual ~SbROAMBucketMergeQueue();
+    virtual Type getType() const;
+    virtual void emptyQueue();
+    virtual void add(SbROAMMergeQueueDiamond * diamond);
+    using SbROAMMergeQueue::remove;
+    virtual void remove(SbROAMMergeQueueDiamond * diamond);
+    virtual SbROAMMergeQueueDiamond * extractMin();
+    virtual SbROAMMergeQueueDiamond * getMin();
+    virtual SbROAMMergeQueueDiamond * operator[](const int index);
+    virtual int size() const;
+    virtual void update(SbROAMMergeQueueDiamond * diamond);
+    virtual void rebuild();
+  private:
+    /* Data members. */
+    /// Bucketed queue of the diamonds.
+    SbROAMBucketQueue queue;
+};
+
+/******************************************************************************
+* SbROAMBucketQueue - public
+******************************************************************************/
+
+inline SbROAMQueueItem * SbROAMBucketQueue::operator[](const int index)
+{
+  return items[index - 1];
+}
+
+inline int SbROAMBucketQueue::size() const
+{
+  return items.getLength();
+}
+
+inline int SbROAMBucketQueue::getBucket(const float priority)
+{
+  /* Zero, negative and invalid priorities belong to the lowest bucket. */
+  if (!(priority > 0.0f))
+  {
+    return 0;
+  }
+
+  /* The exponent and the highest bits of the mantissa of a positive number
+  grow with its value. */
+  unsigned int bits;
+  memcpy(&bits, &priority, sizeof(bits));
+  int bucket = static_cast<int>(bits >> 17);
+  return SbMin(bucket, BUCKET_COUNT - 1);
+}
+
+#endif
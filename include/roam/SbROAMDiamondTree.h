@@ -0,0 +1,321 @@
+#ifndef SB_ROAM_DIAMOND_TREE_H
+#define SB_ROAM_DIAMOND_TREE_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Diamonds of the diamond based ROAM algorithm.
+/// \file SbROAMDiamondTree.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// Every vertex of the height map except of its corners is the center of one
+/// diamond, which is split when the vertex is part of the triangulation. The
+/// ::SbROAMDiamondTree class keeps one record per vertex in an array indexed
+/// like the height map and finds parents, children and the hypotenuse of a
+/// diamond from the coordinates of its center.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// OpenInventor includy
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbLinear.h>
+
+// lokalni includy
+#include <roam/SbROAMPrimitives.h>
+
+/** Diamond of the diamond based ROAM algorithm.
+Record of one vertex of the height map. The diamond is formed by the
+triangles which have the vertex in the middle of their hypotenuse, splitting
+the diamond adds the vertex to the triangulation. Unsplit diamonds with a
+split parent are in the split queue, split diamonds without split children
+are in the merge queue, so one queue item is enough for both. */
+struct SbROAMDiamond : public SbROAMQueueItem
+{
+  public:
+    /* Types. */
+    /// Flags of the diamond.
+    enum Flag
+    {
+      /// The center of the diamond is in the triangulation.
+      IS_SPLIT = 0x01,
+      /// Corner of the map, which is always split and is never queued.
+      IS_VIRTUAL = 0x02,
+      /// The diamond is in the split queue.
+      IS_SPLIT_QUEUED = 0x04,
+      /// The diamond is in the merge queue.
+      IS_MERGE_QUEUED = 0x08
+    };
+    /* Methods. */
+    /** Constructor.
+    Creates an unsplit diamond with zero metric. */
+    inline SbROAMDiamond();
+    /** Returns priority of the diamond.
+    \return Priority of the diamond in its queue. */
+    inline float getPriority() const;
+    /** Sets priority of the diamond.
+    The queue containing the diamond has to be updated by the caller.
+    \param priority New priority of the diamond. */
+    inline void setPriority(const float priority);
+    /* Data members. */
+    /// Error of the diamond and of all its descendants.
+    float error;
+    /// Radius of the sphere around the center bounding the diamond and all
+    /// its descendants.
+    float radius;
+    /// Number of split children.
+    unsigned char split_child_count;
+    /// Combination of the ::SbROAMDiamond::Flag values.
+    unsigned char flags;
+};
+
+/** Diamonds of a height map.
+Holds the diamond of each vertex of a height map of size 2^n + 1 in one array
+indexed as the vertices. A diamond with the center [x, y] has the scale h,
+the lowest set bit of x | y. If both x / h and y / h are odd, the diamond
+is a square one with the hypotenuse on a diagonal, its parents are two of
+the corners [x +- h, y +- h] and its children are [x +- h, y] and
+[x, y +- h]. Otherwise it is an edge one with horizontal or vertical
+hypotenuse of length 2h, its parents are the vertices at distance h across
+the hypotenuse and its children are [x +- h / 2, y +- h / 2]. Edge diamonds
+of scale 1 have no children, their split produces the triangles of the
+finest level. */
+class SbROAMDiamondTree
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates diamonds of the height map \p coords with unsplit diamonds and
+    split virtual corners. The metric is computed by
+    ::SbROAMDiamondTree::build.
+    \param coords Vertices of the height map.
+    \param map_size Size of the side of the height map. */
+    SbROAMDiamondTree(const SbVec3f * coords, const int map_size);
+    /** Destructor.
+    Releases the diamonds. */
+    ~SbROAMDiamondTree();
+    /** Computes the metric.
+    Computes errors and radii of all diamonds from the finest to the
+    coarsest scale. */
+    void build();
+    /** Returns a diamond.
+    \param index Index of the center of the diamond in the height map.
+    \return Diamond with the center \p index. */
+    inline SbROAMDiamond & operator[](const int index);
+    /** Returns index of a diamond.
+    \param diamond Diamond of the tree.
+    \return Index of the center of the diamond \p diamond. */
+    inline int getIndex(const SbROAMDiamond * diamond) const;
+    /** Returns the root diamond.
+    \return Index of the center of the map. */
+    inline int getRoot() const;
+    /** Returns size of the map.
+    \return Size of the side of the height map. */
+    inline int getMapSize() const;
+    /** Tests a diamond of the finest level.
+    \param index Index of the center of the diamond.
+    \return \p TRUE if the diamond has no children. */
+    inline SbBool isFinest(const int index) const;
+    /** Returns the hypotenuse of a diamond.
+    \param index Index of the center of the diamond.
+    \param first Index of the first end of the hypotenuse.
+    \param second Index of the second end of the hypotenuse. */
+    inline void getHypotenuse(const int index, int & first, int & second)
+      const;
+    /** Returns parents of a diamond.
+    Parents outside of the map are left out, the corners of the map are
+    returned as virtual parents of the root.
+    \param index Index of the center of the diamond.
+    \param parents Indices of the parents.
+    \return Number of the parents, 1 or 2. */
+    inline int getParents(const int index, int parents[2]) const;
+    /** Returns children of a diamond.
+    Children outside of the map are left out.
+    \param index Index of the center of the diamond.
+    \param children Indices of the children.
+    \return Number of the children, 0 to 4. */
+    inline int getChildren(const int index, int children[4]) const;
+  private:
+    /* Methods. */
+    /** Computes the metric of a diamond.
+    Children of the diamond have to be computed already.
+    \param index Index of the center of the diamond. */
+    void computeMetric(const int index);
+    /* Data members. */
+    /// Vertices of the height map.
+    const SbVec3f * coords;
+    /// Size of the side of the height map.
+    int map_size;
+    /// Diamonds of all vertices.
+    SbROAMDiamond * diamonds;
+};
+
+/******************************************************************************
+* SbROAMDiamond - public
+******************************************************************************/
+
+inline SbROAMDiamond::SbROAMDiamond():
+  SbROAMQueueItem(PRIORITY_MIN), error(0.0f), radius(0.0f),
+  split_child_count(0), flags(0)
+{
+  // nic
+}
+
+inline float SbROAMDiamond::getPriority() const
+{
+  return priority;
+}
+
+inline void SbROAMDiamond::setPriority(const float _priority)
+{
+  priority = _priority;
+}
+
+/******************************************************************************
+* SbROAMDiamondTree - public
+******************************************************************************/
+
+inline SbROAMDiamond & SbROAMDiamondTree::operator[](const int index)
+{
+  return diamonds[index];
+}
+
+inline int SbROAMDiamondTree::getIndex(const SbROAMDiamond * diamond)
+  const
+{
+  return static_cast<int>(diamond - diamonds);
+}
+
+inline int SbROAMDiamondTree::getRoot() const
+{
+  return (map_size * map_size) >> 1;
+}
+
+inline int SbROAMDiamondTree::getMapSize() const
+{
+  return map_size;
+}
+
+inline SbBool SbROAMDiamondTree::isFinest(const int index) const
+{
+  /* Vertices with an odd coordinate are centers of scale 1, only the edge
+  ones have an even coordinate. */
+  int x = index % map_size;
+  int y = index / map_size;
+  return ((x ^ y) & 1) != 0;
+}
+
+inline void SbROAMDiamondTree::getHypotenuse(const int index, int & first,
+  int & second) const
+{
+  int x = index % map_size;
+  int y = index / map_size;
+  int scale = (x | y) & -(x | y);
+  int x_odd = (x / scale) & 1;
+  int y_odd = (y / scale) & 1;
+  if (x_odd && y_odd)
+  {
+    /* Diagonal between the corners with equal parity in units of the
+    parent scale. */
+    int sign = ((((x - scale) / (scale << 1)) ^ ((y - scale) /
+      (scale << 1))) & 1) ? -1 : 1;
+    first = (y - scale) * map_size + x - sign * scale;
+    second = (y + scale) * map_size + x + sign * scale;
+  }
+  else if (x_odd)
+  {
+    first = index - scale;
+    second = index + scale;
+  }
+  else
+  {
+    first = index - scale * map_size;
+    second = index + scale * map_size;
+  }
+}
+
+inline int SbROAMDiamondTree::getParents(const int index, int parents[2])
+  const
+{
+  int x = index % map_size;
+  int y = index / map_size;
+  int scale = (x | y) & -(x | y);
+  int x_odd = (x / scale) & 1;
+  int y_odd = (y / scale) & 1;
+  if (x_odd && y_odd)
+  {
+    /* Corners with different parity in units of the parent scale. */
+    int sign = ((((x - scale) / (scale << 1)) ^ ((y - scale) /
+      (scale << 1))) & 1) ? 1 : -1;
+    parents[0] = (y - scale) * map_size + x - sign * scale;
+    parents[1] = (y + scale) * map_size + x + sign * scale;
+    return 2;
+  }
+
+  /* Vertices across the hypotenuse inside of the map. */
+  int step = x_odd ? scale * map_size : scale;
+  int coord = x_odd ? y : x;
+  int count = 0;
+  if (coord >= scale)
+  {
+    parents[count++] = index - step;
+  }
+  if (coord + scale < map_size)
+  {
+    parents[count++] = index + step;
+  }
+  return count;
+}
+
+inline int SbROAMDiamondTree::getChildren(const int index, int children[4])
+  const
+{
+  int x = index % map_size;
+  int y = index / map_size;
+  int scale = (x | y) & -(x | y);
+  if (((x / scale) & 1) && ((y / scale) & 1))
+  {
+    children[0] = index - scale;
+    children[1] = index + scale;
+    children[2] = index - scale * map_size;
+    children[3] = index + scale * map_size;
+    return 4;
+  }
+
+  /* Centers of the square diamonds of the half scale inside of the map. */
+  int half = scale >> 1;
+  int count = 0;
+  if (half == 0)
+  {
+    return 0;
+  }
+  for (int dy = -half; dy <= half; dy += scale)
+  {
+    for (int dx = -half; dx <= half; dx += scale)
+    {
+      if ((x + dx >= 0) && (x + dx < map_size) && (y + dy >= 0) &&
+        (y + dy < map_size))
+      {
+        children[count++] = index + dy * map_size + dx;
+      }
+    }
+  }
+  return count;
+}
+
+#endif
@@ -31,6 +31,7 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <Inventor/SbBasic.h>
 #include <Inventor/SbHeap.h>
 
 struct SbROAMSplitQueueTriangle;
@@ -41,31 +42,42 @@ Do t�o prioritn�fronty se vkl�aj�diamanty, kter�lze spojit na dva
 trojheln�y a t� dva trojheln�y z pvodn�h �y z triangulace odstranit.
 Toto se prov��tehdy, pokud je teba triangulaci zjednoduit a to tak, e
 se vyjme diamant s minim�n�prioritou, spoj�se a vloi se zp� p�adn�vznikl�nov�diamanty. */
-class SbROAMMergeQueue : protected SbHeap
+class SbROAMMergeQueue
 {
   public:
+    /* Types. */
+    /// Backend of the queue.
+    enum Type
+    {
+      /// Binary heap from Coin, O(log n) operations.
+      HEAP,
+      /// Quantized priority buckets, O(1) operations.
+      BUCKETS
+    };
     /* Metody. */
-    /** Konstruktor.
-    Vytvo�instanci t�y ::SbROAMMergeQueue o po�te��velikosti
-    \p init_size poloek. Prioritn�fronta se sama podle poteb zv�uje.
-    \param init_size Po�te��velikost prioritn�fronty trojheln�
-    na rozd�en�  */
-    SbROAMMergeQueue(const int init_size = 4096);
+    /** Creates a queue.
+    Creates an empty merge queue with the backend \p type.
+    \param type Backend of the queue.
+    \return New merge queue. */
+    static SbROAMMergeQueue * create(const Type type);
     /** Destruktor.
     Zru�instanci t�y ::SbROAMMergeQueue. */
-    ~SbROAMMergeQueue();
+    virtual ~SbROAMMergeQueue();
+    /** Returns the backend of the queue.
+    \return Backend of the queue. */
+    virtual Type getType() const = 0;
     /** Vypr�dn�prioritn�frontu.
     Zavol�� t�o metody dojde k vypr�dn��prioritn�fronty diamant na
     spojen� */
-    void emptyQueue();
+    virtual void emptyQueue() = 0;
     /** Vloen�diamantu do fronty.
     Vlo�diamant \p diamond do prioritn�fronty diamant na spojen�
     \param diamond Diamant, kter se m�do fronty vloit. */
-    void add(SbROAMMergeQueueDiamond * diamond);
+    virtual void add(SbROAMMergeQueueDiamond * diamond) = 0;
     /** Odstran�diamant z fronty.
     Odstran�diamant \p diamond z prioritn�fronty diamant.
     \param diamond Diamant, kter se m�z fronty odstranit. */
-    void remove(SbROAMMergeQueueDiamond * diamond);
+    virtual void remove(SbROAMMergeQueueDiamond * diamond) = 0;
     /** Odstran�diamant z fronty podle jeho trojheln�u.
     Najde ve front�diamant na spojen�diamant, jen obsahuje trojheln�
     \p triangle, vyjme ho z fronty a vr��na n� ukazatel.
@@ -76,18 +88,55 @@ class SbROAMMergeQueue : protected SbHeap
     Odstran�z prioritn�fronty diamant na spojen�trojheln� s
     nejni�prioritou a vr��ukazatel na n�.
     \return Ukazatel na diamant s nejni�prioritou. */
-    SbROAMMergeQueueDiamond * extractMin();
+    virtual SbROAMMergeQueueDiamond * extractMin() = 0;
     /** Vr��diamant z fronty.
     Vr��ukazatel na diamant s nejni�prioritou ve front� Diamant ve front�    nad�e zst��
     \return Ukazatel na diamant s nejni�prioritou. */
-    SbROAMMergeQueueDiamond * getMin();
+    virtual SbROAMMergeQueueDiamond * getMin() = 0;
     /** Vr��diamant z fronty podle indexu.
     Vr��ukazatel na diamant na indexu \p index v prioritn�front�diamant.
     \return Ukazatel na trojheln� na indexu \p index. */
-    SbROAMMergeQueueDiamond * operator[](const int index);
-    using SbHeap::size;
-    using SbHeap::newWeight;
-    using SbHeap::buildHeap;
+    virtual SbROAMMergeQueueDiamond * operator[](const int index) = 0;
+    /** Returns size of the queue.
+    \return Number of diamonds in the queue. */
+    virtual int size() const = 0;
+    /** Updates position of a diamond.
+    Moves the diamond \p diamond to the right place after change of its
+    priority.
+    \param diamond Diamond with changed priority. */
+    virtual void update(SbROAMMergeQueueDiamond * diamond) = 0;
+    /** Rebuilds the queue.
+    Restores the order of the whole queue after the priorities of many
+    diamonds changed. */
+    virtual void rebuild() = 0;
+};
+
+/** Merge queue on top of the Coin binary heap.
+Every operation of the queue costs O(log n), rebuild of the queue costs
+O(n). */
+class SbROAMHeapMergeQueue : public SbROAMMergeQueue, protected SbHeap
+{
+  public:
+    /* Methods. */
+    /** Konstruktor.
+    Vytvo�instanci t�y ::SbROAMMergeQueue o po�te��velikosti
+    \p init_size poloek. Prioritn�fronta se sama podle poteb zv�uje.
+    \param init_size Po�te��velikost prioritn�fronty trojheln�
+    na rozd�en�  */
+    SbROAMHeapMergeQueue(const int init_size = 4096);
+    /** Destructor. */
+    virtual ~SbROAMHeapMergeQueue();
+    virtual Type getType() const;
+    virtual void emptyQueue();
+    virtual void add(SbROAMMergeQueueDiamond * diamond);
+    using SbROAMMergeQueue::remove;
+    virtual void remove(SbROAMMergeQueueDiamond * diamond);
+    virtual SbROAMMergeQueueDiamond * extractMin();
+    virtual SbROAMMergeQueueDiamond * getMin();
+    virtual SbROAMMergeQueueDiamond * operator[](const int index);
+    virtual int size() const;
+    virtual void update(SbROAMMergeQueueDiamond * diamond);
+    virtual void rebuild();
   protected:
     /* Metody. */
     /** Vr��prioritu diamantu.
@@ -109,7 +158,6 @@ class SbROAMMergeQueue : protected SbHeap
     /* Datove polozky. */
     /// Struktura callback obsahuj��metody pro pr�i s diamanty.
     static SbHeapFuncs heap_funcs;
-  private:
 };
 
 #endif
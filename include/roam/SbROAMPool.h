@@ -0,0 +1,221 @@
+#ifndef SB_ROAM_POOL_H
+#define SB_ROAM_POOL_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Slab allocator for the dynamic ROAM primitives.
+/// \file SbROAMPool.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// Every split and merge of the ROAM triangulation creates and destroys
+/// ::SbROAMSplitQueueTriangle and ::SbROAMMergeQueueDiamond instances. The
+/// ::SbROAMPool template hands them out from large slabs and recycles freed
+/// ones through an intrusive free list, so the refinement loop does not touch
+/// the global heap once the pool is warmed up.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/system/inttypes.h>
+
+// standard includes
+#include <new>
+
+/** Pool of fixed size objects.
+Allocates objects of type \p Type from slabs of \p slab_size items. Slabs are
+never moved nor released before the pool is destroyed, so the addresses of the
+allocated objects are stable. Freed objects are kept in a free list and reused
+by subsequent allocations. The pool counts allocations, frees and slab
+allocations, so that it is possible to check that the steady state of the
+triangulation does not call the global allocator at all. The counters are
+64-bit, so they do not overflow in long runs. Only trivially
+destructible types can be stored in the pool. */
+template <class Type> class SbROAMPool
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates an empty pool, which will allocate slabs of \p slab_size objects.
+    \param slab_size Number of objects in one slab. */
+    SbROAMPool(const int slab_size = 1024);
+    /** Destructor.
+    Releases all slabs of the pool. Objects allocated from the pool are
+    invalidated. */
+    ~SbROAMPool();
+    /** Allocates memory for one object.
+    Returns uninitialized memory for one object of type \p Type. Use
+    placement new to construct the object.
+    \return Pointer to the memory for the object. */
+    inline void * allocate();
+    /** Returns an object to the pool.
+    The object \p object is returned to the free list of the pool. Passing
+    \p NULL is allowed and does nothing.
+    \param object Object allocated from this pool. */
+    inline void free(Type * object);
+    /** Returns all objects to the pool.
+    All allocated objects are put back to the free list at once. Slabs are
+    kept for later use. */
+    void clear();
+    /** Returns number of allocations.
+    \return Number of objects allocated from the pool since its creation. */
+    inline uint64_t getAllocationCount() const;
+    /** Returns number of frees.
+    \return Number of objects returned to the pool since its creation. */
+    inline uint64_t getFreeCount() const;
+    /** Returns number of slabs.
+    Each slab corresponds to one call of the global allocator.
+    \return Number of slabs allocated by the pool. */
+    inline int getSlabCount() const;
+    /** Returns number of used objects.
+    \return Number of objects currently allocated from the pool. */
+    inline int getUsedCount() const;
+  private:
+    /** Free list item.
+    A free object slot reuses its storage as a link of the free list. */
+    union SbROAMPoolNode
+    {
+      /// Next free slot.
+      SbROAMPoolNode * next;
+      /// Storage of one object.
+      char data[sizeof(Type)];
+      /// Ensures alignment of the object storage.
+      double align;
+    };
+    /* Methods. */
+    /** Allocates a new slab.
+    Allocates a new slab and puts all its slots to the free list. */
+    void allocateSlab();
+    /* Data members. */
+    /// Allocated slabs.
+    SbList<SbROAMPoolNode *> slabs;
+    /// First free slot.
+    SbROAMPoolNode * free_list;
+    /// Number of objects in one slab.
+    int slab_size;
+    /// Number of allocations.
+    uint64_t allocation_count;
+    /// Number of frees.
+    uint64_t free_count;
+};
+
+/******************************************************************************
+* SbROAMPool - public
+******************************************************************************/
+
+template <class Type> SbROAMPool<Type>::SbROAMPool(const int _slab_size):
+  slabs(), free_list(NULL), slab_size(_slab_size), allocation_count(0),
+  free_count(0)
+{
+  // nic
+}
+
+template <class Type> SbROAMPool<Type>::~SbROAMPool()
+{
+  /* Release all slabs. */
+  for (int I = 0; I < slabs.getLength(); ++I)
+  {
+    delete[] slabs[I];
+  }
+}
+
+template <class Type> inline void * SbROAMPool<Type>::allocate()
+{
+  /* Allocate a new slab if there is no free slot. */
+  if (free_list == NULL)
+  {
+    allocateSlab();
+  }
+
+  /* Take the first free slot from the list. */
+  SbROAMPoolNode * node = free_list;
+  free_list = node->next;
+  ++allocation_count;
+  return node->data;
+}
+
+template <class Type> inline void SbROAMPool<Type>::free(Type * object)
+{
+  if (object != NULL)
+  {
+    /* Return the slot to the free list. */
+    SbROAMPoolNode * node = reinterpret_cast<SbROAMPoolNode *>(object);
+    node->next = free_list;
+    free_list = node;
+    ++free_count;
+  }
+}
+
+template <class Type> void SbROAMPool<Type>::clear()
+{
+  /* All slots of all slabs are free again. */
+  free_list = NULL;
+  for (int I = 0; I < slabs.getLength(); ++I)
+  {
+    SbROAMPoolNode * slab = slabs[I];
+    for (int J = 0; J < slab_size; ++J)
+    {
+      slab[J].next = free_list;
+      free_list = &slab[J];
+    }
+  }
+  free_count = allocation_count;
+}
+
+template <class Type> inline uint64_t SbROAMPool<Type>::getAllocationCount()
+  const
+{
+  return allocation_count;
+}
+
+template <class Type> inline uint64_t SbROAMPool<Type>::getFreeCount() const
+{
+  return free_count;
+}
+
+template <class Type> inline int SbROAMPool<Type>::getSlabCount() const
+{
+  return slabs.getLength();
+}
+
+template <class Type> inline int SbROAMPool<Type>::getUsedCount() const
+{
+  return static_cast<int>(allocation_count - free_count);
+}
+
+/******************************************************************************
+* SbROAMPool - private
+******************************************************************************/
+
+template <class Type> void SbROAMPool<Type>::allocateSlab()
+{
+  /* Allocate a new slab and put its slots to the free list in the order
+  in which they lie in memory. */
+  SbROAMPoolNode * slab = new SbROAMPoolNode[slab_size];
+  for (int I = slab_size - 1; I >= 0; --I)
+  {
+    slab[I].next = free_list;
+    free_list = &slab[I];
+  }
+  slabs.append(slab);
+}
+
+#endif
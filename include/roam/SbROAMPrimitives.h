@@ -37,6 +37,10 @@
 // OpenInventor includy
 #include <Inventor/SbVec3f.h>
 #include <Inventor/SbHeap.h>
+#include <Inventor/system/inttypes.h>
+
+// standardni includy
+#include <cstring>
 
 // lokalni includy
 #include <debug.h>
@@ -58,9 +62,11 @@ struct SbROAMTriangle
     \param second Druh (prav) vrchol pepony trojheln�u.
     \param apex Prav (nad peponou) vrchol trojheln�u.
     \param level �ove� na kter�se trojheln� nach��v bin�n� stromu
-       trojheln�. */
+       trojheln�.
+    \param index Index of the triangle in the implicit binary triangle
+      tree. */
     SbROAMTriangle(int first = -1, int second = -1, int apex = -1,
-      int level = 0);
+      int level = 0, int index = 0);
     /* Datove polozky. */
     /// Lev vrchol pepony.
     int first;
@@ -70,24 +76,259 @@ struct SbROAMTriangle
     int apex;
     /// �ove�trojheln�u ve stromu.
     int level;
+    /// Index of the triangle in the implicit binary triangle tree.
+    int index;
     /// Chyba nezavisl�na bodu pohledu.
     float error;
     /// Polom� kuloplochy ohrani�j��trojheln� a jeho potomky.
     float radius;
 };
 
+/** Quantized metric of one triangle of the binary triangle tree.
+Both values are stored as the upper half of their IEEE single precision
+representation rounded up, so the decoded values are never smaller than the
+exact ones. */
+struct SbROAMTriangleMetric
+{
+  public:
+    /// Quantized error of the triangle.
+    unsigned short error;
+    /// Quantized radius of the sphere bounding the triangle and its children.
+    unsigned short radius;
+};
+
+/** Implicit binary triangle tree of the ROAM algorithm.
+The vertices, the level and the neighbours of a triangle are not stored,
+they are derived from the index of the triangle in the tree. Children of the
+triangle with index \p i have indices \p 2i+1 and \p 2i+2, the two roots have
+indices 1 and 2. Only the quantized error and radius are stored for each
+triangle. The bottom levels of the tree can be culled: their metric is not
+stored and it is computed from the heightmap when it is needed. */
+class SbROAMTriangleTree
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates the tree for the heightmap \p coords of size \p map_size. The
+    metric has to be built by ::build or loaded from a cache file by
+    ::load.
+    \param coords Vertices of the heightmap.
+    \param map_size Size of the side of the heightmap, must be 2^n + 1.
+    \param culled_levels Number of bottom levels without stored metric. */
+    SbROAMTriangleTree(const SbVec3f * coords, const int map_size,
+      const int culled_levels = 0);
+    /** Destructor.
+    Releases the storage of the metric. */
+    ~SbROAMTriangleTree();
+    /** Returns a root of the tree.
+    Fills the vertices, the level and the index of the root with index
+    \p index to \p triangle. The metric is not loaded.
+    \param index Index of the root, 1 or 2.
+    \param triangle Returned root triangle. */
+    void getRoot(const int index, SbROAMTriangle & triangle) const;
+    /** Returns children of a triangle.
+    Derives the vertices, the level and the index of both children of
+    \p parent. The metric is not loaded.
+    \param parent Parent triangle.
+    \param left_child Returned left child.
+    \param right_child Returned right child. */
+    inline void getChildren(const SbROAMTriangle & parent, SbROAMTriangle &
+      left_child, SbROAMTriangle & right_child) const;
+    /** Returns parent of a triangle.
+    Derives the vertices, the level and the index of the parent of
+    \p child. The metric is not loaded.
+    \param child Child triangle, must not be a root.
+    \param parent Returned parent triangle. */
+    inline void getParent(const SbROAMTriangle & child, SbROAMTriangle &
+      parent) const;
+    /** Returns a triangle by its index.
+    Derives the vertices and the level of the triangle with index \p index
+    by walking from its root and loads its metric.
+    \param index Index of the triangle.
+    \param triangle Returned triangle. */
+    void getTriangle(const int index, SbROAMTriangle & triangle) const;
+    /** Loads metric of a triangle.
+    Sets the error and the radius of \p triangle from the storage or
+    computes them, if the triangle lies in culled levels.
+    \param triangle Triangle with valid vertices, level and index. */
+    inline void loadMetric(SbROAMTriangle & triangle) const;
+    /** Computes metric of a triangle.
+    Computes the error and the radius of \p triangle from the metric of its
+    children. The result is quantized the same way as stored values.
+    \param triangle Triangle with valid vertices, level and index. */
+    void computeMetric(SbROAMTriangle & triangle) const;
+    /** Stores metric of a triangle.
+    Stores the quantized error and radius of \p triangle. The triangle must
+    not lie in culled levels.
+    \param triangle Triangle with computed metric. */
+    inline void storeMetric(const SbROAMTriangle & triangle);
+    /** Builds metric of the tree.
+    Computes and stores the metric of all stored triangles bottom up. Subtrees
+    below a split level are built in parallel by \p thread_count threads,
+    the levels above them are built afterwards. Every triangle is computed
+    from the quantized metric of its children, so the result does not depend
+    on the number of threads.
+    \param thread_count Number of threads, 0 means number of processors. */
+    void build(const int thread_count = 0);
+    /** Returns hash of the heightmap.
+    Computes a 64-bit hash of the vertices of the heightmap, which identifies
+    the heightmap in cache files. The hash is computed only once.
+    \return Hash of the heightmap. */
+    uint64_t getHash() const;
+    /** Loads metric of the tree from a cache file.
+    Checks that the file \p filename was saved for the same heightmap, size
+    and number of stored levels. On POSIX systems the file is mapped to
+    memory read-only, so that all processes using the same file share its
+    pages, elsewhere it is read. Metric of a loaded tree must not be built
+    nor stored again.
+    \param filename Name of the cache file.
+    \return \p TRUE if the metric was loaded. */
+    SbBool load(const char * filename);
+    /** Saves metric of the tree to a cache file.
+    Writes a versioned header and the stored metric to a temporary file and
+    renames it to \p filename, so that other processes never see a partially
+    written file.
+    \param filename Name of the cache file.
+    \return \p TRUE if the metric was saved. */
+    SbBool save(const char * filename) const;
+    /** Returns number of levels.
+    \return Level of the deepest triangles of the tree. */
+    inline int getLevel() const;
+    /** Returns number of stored levels.
+    \return Level of the deepest triangles with stored metric. */
+    inline int getStoredLevel() const;
+    /** Returns size of the storage.
+    \return Number of triangles with stored metric. */
+    inline int getSize() const;
+    /** Quantizes a value.
+    Converts non-negative \p value to its 16-bit representation rounded up.
+    \param value Quantized value.
+    \return Quantized representation of \p value. */
+    static inline unsigned short encode(const float value);
+    /** Restores a quantized value.
+    \param value Quantized representation.
+    \return Restored value. */
+    static inline float decode(const unsigned short value);
+  private:
+    /** Header of the cache file. */
+    struct SbROAMTreeCacheHeader
+    {
+      /// Identification of the file format.
+      char magic[8];
+      /// Version of the file format.
+      uint32_t version;
+      /// Size of the side of the heightmap.
+      uint32_t map_size;
+      /// Hash of the heightmap.
+      uint64_t hash;
+      /// Level of the deepest triangles.
+      uint32_t level;
+      /// Level of the deepest triangles with stored metric.
+      uint32_t stored_level;
+      /// Number of triangles with stored metric.
+      uint32_t count;
+      /// Size of the metric of one triangle.
+      uint32_t metric_size;
+    };
+    /** Task of the parallel build. */
+    struct SbROAMBuildTask
+    {
+      /// Built tree.
+      SbROAMTriangleTree * tree;
+      /// Root of the built subtree.
+      SbROAMTriangle root;
+    };
+    /* Methods. */
+    /** Builds metric of a subtree.
+    Computes and stores the metric of the subtree of \p root down to the
+    level \p bottom_level in post-order without recursion. Metric of the
+    children of the triangles at \p bottom_level must be available.
+    \param root Root of the subtree.
+    \param bottom_level Level of the deepest built triangles. */
+    void buildSubtree(const SbROAMTriangle & root, const int bottom_level);
+    /** Function of the parallel build task.
+    \param task Pointer to a ::SbROAMBuildTask instance. */
+    static void buildTask(void * task);
+    /** Fills header of the cache file.
+    \param header Header describing this tree. */
+    void fillHeader(SbROAMTreeCacheHeader & header) const;
+    /** Releases storage of the metric.
+    Unmaps the mapped cache file or deletes the allocated storage. */
+    void releaseMetrics();
+    /* Data members. */
+    /// Vertices of the heightmap.
+    const SbVec3f * coords;
+    /// Size of the side of the heightmap.
+    int map_size;
+    /// Level of the deepest triangles.
+    int level;
+    /// Level of the deepest triangles with stored metric.
+    int stored_level;
+    /// Number of triangles with stored metric.
+    int size;
+    /// Stored metric of the triangles.
+    SbROAMTriangleMetric * metrics;
+    /// Mapped cache file with the metric or \p NULL.
+    void * mapping;
+    /// Size of the mapped cache file.
+    size_t mapping_size;
+    /// Hash of the heightmap.
+    mutable uint64_t hash;
+    /// Flag of the computed hash.
+    mutable SbBool is_hash;
+    /* Constants. */
+    /// Version of the cache file format.
+    static const uint32_t CACHE_VERSION;
+};
+
 /// Trojheln�y s touto prioritou jsou zobrazeny vdy.
 const float PRIORITY_MAX = 1e38f;
 /// Trojheln�y s touto prioritou se nezobrazuj�(teoreticky).
 const float PRIORITY_MIN = 0.0f;
 
+/** Item of the ROAM priority queues.
+Common base of the triangles in the split queue and the diamonds in the merge
+queue. Holds the priority of the item and the bookkeeping of the queue which
+contains the item, so that both queue backends can work with the same
+objects. */
+struct SbROAMQueueItem
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates an item with the priority \p priority, which is not in any
+    queue.
+    \param priority Priority of the item. */
+    inline SbROAMQueueItem(const float priority);
+  private:
+    /* Data members. */
+    /// Priority of the item in the queue.
+    float priority;
+    /// Index of the item in the queue.
+    int index;
+    /// Bucket of the item in the bucketed queue.
+    int bucket;
+    /// Previous item in the same bucket of the bucketed queue.
+    SbROAMQueueItem * previous;
+    /// Next item in the same bucket of the bucketed queue.
+    SbROAMQueueItem * next;
+  /** Queues and queue items may access the private members of the item. */
+  friend struct SbROAMSplitQueueTriangle;
+  friend struct SbROAMMergeQueueDiamond;
+  friend struct SbROAMDiamond;
+  friend class SbROAMHeapSplitQueue;
+  friend class SbROAMHeapMergeQueue;
+  friend class SbROAMBucketQueue;
+};
+
 struct SbROAMMergeQueueDiamond;
 class SbROAMSplitQueue;
+class SoSimpleROAMTerrain;
 
 /** Reprezentace trojheln� algoritmu ROAM ve front�
 T�a reprezentuje jeden trojheln� v triangulaci. Roziuje trojheln�
 z bin�n�o stromu trojheln� o informace o sousedech a priorit�ve front� */
-struct SbROAMSplitQueueTriangle
+struct SbROAMSplitQueueTriangle : public SbROAMQueueItem
 {
   public:
     /* Metody. */
@@ -101,7 +342,7 @@ struct SbROAMSplitQueueTriangle
     \param right Prav soused trojheln�u.
     \param base Z�ladnov soused trojheln�u.
     \param diamond Diamant, do kter�o trojheln� pat� */
-    SbROAMSplitQueueTriangle(SbROAMTriangle * triangle,
+    SbROAMSplitQueueTriangle(const SbROAMTriangle & triangle,
       float priority = PRIORITY_MIN,
       SbROAMSplitQueueTriangle * left = NULL,
       SbROAMSplitQueueTriangle * right = NULL,
@@ -125,7 +366,7 @@ struct SbROAMSplitQueueTriangle
     inline void setPriority(const float priority);
     /* Datove polozky. */
     /// Trojheln� v bin�n� stromu trojheln�.
-    SbROAMTriangle * triangle;
+    SbROAMTriangle triangle;
     /// Soused nad levou odv�nou.
     SbROAMSplitQueueTriangle * left;
     /// Soused nad pravou odv�nou.
@@ -134,14 +375,23 @@ struct SbROAMSplitQueueTriangle
     SbROAMSplitQueueTriangle * base;
     /// Diamant, pod kter trojheln� pat�
     SbROAMMergeQueueDiamond * diamond;
+    /// Terrain patch whose binary triangle tree contains the triangle.
+    SoSimpleROAMTerrain * patch;
   private:
-    /// Priorita trojheln�u ve front�trojheln� na rozd�en�
-    float priority;
-    /// Index trojheln�u ve front�trojheln� na rozd�en�
-    int index;
-  /** Prioritn�fronta trojheln� na rozd�en�me pistupovat k priv�n�
-  atributm trojheln�u. */
-  friend class SbROAMSplitQueue;
+    /// Slot of the triangle in the queue of deferred recomputation.
+    int recompute_slot;
+    /// Index of the triangle in its slot of deferred recomputation.
+    int recompute_index;
+    /// Previous triangle of the triangulation in the order of the triangle
+    /// strips.
+    SbROAMSplitQueueTriangle * previous_leaf;
+    /// Next triangle of the triangulation in the order of the triangle
+    /// strips.
+    SbROAMSplitQueueTriangle * next_leaf;
+  /** Queue of deferred recomputation and triangle strips may access the
+  private members of the triangle. */
+  friend class SbROAMRecomputeQueue;
+  friend class SbROAMTriangleStrips;
 };
 
 class SbROAMMergeQueue;
@@ -150,7 +400,7 @@ class SbROAMMergeQueue;
 T�a pedstavuje diamant, tj. �yi trojhelniky, kter�lze slou�t
 na dva trojheln�y spojen�podstavou. T�to slou�n� mohou vzniknout
 dal�diamanty. */
-struct SbROAMMergeQueueDiamond
+struct SbROAMMergeQueueDiamond : public SbROAMQueueItem
 {
   public:
     /* Metody. */
@@ -191,40 +441,144 @@ struct SbROAMMergeQueueDiamond
     SbROAMSplitQueueTriangle * third;
     /// �vrt trojheln� diamantu.
     SbROAMSplitQueueTriangle * fourth;
-  private:
-    /// Priorita diamantu ve front�diamant na spojen�
-    float priority;
-    /// Index diamantu ve front�diamant na spojen�
-    int index;
-  /** Prioritn�fronta diamant na spojen�me pistupovat k priv�n�
-  atributm diamantu. */
-  friend class SbROAMMergeQueue;
 };
 
 #include <roam/SbROAMSplitQueue.h>
 #include <roam/SbROAMMergeQueue.h>
 
+/******************************************************************************
+* SbROAMTriangleTree - public
+******************************************************************************/
+
+inline void SbROAMTriangleTree::getChildren(const SbROAMTriangle & parent,
+  SbROAMTriangle & left_child, SbROAMTriangle & right_child) const
+{
+  /* Vrcholy leveho potomka. */
+  left_child.first = parent.apex;
+  left_child.second = parent.first;
+  left_child.apex = (parent.first + parent.second) >> 1;
+  left_child.level = parent.level + 1;
+  left_child.index = (parent.index << 1) + 1;
+
+  /* Vrcholy praveho potomka. */
+  right_child.first = parent.second;
+  right_child.second = parent.apex;
+  right_child.apex = left_child.apex;
+  right_child.level = left_child.level;
+  right_child.index = left_child.index + 1;
+}
+
+inline void SbROAMTriangleTree::getParent(const SbROAMTriangle & child,
+  SbROAMTriangle & parent) const
+{
+  /* Stred prepony otce je pravouhlym vrcholem potomka. */
+  if (child.index & 1) // levy potomek
+  {
+    parent.apex = child.first;
+    parent.first = child.second;
+    parent.second = (child.apex << 1) - parent.first;
+  }
+  else // pravy potomek
+  {
+    parent.second = child.first;
+    parent.apex = child.second;
+    parent.first = (child.apex << 1) - parent.second;
+  }
+  parent.level = child.level - 1;
+  parent.index = (child.index - 1) >> 1;
+}
+
+inline void SbROAMTriangleTree::loadMetric(SbROAMTriangle & triangle) const
+{
+  /* Metrika ulozenych trojuhelniku se cte, ostatnim se dopocita. */
+  if (triangle.level <= stored_level)
+  {
+    const SbROAMTriangleMetric & metric = metrics[triangle.index];
+    triangle.error = decode(metric.error);
+    triangle.radius = decode(metric.radius);
+  }
+  else
+  {
+    computeMetric(triangle);
+  }
+}
+
+inline void SbROAMTriangleTree::storeMetric(const SbROAMTriangle & triangle)
+{
+  /* Ulozeni kvantovane metriky. */
+  SbROAMTriangleMetric & metric = metrics[triangle.index];
+  metric.error = encode(triangle.error);
+  metric.radius = encode(triangle.radius);
+}
+
+inline int SbROAMTriangleTree::getLevel() const
+{
+  return level;
+}
+
+inline int SbROAMTriangleTree::getStoredLevel() const
+{
+  return stored_level;
+}
+
+inline int SbROAMTriangleTree::getSize() const
+{
+  return size;
+}
+
+inline unsigned short SbROAMTriangleTree::encode(const float value)
+{
+  /* Horni polovina IEEE reprezentace zaokrouhlena nahoru. */
+  unsigned int bits = 0;
+  memcpy(&bits, &value, sizeof(bits));
+  unsigned int result = bits >> 16;
+  if (bits & 0xffff)
+  {
+    ++result;
+  }
+  return static_cast<unsigned short>(result);
+}
+
+inline float SbROAMTriangleTree::decode(const unsigned short value)
+{
+  /* Doplneni dolni poloviny IEEE reprezentace nulami. */
+  unsigned int bits = static_cast<unsigned int>(value) << 16;
+  float result = 0.0f;
+  memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+/******************************************************************************
+* SbROAMQueueItem - public
+******************************************************************************/
+
+inline SbROAMQueueItem::SbROAMQueueItem(const float _priority):
+  priority(_priority), index(-1), bucket(-1), previous(NULL), next(NULL)
+{
+  // nic
+}
+
 /******************************************************************************
 * SbROAMSplitQueueTriangle - public
 ******************************************************************************/
 
 inline float SbROAMSplitQueueTriangle::getPriority() const
 {
-  return -priority; // hledame maximum, takze opacna hodnota priority
+  return priority; // vraceni priority
 }
 
 inline void SbROAMSplitQueueTriangle::setPriority(SbROAMSplitQueue *
   split_queue, const float _priority)
 {
   /* Nastaveni nove priority a opraveni fronty. */
-  priority = -_priority;
-  split_queue->newWeight(this, index);
+  priority = _priority;
+  split_queue->update(this);
 }
 
 inline void SbROAMSplitQueueTriangle::setPriority(const float _priority)
 {
   /* Nastaveni nove priority. */
-  priority = -_priority;
+  priority = _priority;
 }
 
 /******************************************************************************
@@ -241,7 +595,7 @@ inline void SbROAMMergeQueueDiamond::setPriority(SbROAMMergeQueue * merge_queue,
 {
   /* Nastaveni nove priority a opraveni fronty. */
   priority = _priority;
-  merge_queue->newWeight(this, index);
+  merge_queue->update(this);
 }
 
 inline void SbROAMMergeQueueDiamond::setPriority(const float _priority)
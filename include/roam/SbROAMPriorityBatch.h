@@ -0,0 +1,213 @@
+#ifndef SB_ROAM_PRIORITY_BATCH_H
+#define SB_ROAM_PRIORITY_BATCH_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Batched priority evaluation of the ROAM algorithm.
+/// \file SbROAMPriorityBatch.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// Priorities of many triangles are recomputed at once in every frame. The
+/// ::SbROAMPriorityBatch class gathers apices, radii and errors of the
+/// triangles to separate arrays and evaluates their priorities with a SSE or
+/// AVX2 kernel selected by the capabilities of the processor.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// OpenInventor includy
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbLinear.h>
+
+// standardni includy
+#include <cfloat>
+#include <cmath>
+
+/** Batch of priority evaluations.
+Holds the apex, the radius and the error of each triangle of the batch in
+separate arrays aligned for vector loads. ::SbROAMPriorityBatch::compute
+evaluates the priority \p lambda * error / (distance - radius) of all
+triangles, where distance is the distance of the camera from the apex.
+The ::SbROAMPriorityBatch::WEDGIE metric scales the error by the
+::SbROAMPriorityBatch::getWedgieFactor of the triangle. Triangles with the
+camera inside their sphere get ::PRIORITY_MAX. Culled triangles are passed
+with zero error, so they get ::PRIORITY_MIN. */
+class SbROAMPriorityBatch
+{
+  public:
+    /* Types. */
+    /// Implementations of the evaluation.
+    enum Kernel
+    {
+      /// Portable scalar code.
+      SCALAR,
+      /// Four triangles at once with SSE.
+      SSE,
+      /// Eight triangles at once with AVX2.
+      AVX2
+    };
+    /// Error metrics.
+    enum Metric
+    {
+      /// Error seen from the worst direction.
+      ISOTROPIC,
+      /// Vertical error projected to the view ray like the thickness of the
+      /// wedgie of the triangle.
+      WEDGIE
+    };
+    /* Methods. */
+    /** Constructor.
+    Creates an empty batch using the best kernel supported by the
+    processor. */
+    SbROAMPriorityBatch();
+    /** Destructor.
+    Releases the arrays of the batch. */
+    ~SbROAMPriorityBatch();
+    /** Resizes the batch.
+    Sets the number of triangles of the batch to \p count. Content of the
+    arrays is undefined after a resize.
+    \param count Number of triangles. */
+    void resize(const int count);
+    /** Sets a triangle of the batch.
+    \param index Index of the triangle in the batch.
+    \param apex Apex of the triangle.
+    \param radius Radius of the sphere bounding the triangle.
+    \param error Error of the triangle, zero for culled triangles. */
+    inline void set(const int index, const SbVec3f & apex,
+      const float radius, const float error);
+    /** Evaluates priorities of the batch.
+    \param camera Position of the camera.
+    \param lambda Number of pixels per radian of the field of view. */
+    void compute(const SbVec3f & camera, const float lambda);
+    /** Returns priority of a triangle.
+    \param index Index of the triangle in the batch.
+    \return Priority computed by the last ::SbROAMPriorityBatch::compute. */
+    inline float getPriority(const int index) const;
+    /** Returns number of triangles.
+    \return Number of triangles of the batch. */
+    inline int getCount() const;
+    /** Sets the kernel.
+    Kernels not supported by the processor are replaced with the best
+    supported one.
+    \param kernel Requested kernel. */
+    void setKernel(const Kernel kernel);
+    /** Returns the kernel.
+    \return Kernel used for the evaluation. */
+    Kernel getKernel() const;
+    /** Returns the best supported kernel.
+    \return Fastest kernel supported by the processor. */
+    static Kernel getBestKernel();
+    /** Sets the metric.
+    \param metric Error metric of the evaluation. */
+    void setMetric(const Metric metric);
+    /** Returns the metric.
+    \return Error metric of the evaluation. */
+    Metric getMetric() const;
+    /** Returns the wedgie factor.
+    A vertical segment seen under the angle \p t from the height axis is
+    shortened by sin \p t on the screen. The factor is the largest sine
+    over the view rays to the sphere of the triangle, so the scaled error
+    still bounds the projected thickness of its wedgie.
+    \param height Height of the camera above the apex.
+    \param distance Distance of the camera from the apex.
+    \param radius Radius of the sphere bounding the triangle.
+    \return Factor of the error from 0 to 1. */
+    static inline float getWedgieFactor(const float height,
+      const float distance, const float radius);
+  private:
+    /* Methods. */
+    /** Scalar evaluation.
+    Evaluates priorities of triangles from \p begin to \p end - 1. */
+    void computeScalar(const SbVec3f & camera, const float lambda,
+      const int begin, const int end);
+    /** SSE evaluation.
+    Evaluates priorities of groups of four triangles and returns the index
+    of the first triangle which was not evaluated. */
+    int computeSSE(const SbVec3f & camera, const float lambda);
+    /** AVX2 evaluation.
+    Evaluates priorities of groups of eight triangles and returns the index
+    of the first triangle which was not evaluated. */
+    int computeAVX2(const SbVec3f & camera, const float lambda);
+    /* Data members. */
+    /// Memory of all arrays.
+    float * memory;
+    /// X coordinates of the apices.
+    float * x;
+    /// Y coordinates of the apices.
+    float * y;
+    /// Z coordinates of the apices.
+    float * z;
+    /// Radii of the spheres.
+    float * radii;
+    /// Errors of the triangles.
+    float * errors;
+    /// Computed priorities.
+    float * priorities;
+    /// Number of triangles.
+    int count;
+    /// Number of triangles the arrays can hold.
+    int capacity;
+    /// Kernel used for the evaluation.
+    Kernel kernel;
+    /// Error metric of the evaluation.
+    Metric metric;
+};
+
+/******************************************************************************
+* SbROAMPriorityBatch - public
+******************************************************************************/
+
+inline void SbROAMPriorityBatch::set(const int index, const SbVec3f & apex,
+  const float radius, const float error)
+{
+  x[index] = apex[0];
+  y[index] = apex[1];
+  z[index] = apex[2];
+  radii[index] = radius;
+  errors[index] = error;
+}
+
+inline float SbROAMPriorityBatch::getPriority(const int index) const
+{
+  return priorities[index];
+}
+
+inline int SbROAMPriorityBatch::getCount() const
+{
+  return count;
+}
+
+inline float SbROAMPriorityBatch::getWedgieFactor(const float height,
+  const float distance, const float radius)
+{
+  /* Sine and cosine of the angle between the height axis and the ray to the
+  apex and of the angle under which the sphere is seen from the ray. */
+  float inverse = 1.0f / SbMax(distance, FLT_MIN);
+  float cos_view = SbMin(SbAbs(height) * inverse, 1.0f);
+  float sin_view = static_cast<float>(sqrt(1.0f - cos_view * cos_view));
+  float sin_sphere = SbMin(radius * inverse, 1.0f);
+  float cos_sphere = static_cast<float>(sqrt(1.0f - sin_sphere *
+    sin_sphere));
+
+  /* Sine of the sum of the angles, a right angle or more gives one. */
+  return (cos_view * cos_sphere <= sin_view * sin_sphere) ? 1.0f :
+    sin_view * cos_sphere + cos_view * sin_sphere;
+}
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef SB_ROAM_RECOMPUTE_QUEUE_H
+#define SB_ROAM_RECOMPUTE_QUEUE_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Queue of deferred priority recomputation of the ROAM algorithm.
+/// \file SbROAMRecomputeQueue.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// When the speed of the camera is limited, the priority of a triangle can
+/// not cross the split/merge threshold sooner than after a number of frames
+/// given by its distance from the threshold. The queue keeps every triangle
+/// of the triangulation in the slot of the frame in which its priority has
+/// to be recomputed, so that only a small part of the triangulation is
+/// recomputed in every frame.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// OpenInventor includy
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+
+struct SbROAMSplitQueueTriangle;
+
+/** Queue of deferred priority recomputation.
+Ring of ::SbROAMRecomputeQueue::SLOT_COUNT frame slots. Each slot holds the
+triangles whose priority has to be recomputed in the corresponding frame.
+Triangles remember their slot and position in it, so that insertion and
+removal cost O(1). */
+class SbROAMRecomputeQueue
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates an empty queue. */
+    SbROAMRecomputeQueue();
+    /** Destructor. */
+    ~SbROAMRecomputeQueue();
+    /** Empties the queue.
+    Removes all triangles from the queue. */
+    void emptyQueue();
+    /** Schedules recomputation of a triangle.
+    Inserts the triangle \p triangle to the slot of the frame which follows
+    the current frame after \p delay frames. The delay is clamped to the
+    range from 1 to ::SbROAMRecomputeQueue::SLOT_COUNT - 1.
+    \param triangle Triangle, which is not in the queue.
+    \param delay Number of frames till the recomputation. */
+    void add(SbROAMSplitQueueTriangle * triangle, const int delay);
+    /** Removes a triangle from the queue.
+    Triangles which are not in the queue are ignored.
+    \param triangle Triangle to remove. */
+    void remove(SbROAMSplitQueueTriangle * triangle);
+    /** Moves the queue to the next frame.
+    Triangles in the slot of the new current frame are the ones which have
+    to be recomputed now. */
+    void nextFrame();
+    /** Extracts a triangle of the current frame.
+    \return Triangle from the slot of the current frame or \p NULL if the
+    slot is empty. */
+    SbROAMSplitQueueTriangle * extract();
+    /** Returns size of the queue.
+    \return Number of triangles in all slots of the queue. */
+    int size() const;
+    /* Data members. */
+    /// Number of the frame slots.
+    static const int SLOT_COUNT = 64;
+  private:
+    /* Data members. */
+    /// Triangles scheduled for the frames.
+    SbList<SbROAMSplitQueueTriangle *> slots[SLOT_COUNT];
+    /// Slot of the current frame.
+    int current;
+};
+
+#endif
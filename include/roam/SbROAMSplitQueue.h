@@ -30,6 +30,7 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 ///////////////////////////////////////////////////////////////////////////////
 
+#include <Inventor/SbBasic.h>
 #include <Inventor/SbHeap.h>
 
 struct SbROAMSplitQueueTriangle;
@@ -38,50 +39,96 @@ struct SbROAMSplitQueueTriangle;
 Do t�o prioritn�fronty se vkl�aj�trojheln�y, kter�je teba zaadit
 do triangulace. Pokud je teba triangulaci d�e zjem�vat, vyjme se z fronty
 trojheln� s maxim�n�prioritou a vlo�se zp� jeho potomci. */
-class SbROAMSplitQueue : protected SbHeap
+class SbROAMSplitQueue
 {
   public:
+    /* Types. */
+    /// Backend of the queue.
+    enum Type
+    {
+      /// Binary heap from Coin, O(log n) operations.
+      HEAP,
+      /// Quantized priority buckets, O(1) operations.
+      BUCKETS
+    };
     /* Metody. */
-    /** Konstruktor.
-    Vytvo�instanci t�y ::SbROAMSplitQueue o po�te��velikosti
-    \p init_size poloek. Prioritn�fronta se sama podle poteb zv�uje.
-    \param init_size Po�te��velikost prioritn�fronty trojheln�
-    na rozd�en�  */
-    SbROAMSplitQueue(const int init_size = 1024);
+    /** Creates a queue.
+    Creates an empty split queue with the backend \p type.
+    \param type Backend of the queue.
+    \return New split queue. */
+    static SbROAMSplitQueue * create(const Type type);
     /** Destruktor.
     Zru�instanci t�y ::SbROAMSplitQueue. */
-    ~SbROAMSplitQueue();
+    virtual ~SbROAMSplitQueue();
+    /** Returns the backend of the queue.
+    \return Backend of the queue. */
+    virtual Type getType() const = 0;
     /** Vypr�dn�prioritn�frontu.
     Zavol�� t�o metody dojde k vypr�dn��prioritn�fronty trojheln�
     na rozd�en� */
-    void emptyQueue();
+    virtual void emptyQueue() = 0;
     /** Vlo�trojheln� do fronty.
     Vlo�trojheln� bin�n�o stromu trojheln� \p triangle do prioritn�    fronty trojheln� na rozd�en�
     \param triangle Trojheln�, kter se m�do fronty vloit. */
-    void add(SbROAMSplitQueueTriangle * triangle);
+    virtual void add(SbROAMSplitQueueTriangle * triangle) = 0;
     /** Odstran�trojheln� z fronty.
     Odstran�trojheln� \p triangle z prioritn�fronty trojheln�.
     \param triangle Trojheln�, kter se m�z fronty odstranit. */
-    void remove(SbROAMSplitQueueTriangle * triangle);
+    virtual void remove(SbROAMSplitQueueTriangle * triangle) = 0;
     /** Vyjme a vr��trojheln� z fronty.
     Odstran�z prioritn�fronty trojheln� na rozd�en�trojheln� s
     nejvy�prioritou a vr��ukazatel na n�.
     \return Ukazatel na trojheln� s nejvy�prioritou. */
-    SbROAMSplitQueueTriangle * extractMax();
+    virtual SbROAMSplitQueueTriangle * extractMax() = 0;
     /** Vr��trojheln� z fronty.
     Vr��ukazatel na trojheln� s nejvy�prioritou ve front� Trojheln�
     ve front�nad�e zst��
     \return Ukazatel na trojheln� s nejvy�prioritou. */
-    SbROAMSplitQueueTriangle * getMax();
+    virtual SbROAMSplitQueueTriangle * getMax() = 0;
     /** Vr��trojheln� z fronty podle indexu.
     Vr��ukazatel na trojheln� na indexu \p index v prioritn�front�    trojheln�.
     \return Ukazatel na trojheln� na indexu \p index. */
-    SbROAMSplitQueueTriangle * operator[](const int index);
-    /* Importovane metody. */
-    using SbHeap::size;
-    using SbHeap::newWeight;
-    using SbHeap::buildHeap;
- protected:
+    virtual SbROAMSplitQueueTriangle * operator[](const int index) = 0;
+    /** Returns size of the queue.
+    \return Number of triangles in the queue. */
+    virtual int size() const = 0;
+    /** Updates position of a triangle.
+    Moves the triangle \p triangle to the right place after change of its
+    priority.
+    \param triangle Triangle with changed priority. */
+    virtual void update(SbROAMSplitQueueTriangle * triangle) = 0;
+    /** Rebuilds the queue.
+    Restores the order of the whole queue after the priorities of many
+    triangles changed. */
+    virtual void rebuild() = 0;
+};
+
+/** Split queue on top of the Coin binary heap.
+Every operation of the queue costs O(log n), rebuild of the queue costs
+O(n). */
+class SbROAMHeapSplitQueue : public SbROAMSplitQueue, protected SbHeap
+{
+  public:
+    /* Methods. */
+    /** Konstruktor.
+    Vytvo�instanci t�y ::SbROAMSplitQueue o po�te��velikosti
+    \p init_size poloek. Prioritn�fronta se sama podle poteb zv�uje.
+    \param init_size Po�te��velikost prioritn�fronty trojheln�
+    na rozd�en�  */
+    SbROAMHeapSplitQueue(const int init_size = 1024);
+    /** Destructor. */
+    virtual ~SbROAMHeapSplitQueue();
+    virtual Type getType() const;
+    virtual void emptyQueue();
+    virtual void add(SbROAMSplitQueueTriangle * triangle);
+    virtual void remove(SbROAMSplitQueueTriangle * triangle);
+    virtual SbROAMSplitQueueTriangle * extractMax();
+    virtual SbROAMSplitQueueTriangle * getMax();
+    virtual SbROAMSplitQueueTriangle * operator[](const int index);
+    virtual int size() const;
+    virtual void update(SbROAMSplitQueueTriangle * triangle);
+    virtual void rebuild();
+  protected:
     /* Metody. */
     /** Vr��prioritu trojheln�u.
     Vr��prioritu trojheln�u \p triangle v prioritn�front�trojheln�
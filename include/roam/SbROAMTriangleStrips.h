@@ -0,0 +1,156 @@
+#ifndef SB_ROAM_TRIANGLE_STRIPS_H
+#define SB_ROAM_TRIANGLE_STRIPS_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Triangle strips of the ROAM triangulation.
+/// \file SbROAMTriangleStrips.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// Triangles of the binary triangle tree ordered by the Sierpinski curve form
+/// a sequence in which neighbouring triangles share an edge. The
+/// ::SbROAMTriangleStrips class keeps the triangles of the triangulation in
+/// this order and divides them to strips by subtrees of a fixed level of the
+/// tree. Splits and merges only mark their strips as changed, so only the
+/// changed strips are rebuilt for the next frame.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// OpenInventor includy
+#include <Inventor/SbBasic.h>
+#include <Inventor/lists/SbList.h>
+
+// OpenGL includy
+#if defined(__WIN32__) || defined(_WIN32)
+  #include <windows.h>
+#endif
+#include <GL/gl.h>
+
+struct SbROAMTriangle;
+struct SbROAMSplitQueueTriangle;
+
+/** Triangle strips of the ROAM triangulation.
+The triangles of the triangulation are linked in the order of the Sierpinski
+curve. Triangles of one subtree of the level ::STRIP_LEVEL form one strip,
+triangles above this level form a strip each. Vertex indices of every strip
+are cached and only strips changed by splits and merges are rebuilt. The
+strips are joined by degenerate triangles to one array drawn as
+\p GL_TRIANGLE_STRIP. */
+class SbROAMTriangleStrips
+{
+  public:
+    /* Methods. */
+    /** Constructor.
+    Creates empty strips. */
+    SbROAMTriangleStrips();
+    /** Destructor.
+    Releases the strips. */
+    ~SbROAMTriangleStrips();
+    /** Initializes the strips.
+    Creates strips for the tree with \p level levels and the triangulation
+    formed by the two roots of the tree.
+    \param level Level of the deepest triangles of the tree.
+    \param first_root Root with index 1.
+    \param second_root Root with index 2. */
+    void create(const int level, SbROAMSplitQueueTriangle * first_root,
+      SbROAMSplitQueueTriangle * second_root);
+    /** Replaces a triangle by its children.
+    \param parent Split triangle.
+    \param left_child Left child of \p parent.
+    \param right_child Right child of \p parent. */
+    void split(SbROAMSplitQueueTriangle * parent,
+      SbROAMSplitQueueTriangle * left_child,
+      SbROAMSplitQueueTriangle * right_child);
+    /** Replaces two children by their parent.
+    \param first_child One child of \p parent.
+    \param second_child The other child of \p parent.
+    \param parent Merged triangle. */
+    void merge(SbROAMSplitQueueTriangle * first_child,
+      SbROAMSplitQueueTriangle * second_child,
+      SbROAMSplitQueueTriangle * parent);
+    /** Updates vertex indices.
+    Rebuilds the changed strips and joins all strips to \p indices.
+    \param indices Vertex indices of the triangle strip. */
+    void update(SbList<GLuint> & indices);
+    /** Appends a triangle to a strip.
+    Continues the strip over the common edge with its last triangle, or
+    starts a new part of the strip joined by degenerate triangles. The
+    triangle keeps the orientation of its vertices \p first, \p apex and
+    \p second.
+    \param indices Vertex indices of the strip.
+    \param triangle Appended triangle.
+    \param next Triangle following \p triangle in the strip or \p NULL. */
+    static void appendTriangle(SbList<GLuint> & indices,
+      const SbROAMTriangle & triangle, const SbROAMTriangle * next);
+    /** Appends a strip to a strip.
+    Joins the strip \p strip to the end of \p indices by degenerate
+    triangles, which keep the orientation of its triangles.
+    \param indices Vertex indices of the joined strips.
+    \param strip Vertex indices of the appended strip. */
+    static void appendStrip(SbList<GLuint> & indices,
+      const SbList<GLuint> & strip);
+    /* Data members. */
+    /// Level of the roots of subtrees forming one strip.
+    static const int STRIP_LEVEL;
+  private:
+    /* Methods. */
+    /** Returns strip of a triangle.
+    \param triangle Triangle of the triangulation.
+    \return Index of the strip containing \p triangle. */
+    inline int getStrip(const SbROAMSplitQueueTriangle * triangle) const;
+    /** Replaces triangles in the order of the strips.
+    Links the \p new_count triangles \p new_triangles in place of the
+    \p old_count consecutive triangles \p old_triangles and marks strips of
+    all of them as changed.
+    \param old_triangles Removed triangles in the order of the strips.
+    \param old_count Number of the removed triangles.
+    \param new_triangles Inserted triangles in the order of the strips.
+    \param new_count Number of the inserted triangles. */
+    void replace(SbROAMSplitQueueTriangle * const * old_triangles,
+      const int old_count, SbROAMSplitQueueTriangle * const * new_triangles,
+      const int new_count);
+    /** Marks a strip as changed.
+    \param strip Index of the strip. */
+    inline void invalidate(const int strip);
+    /** Rebuilds vertex indices of a strip.
+    \param strip Index of the strip. */
+    void rebuild(const int strip);
+    /** Tests a vertex of a triangle.
+    \param triangle Tested triangle.
+    \param vertex Index of the vertex.
+    \return \p TRUE if \p vertex is a vertex of \p triangle. */
+    static inline SbBool isVertex(const SbROAMTriangle & triangle,
+      const GLuint vertex);
+    /* Data members. */
+    /// Level of the roots of subtrees forming one strip in the current tree.
+    int strip_level;
+    /// Number of the strips.
+    int strip_count;
+    /// First triangle of every strip or \p NULL for empty strips.
+    SbROAMSplitQueueTriangle ** first_triangles;
+    /// Vertex indices of every strip.
+    SbList<GLuint> * strips;
+    /// Flags of changed strips.
+    unsigned char * invalid_flags;
+    /// Changed strips.
+    SbList<int> invalid_strips;
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef SO_DIAMOND_ROAM_TERRAIN_H
+#define SO_DIAMOND_ROAM_TERRAIN_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Terrain rendered by the diamond based ROAM algorithm.
+/// \file SoDiamondROAMTerrain.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// The scene graph node represents the terrain rendered by the ROAM algorithm
+/// built on diamonds instead of triangles. The diamonds are records in one
+/// array indexed by their center vertex, their neighbours are found by index
+/// arithmetic instead of pointers. The node is used the same way as
+/// ::SoSimpleROAMTerrain, so both can be compared on the same scene.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbLinear.h>
+#include <Inventor/elements/SoMaterialBindingElement.h>
+#include <Inventor/elements/SoCoordinateElement.h>
+#include <Inventor/elements/SoTextureCoordinateElement.h>
+#include <Inventor/elements/SoTextureEnabledElement.h>
+#include <Inventor/elements/SoLightModelElement.h>
+#include <Inventor/elements/SoNormalElement.h>
+#include <Inventor/elements/SoNormalBindingElement.h>
+#include <Inventor/elements/SoViewVolumeElement.h>
+#include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/lists/SbList.h>
+#include <Inventor/actions/SoGLRenderAction.h>
+#include <Inventor/bundles/SoMaterialBundle.h>
+
+// OpenGL includes
+#if defined(__WIN32__) || defined(_WIN32)
+  #include <windows.h>
+#endif
+#include <GL/gl.h>
+
+// local includes
+#include <roam/SoROAMTerrain.h>
+#include <roam/SbROAMDiamondTree.h>
+#include <roam/SbROAMBucketQueue.h>
+#include <roam/SbROAMPriorityBatch.h>
+#include <SbGLVertexBuffer.h>
+#include <profiler/PrProfiler.h>
+#include <debug.h>
+
+/**
+ * Terrain rendered by the diamond based ROAM algorithm.
+ * The scene graph node represents the terrain rendered by the ROAM algorithm
+ * with the triangulation kept as a set of split diamonds. To use the node,
+ * add a node with coordinates of the type \p SoCoordinate3 to the current
+ * content map and set its dimensions. The size of the map must be 2^n + 1,
+ * where n is a positive integer.
+ */
+class SoDiamondROAMTerrain : public SoROAMTerrain
+{
+  SO_NODE_HEADER(SoDiamondROAMTerrain);
+  public:
+    /** Run-time initialization.
+    You must call this method before creating any instance of
+    ::SoDiamondROAMTerrain. */
+    static void initClass();
+    /** Constructor.
+    Creates an instance of ::SoDiamondROAMTerrain. */
+    SoDiamondROAMTerrain();
+  protected:
+    /** Renders the current triangulation.
+    In the first run computes the metric of the diamonds, then splits and
+    merges the diamonds by their priorities for the current camera and draws
+    the resulting triangulation.
+    \param action An object containing information about the scene graph. */
+    virtual void GLRender(SoGLRenderAction * action);
+    /** Computes priority of a diamond.
+    \param index Index of the center of the diamond.
+    \return Priority of the diamond for the current camera. */
+    inline float computePriority(const int index) const;
+    /** Tests a diamond against the view volume.
+    \param index Index of the center of the diamond.
+    \return \p TRUE if the sphere of the diamond is completely outside of
+    some plane of the view volume. */
+    inline SbBool isCulled(const int index) const;
+    /** Tests split parents of a diamond.
+    \param index Index of the center of the diamond.
+    \return \p TRUE if at least one parent of the diamond is split. */
+    inline SbBool hasSplitParent(const int index) const;
+    /** Inserts a diamond to the split queue.
+    \param index Index of the center of the diamond. */
+    inline void addSplitQueue(const int index);
+    /** Removes a diamond from the split queue.
+    \param index Index of the center of the diamond. */
+    inline void removeSplitQueue(const int index);
+    /** Inserts a diamond to the merge queue.
+    \param index Index of the center of the diamond. */
+    inline void addMergeQueue(const int index);
+    /** Removes a diamond from the merge queue.
+    \param index Index of the center of the diamond. */
+    inline void removeMergeQueue(const int index);
+    /** Splits a diamond.
+    Splits unsplit parents of the diamond recursively first, then adds the
+    center of the diamond to the triangulation.
+    \param index Index of the center of an unsplit diamond. */
+    void forceSplit(const int index);
+    /** Merges a diamond.
+    Removes the center of the diamond from the triangulation.
+    \param index Index of the center of a split diamond without split
+    children. */
+    void merge(const int index);
+    /** Recomputes all priorities.
+    Recomputes priorities of all diamonds in both queues by the vector
+    kernel of ::priority_batch and rebuilds the queues. */
+    void recomputePriorities();
+    /** Refines the triangulation.
+    Splits and merges diamonds until the triangulation reaches the
+    requested error or number of triangles. */
+    void refine();
+    /** Updates the index array.
+    Fills ::indices with vertex indices of all triangles of the
+    triangulation if it changed since the last update. */
+    void updateIndices();
+    /** Appends a triangle to the index array.
+    Orders the vertices of the triangle counterclockwise in the map.
+    \param first First vertex of the hypotenuse.
+    \param second Second vertex of the hypotenuse.
+    \param apex Vertex with the right angle. */
+    inline void appendTriangle(const int first, const int second,
+      const int apex);
+    /* Element shortcuts. */
+    /// Vertices of the height map.
+    const SbVec3f * coords;
+    /// Texture coordinates of the vertices.
+    const SbVec2f * texture_coords;
+    /// Normals of the vertices.
+    const SbVec3f * normals;
+    /// View volume.
+    const SbViewVolume * view_volume;
+    /// Viewport region.
+    const SbViewportRegion * viewport_region;
+    /// Planes of the view volume.
+    SbPlane planes[6];
+    /* Data members. */
+    /// Diamonds of the height map.
+    SbROAMDiamondTree * diamond_tree;
+    /// Number of pixels per radian of the field of view.
+    float lambda;
+    /// Camera position in the current frame.
+    SbVec3f camera_position;
+    /// Unsplit diamonds with a split parent.
+    SbROAMBucketQueue split_queue;
+    /// Split diamonds without split children.
+    SbROAMBucketQueue merge_queue;
+    /// Number of triangles of the triangulation.
+    int triangles;
+    /// Batch of recomputed priorities.
+    SbROAMPriorityBatch priority_batch;
+    /// Vertex buffer with the vertices of the height map.
+    SbGLVertexBuffer vertex_buffer;
+    /// Index array of the triangulation.
+    SbList<GLuint> indices;
+    /// Flag of a change of the triangulation since the last index update.
+    SbBool is_indices_dirty;
+    /// Flag of texture usage.
+    SbBool is_texture;
+    /// Flag of normals usage.
+    SbBool is_normals;
+  private:
+    /* Methods. */
+    /** Destructor.
+    Private, because Inventor releases the node by reference counting. */
+    virtual ~SoDiamondROAMTerrain();
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef SO_ROAM_TERRAIN_H
+#define SO_ROAM_TERRAIN_H
+
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Common base of the ROAM terrain nodes.
+/// \file SoROAMTerrain.h
+/// \author agent
+/// \date 17.10.2026
+///
+/// The triangle based ::SoSimpleROAMTerrain and the diamond based
+/// ::SoDiamondROAMTerrain share their basic fields, the primitives of the
+/// height map and its bounding box. The abstract node keeps them in one
+/// place.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/SbBasic.h>
+#include <Inventor/SbLinear.h>
+#include <Inventor/SoPrimitiveVertex.h>
+#include <Inventor/fields/SoSFBool.h>
+#include <Inventor/fields/SoSFInt32.h>
+#include <Inventor/nodes/SoShape.h>
+#include <Inventor/elements/SoCoordinateElement.h>
+#include <Inventor/elements/SoTextureCoordinateElement.h>
+#include <Inventor/elements/SoNormalElement.h>
+#include <Inventor/actions/SoGetBoundingBoxAction.h>
+#include <Inventor/sensors/SoFieldSensor.h>
+
+/**
+ * Common base of the ROAM terrain nodes.
+ * The abstract node holds the fields common to all ROAM terrains, updates
+ * their internal values and generates the primitives and the bounding box
+ * of the height map. Subclasses which need more than a plain update of an
+ * internal value, for example locking of the refinement, override the
+ * update methods.
+ */
+class SoROAMTerrain : public SoShape
+{
+  SO_NODE_ABSTRACT_HEADER(SoROAMTerrain);
+  public:
+    /** Run-time initialization.
+    Called by the subclasses before their own initialization, further calls
+    do nothing. */
+    static void initClass();
+    /* Fields. */
+    /// The size (height and width) of the current map.
+    SoSFInt32 mapSize;
+    /// Display error in pixels.
+    SoSFInt32 pixelError;
+    /// Maximum number of triangles in triangulation.
+    SoSFInt32 triangleCount;
+    /// Culling of the terrain out of the view volume.
+    SoSFBool frustumCulling;
+    /// The image is "frozen" on the renderer.
+    SoSFBool freeze;
+  protected:
+    /** Constructor.
+    Adds the common fields and attaches their sensors. */
+    SoROAMTerrain();
+    /** Destructor.
+    Releases the sensors of the common fields. */
+    virtual ~SoROAMTerrain();
+    /** Generates triangles of the height map.
+    Creates triangles of the finest level of detail for collision detection
+    and similar purposes.
+    \param action An object containing information about the scene graph. */
+    virtual void generatePrimitives(SoAction * action);
+    /** Computes the bounding box.
+    The box spans the corners of the height map horizontally and the lowest
+    and the highest vertex vertically. The heights are found once for each
+    coordinate node and map size.
+    \param action An object containing information about the scene graph.
+    \param box Computed bounding box.
+    \param center Computed center of the bounding box. */
+    virtual void computeBBox(SoAction * action, SbBox3f & box,
+      SbVec3f & center);
+    /* Updates of the internal fields. */
+    /** Updates the internal value of the \p ::mapSize field. */
+    virtual void updateMapSize();
+    /** Updates the internal value of the \p ::pixelError field. */
+    virtual void updatePixelError();
+    /** Updates the internal value of the \p ::triangleCount field. */
+    virtual void updateTriangleCount();
+    /** Updates the internal value of the \p ::frustumCulling field. */
+    virtual void updateFrustumCulling();
+    /** Updates the internal value of the \p ::freeze field. */
+    virtual void updateFreeze();
+    /* Callbacks. */
+    /** Callback of the \p ::mapSize field change.
+    \param instance Pointer to the \p SoROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void mapSizeChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::pixelError field change.
+    \param instance Pointer to the \p SoROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void pixelErrorChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::triangleCount field change.
+    \param instance Pointer to the \p SoROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void triangleCountChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::frustumCulling field change.
+    \param instance Pointer to the \p SoROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void frustumCullingChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::freeze field change.
+    \param instance Pointer to the \p SoROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void freezeChangedCB(void * instance, SoSensor * sensor);
+    /* Internal fields. */
+    /// Size (height and width) of the height map.
+    int map_size;
+    /// Display error in pixels.
+    int pixel_error;
+    /// Maximal number of triangles in triangulation.
+    int triangle_count;
+    /// Flag of culling of the terrain out of the view volume.
+    SbBool is_frustum_culling;
+    /// Flag of the "frozen" triangulation.
+    SbBool is_freeze;
+    /* Sensors. */
+    /// Sensor of the \p ::mapSize field.
+    SoFieldSensor * map_size_sensor;
+    /// Sensor of the \p ::pixelError field.
+    SoFieldSensor * pixel_error_sensor;
+    /// Sensor of the \p ::triangleCount field.
+    SoFieldSensor * triangle_count_sensor;
+    /// Sensor of the \p ::frustumCulling field.
+    SoFieldSensor * frustum_culling_sensor;
+    /// Sensor of the \p ::freeze field.
+    SoFieldSensor * freeze_sensor;
+    /* Constants. */
+    /// Default display error in pixels.
+    static const int DEFAULT_PIXEL_ERROR;
+    /// Default maximal number of triangles in triangulation.
+    static const int DEFAULT_TRIANGLE_COUNT;
+  private:
+    /* Data members. */
+    /// Coordinate node of the heights of the bounding box.
+    SbUniqueId bbox_node_id;
+    /// Map size of the heights of the bounding box.
+    int bbox_map_size;
+    /// Height of the lowest vertex of the height map.
+    float min_height;
+    /// Height of the highest vertex of the height map.
+    float max_height;
+};
+
+#endif
@@ -34,10 +34,16 @@
 // Coin includes
 #include <Inventor/SbBasic.h>
 #include <Inventor/SbLinear.h>
+#include <Inventor/SbTime.h>
 #include <Inventor/SoPrimitiveVertex.h>
 #include <Inventor/fields/SoSFBool.h>
 #include <Inventor/fields/SoSFInt32.h>
+#include <Inventor/fields/SoSFEnum.h>
+#include <Inventor/fields/SoSFFloat.h>
 #include <Inventor/fields/SoMFFloat.h>
+#include <Inventor/fields/SoSFString.h>
+#include <Inventor/fields/SoSFNode.h>
+#include <Inventor/fields/SoSFVec2s.h>
 #include <Inventor/nodes/SoShape.h>
 #include <Inventor/nodes/SoCamera.h>
 #include <Inventor/elements/SoMaterialBindingElement.h>
@@ -49,10 +55,15 @@
 #include <Inventor/elements/SoNormalBindingElement.h>
 #include <Inventor/elements/SoViewVolumeElement.h>
 #include <Inventor/elements/SoViewportRegionElement.h>
+#include <Inventor/lists/SbList.h>
 #include <Inventor/actions/SoGLRenderAction.h>
 #include <Inventor/actions/SoGetBoundingBoxAction.h>
 #include <Inventor/sensors/SoFieldSensor.h>
 #include <Inventor/bundles/SoMaterialBundle.h>
+#include <Inventor/threads/SbThread.h>
+#include <Inventor/threads/SbMutex.h>
+#include <Inventor/threads/SbCondVar.h>
+#include <Inventor/threads/SbThreadAutoLock.h>
 
 // OpenGL includes
 #if defined(__WIN32__) || defined(_WIN32)
@@ -64,9 +75,18 @@
 #include <iostream>
 
 // local includes
+#include <roam/SoROAMTerrain.h>
 #include <roam/SbROAMPrimitives.h>
 #include <roam/SbROAMSplitQueue.h>
 #include <roam/SbROAMMergeQueue.h>
+#include <roam/SbROAMBucketQueue.h>
+#include <roam/SbROAMPool.h>
+#include <roam/SbROAMRecomputeQueue.h>
+#include <roam/SbROAMPriorityBatch.h>
+#include <roam/SbROAMTriangleStrips.h>
+#include <roam/SbROAMDiamondTree.h>
+#include <SbGLVertexBuffer.h>
+#include <SbTaskPool.h>
 #include <profiler/PrProfiler.h>
 #include <debug.h>
 
@@ -76,8 +96,18 @@
  * To use the node, add a node with coordinates of the type
  * \p SoCoordinate3 to the current content map and set its dimensions.
  * The size of the map must be a vertices of side size 2^n + 1, where n is a positive integer.
+ * A larger world is formed by patches of the same size with common border
+ * vertices. All patches refer to one master terrain by their \p master field
+ * and the master refines them in its queues with its triangle budget and
+ * its refinement fields. Roots of patches neighbouring in the grid of
+ * \p patchPosition are linked, so the seams stay crack-free. The master
+ * does not have to be rendered before its patches, a patch rendered first
+ * in a frame runs the refinement of the master for the frame.
+ * The ::SPLIT_ONLY refinement mode rebuilds the triangulation of a terrain
+ * without patches from its roots in every frame instead of updating the
+ * last one by the split and merge queues.
  */
-class SoSimpleROAMTerrain : public SoShape
+class SoSimpleROAMTerrain : public SoROAMTerrain
 {
   SO_NODE_HEADER(SoSimpleROAMTerrain);
   public:
@@ -89,18 +119,112 @@ class SoSimpleROAMTerrain : public SoShape
 /** Constructor.
     Creating an instance of ::SoSimpleROAMTerrain, initializes both priority queues. */
     SoSimpleROAMTerrain();
+    /* Types. */
+    /// Backends of the split and merge queues.
+    enum QueueType
+    {
+      /// Binary heaps, O(log n) operations.
+      HEAP = SbROAMSplitQueue::HEAP,
+      /// Quantized priority buckets, O(1) operations.
+      BUCKETS = SbROAMSplitQueue::BUCKETS
+    };
+    /// Error metrics of the priority of triangles.
+    enum ErrorMetric
+    {
+      /// Error bound seen from the worst direction.
+      ISOTROPIC = SbROAMPriorityBatch::ISOTROPIC,
+      /// Thickness of the wedgie projected to the view ray, which is lower
+      /// for triangles seen from above.
+      WEDGIE = SbROAMPriorityBatch::WEDGIE
+    };
+    /// Strategies of the refinement.
+    enum RefinementMode
+    {
+      /// The last triangulation is updated by the split and merge queues.
+      INCREMENTAL,
+      /// The triangulation is rebuilt from the roots in every frame by
+      /// splits only, independent subtrees are traversed in parallel.
+      SPLIT_ONLY
+    };
     /* Field. */
-    /// The size (height and width) of the current map.
-    SoSFInt32 mapSize;
-    /// Display error in pixels.
-    SoSFInt32 pixelError;
-    /// Maximum number of triangles in triangulation.
-    SoSFInt32 triangleCount;
-    /// P nak oezer   out of field of vision.
-    SoSFBool frustumCulling;
-    /// The image is "frozen" on the renderer.
-    SoSFBool freeze;
+    /// Number of bottom levels of the triangle tree without stored metric.
+    SoSFInt32 culledLevels;
+    /// Backend of the split and merge queues.
+    SoSFEnum queueType;
+    /// Maximal distance the camera moves in one frame, 0 disables deferred
+    /// recomputation of priorities.
+    SoSFFloat maxCameraSpeed;
+    /// Number of threads of the preprocessing and of the ::SPLIT_ONLY
+    /// refinement, 0 means number of processors.
+    SoSFInt32 threadCount;
+    /// Directory of the preprocessing cache files, empty disables the cache.
+    SoSFString cacheDirectory;
+    /// Time for the refinement in one frame in microseconds, 0 means no
+    /// limit.
+    SoSFFloat refinementBudget;
+    /// Refinement runs on a worker thread, rendering draws the last
+    /// finished triangulation.
+    SoSFBool asyncRefinement;
+    /// Error metric of the priority of triangles. Deferred recomputation of
+    /// priorities is disabled for the ::WEDGIE metric.
+    SoSFEnum errorMetric;
+    /// Terrain refining this terrain as one of its patches in its shared
+    /// queues with its triangle budget, \p NULL for a terrain refined by
+    /// itself.
+    SoSFNode master;
+    /// Column and row of the patch in the grid of patches of the master.
+    SoSFVec2s patchPosition;
+    /// Strategy of the refinement. Terrains with patches are always refined
+    /// incrementally.
+    SoSFEnum refinementMode;
+    /* Methods. */
+    /** Returns pool of triangles.
+    Returns the pool from which the triangles of the split queue are
+    allocated. Its counters can be used to check the allocation behaviour of
+    the refinement.
+    \return Pool of triangles of the split queue. */
+    const SbROAMPool<SbROAMSplitQueueTriangle> & getTrianglePool() const;
+    /** Returns pool of diamonds.
+    Returns the pool from which the diamonds of the merge queue are
+    allocated.
+    \return Pool of diamonds of the merge queue. */
+    const SbROAMPool<SbROAMMergeQueueDiamond> & getDiamondPool() const;
+    /** Returns number of drawn triangles.
+    \return Number of triangles of this patch drawn in the last frame. */
+    int getDrawnTriangleCount() const;
   protected:
+    /* Types. */
+    /** Camera of one frame.
+    Everything the refinement needs to know about the view. */
+    struct SbROAMCamera
+    {
+      /// Position of the camera.
+      SbVec3f position;
+      /// Planes of the view volume.
+      SbPlane planes[6];
+      /// Number of pixels per radian of the field of view.
+      float lambda;
+    };
+    /** Task of the split-only refinement.
+    Traverses one subtree of the binary triangle tree and builds the
+    triangle strip of its leaves. */
+    struct SbROAMSplitTask
+    {
+      /// Refined terrain.
+      SoSimpleROAMTerrain * terrain;
+      /// Root of the subtree.
+      SbROAMTriangle root;
+      /// Culling flags inherited by the root.
+      int flags;
+      /// Vertex indices of the triangle strip of the subtree.
+      SbList<GLuint> indices;
+      /// Leaf waiting for its successor in the strip.
+      SbROAMTriangle pending;
+      /// Flag of a waiting leaf.
+      SbBool is_pending;
+      /// Number of leaves of the subtree.
+      int count;
+    };
 /** Render the current triangulation.
     Based on the input data in the map, the position and distance of the camera and distance
     properties in the first step builds a trihedral binotree, then
@@ -108,43 +232,108 @@ class SoSimpleROAMTerrain : public SoShape
     priority fronts so as to achieve minimal triangulation. Next, draw this triangulation
     \param action An object containing information about the sc y graph. */
     virtual void GLRender(SoGLRenderAction * action);
-
-/** Generated trigonal metalmaps.
-    Create a list of triangles on the highest level from the input map
-    detail for collision detection purposes and similar
-    \param action An object containing information about the sc y graph. */
-    virtual void generatePrimitives(SoAction * action);
-    /** Input boundary layer.
-    It measures the dimensions and the center of the cross that bounds the whole area.
-    \param action An object containing information about the sc y graph.
-    \param box Computed cross border.
-    \param center Calculated center of the bounding box. */
-    virtual void computeBBox(SoAction * action, SbBox3f & box,
-      SbVec3f & center);
-    /** Inicializace bin�n�o stromu trojheln�.
-    Rekurzivn�inicializuje vechny trojheln�y bin�n�o stromu trojheln�,
-    vypo�t�jejich norm�y (pro plon�nebo vpo�t plynul�o st�ov��.
-    \param index Index trojheln�u, kter inicializovat.
-    \param triangle_tree Ukazatel na koen bin�n�o stromu trojheln�. */
-    void initTriangle(SbROAMTriangle * triangle_tree, const int index);
-    /** Test na viditelnost trojheln�u.
-    Otestuje trojheln� definovan body \p first, \p second a \p apex proti
-    pohledov�u t�esu. Nenach�i-li se �n z bodu v pohledu kamery, vr��    \p FALSE. Pou��zjednodueny, ale do tech rozm� roz�eny
-    Cohen-Shuterland algoritmus, a proto me vr�it \p TRUE i kdy je
-    trojheln� mimo pohled kamery.
-    \param first Prvn�vrchol testovan�o trojheln�u.
-    \param second Druh vrchol testovan�o trojheln�u.
-    \param apex Tet�vrchol testovan�o trojheln�u.
-    \return Vr��\p false nen�li trojheln� ur�t�v pohledu kamery, je-li
-    v pohledu nebo nejde-li rozhodnout vrat�\p TRUE. */
-    inline SbBool isInViewVolume(const SbVec3f first, const SbVec3f
-      second, const SbVec3f apex) const;
+    /** Updates the internal value of the \p ::pixelError field.
+    Locks the refinement and recomputes all priorities. */
+    virtual void updatePixelError();
+    /** Updates the internal value of the \p ::triangleCount field.
+    Locks the refinement and recomputes all priorities. */
+    virtual void updateTriangleCount();
+    /** Updates the internal value of the \p ::frustumCulling field.
+    Locks the refinement of the master and recomputes all its
+    priorities. */
+    virtual void updateFrustumCulling();
+    /** Updates the internal value of the \p ::freeze field.
+    Locks the refinement. */
+    virtual void updateFreeze();
+    /** Computes culling flags of a bounding sphere.
+    Tests the sphere with center \p center and radius \p radius against
+    the planes of the view volume, which are not marked as containing the
+    sphere in \p flags yet. Bits 0 to 5 of the flags mark planes with the
+    sphere completely inside, ::CULL_OUT marks the sphere completely outside
+    of some plane.
+    \param center Center of the sphere.
+    \param radius Radius of the sphere.
+    \param flags Flags inherited from the parent of the sphere.
+    \return Culling flags of the sphere. */
+    inline int computeCullFlags(const SbVec3f & center, const float radius,
+      int flags) const;
+    /** Returns culling flags of a triangle.
+    Triangles in the top levels of the tree take the flags from the table
+    of the current frame, deeper triangles inherit the flags of their
+    ancestor in the table and test only the undecided planes.
+    \param triangle Triangle of the binary triangle tree.
+    \return Culling flags of the triangle. */
+    inline int getCullFlags(const SbROAMTriangle & triangle) const;
+    /** Updates culling flags.
+    Computes the culling flags of the triangles in the top levels of the
+    tree for the current view volume. Children of triangles completely
+    inside or outside of the view volume inherit their flags without any
+    test. */
+    void updateCullFlags();
     /** Vpo�t priority trojheln�u v triangulaci.
     Na z�lad�pozice a orientace kamery vypo�e prioritu trojheln�u
     \p triangle v triangulaci.
     \param triangle Trojheln�, jeho priorita se m�spo�tat.
     \return Vr��vypo�enou prioritu trojheln�u. */
-    inline float computePriority(const SbROAMTriangle * triangle) const;
+    inline float computePriority(const SbROAMTriangle & triangle) const;
+    /** Computes priority of a diamond.
+    The priority of the diamond \p diamond is the highest priority of its
+    triangles.
+    \param diamond Diamond of the merge queue.
+    \return Priority of the diamond. */
+    inline float computePriority(const SbROAMMergeQueueDiamond * diamond)
+      const;
+    /** Computes delay of priority recomputation.
+    Returns the number of frames in which the priority of the triangle
+    \p triangle can not cross the split/merge threshold of the last frame
+    with the camera moving at most ::maxCameraSpeed per frame. Priority
+    of triangles outside of the view volume has to be recomputed in the next
+    frame.
+    \param triangle Triangle with current priority.
+    \return Number of frames till the next recomputation. */
+    inline int computeDelay(const SbROAMSplitQueueTriangle * triangle) const;
+    /** Computes priorities of a batch of triangles.
+    Computes priorities of the triangles in ::batch_triangles by the
+    vector kernel of ::priority_batch. Results are left in the batch.
+    */
+    void computeBatchPriorities();
+    /** Recomputes all priorities.
+    Recomputes priorities of all triangles and diamonds, rebuilds both
+    queues and, if deferred recomputation is enabled, schedules next
+    recomputation of all triangles. */
+    void recomputeAll();
+    /** Recomputes scheduled priorities.
+    Recomputes priorities of the triangles scheduled for the current frame
+    and of their diamonds and schedules their next recomputation. */
+    void recomputeScheduled();
+    /** Creates a triangle of the split queue.
+    Allocates a new triangle from the pool of triangles and initializes it.
+    \param triangle Triangle of the binary triangle tree.
+    \param priority Priority of the triangle in the split queue.
+    \return New triangle of the split queue. */
+    inline SbROAMSplitQueueTriangle * createTriangle(const SbROAMTriangle &
+      triangle, const float priority);
+    /** Destroys a triangle of the split queue.
+    Returns the triangle \p triangle to the pool of triangles.
+    \param triangle Triangle to destroy, can be \p NULL. */
+    inline void destroyTriangle(SbROAMSplitQueueTriangle * triangle);
+    /** Creates a diamond of the merge queue.
+    Allocates a new diamond from the pool of diamonds and initializes it
+    with the triangles \p first, \p second, \p third and \p fourth.
+    \param first First triangle of the diamond.
+    \param second Second triangle of the diamond.
+    \param third Third triangle of the diamond.
+    \param fourth Fourth triangle of the diamond.
+    \param priority Priority of the diamond in the merge queue.
+    \return New diamond of the merge queue. */
+    inline SbROAMMergeQueueDiamond * createDiamond(
+      SbROAMSplitQueueTriangle * first, SbROAMSplitQueueTriangle * second,
+      SbROAMSplitQueueTriangle * third, SbROAMSplitQueueTriangle * fourth,
+      const float priority);
+    /** Destroys a diamond of the merge queue.
+    Returns the diamond \p diamond to the pool of diamonds.
+    \param diamond Diamond to destroy, can be \p NULL. */
+    inline void destroyDiamond(SbROAMMergeQueueDiamond * diamond);
     /** Vm�a sousedn�o trojheln�u.
     Zjist� kterm sousedem je trojheln� \p old_neighbour, a zam��ho za
     nov trojheln� \p new_neighbour.
@@ -192,36 +381,172 @@ class SoSimpleROAMTerrain : public SoShape
     vytvo�tak dva trojheln�y z pvodn�h �y v prioritn�front�    trojheln� na rozd�en�
     \param diamond Diamant z prioritn�fronty na rozd�en� */
     void merge(SbROAMMergeQueueDiamond * diamond);
+    /** Changes backend of the queues.
+    Creates new split and merge queues of the type given by the
+    \p ::queueType field and moves all triangles and diamonds of the current
+    triangulation to them. */
+    void changeQueues();
+    /** Adds a patch to the triangulation.
+    The patch \p patch is refined in the queues of this terrain from the
+    next refinement, which starts a new triangulation of all patches.
+    \param patch Patch with the built triangle tree. */
+    void addPatch(SoSimpleROAMTerrain * patch);
+    /** Removes a patch from the triangulation.
+    The next refinement starts a new triangulation without the patch
+    \p patch.
+    \param patch Patch added by ::addPatch. */
+    void removePatch(SoSimpleROAMTerrain * patch);
+    /** Starts a new triangulation.
+    Releases all triangles and diamonds of the shared queues, creates roots
+    of all patches and links roots of neighbouring patches. */
+    void resetTriangulation();
+    /** Creates roots of the patch.
+    Creates the two roots of the triangle tree of the patch in the queues of
+    its master.
+    \param root_1 Returned root with index 1.
+    \param root_2 Returned root with index 2. */
+    void createRoots(SbROAMSplitQueueTriangle *& root_1,
+      SbROAMSplitQueueTriangle *& root_2);
+    /** Updates an index array.
+    Fills the index array \p indices with vertex indices of the triangle
+    strips of the triangulation if it changed since the last update. Only
+    the strips changed by splits and merges are rebuilt.
+    \param indices Index array to fill.
+    \return \p TRUE if the array was filled. */
+    SbBool updateIndices(SbList<GLuint> & indices);
+    /** Publishes the filled index array.
+    Exchanges the index array filled by the refinement thread with the
+    published one, which is drawn by the next rendering. */
+    void publishIndices();
+    /** Recomputes priorities for a camera.
+    Takes the projection and the view volume of \p camera and recomputes
+    all or only the scheduled priorities of the triangulation.
+    \param camera Camera of the current frame. */
+    void recomputePriorities(const SbROAMCamera & camera);
+    /** Refines the triangulation.
+    Splits and merges triangles until the triangulation reaches the
+    requested error or number of triangles or the time budget runs out. */
+    void refine();
+    /** Refines the triangulation of a frame.
+    Runs the synchronous refinement of the terrain with its patches for
+    \p camera and updates index arrays of all patches.
+    \param camera Camera of the current frame. */
+    void refineFrame(const SbROAMCamera & camera);
+    /** Computes the camera of the current frame.
+    \param camera Returned camera of the view volume and the viewport of
+    the last rendering. */
+    void computeCamera(SbROAMCamera & camera) const;
+    /** Starts the refinement thread. */
+    void startRefinementThread();
+    /** Stops the refinement thread.
+    Waits for the end of the current refinement of the thread. */
+    void stopRefinementThread();
+    /** Main function of the refinement thread.
+    Waits for camera snapshots, refines the triangulation for them and
+    publishes index arrays of all patches.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \return Always \p NULL. */
+    static void * refinementThreadMain(void * instance);
+    /** Tests the split-only refinement.
+    \return \p TRUE if the triangulation is rebuilt by
+    ::refineSplitOnly. */
+    inline SbBool isSplitOnly() const;
+    /** Rebuilds the triangulation by splits only.
+    Traverses the tree from both roots for the camera \p camera, splits
+    every triangle whose diamond exceeds the split threshold and fills
+    \p indices with the triangle strip of the leaves. Subtrees of the level
+    ::SPLIT_TASK_LEVEL are traversed in parallel and their strips are joined
+    in the order of the curve. The threshold starts at ::pixelError and is
+    raised while the triangulation exceeds ::triangleCount.
+    \param camera Camera of the current frame.
+    \param indices Index array to fill. */
+    void refineSplitOnly(const SbROAMCamera & camera,
+      SbList<GLuint> & indices);
+    /** Decides a split of the split-only refinement.
+    Tests the diamond with the center in the middle of the hypotenuse of
+    \p triangle. The metric of the diamonds is nested, so a split diamond
+    always has split parents and both triangles of a diamond are split
+    together, which keeps the triangulation crack-free.
+    \param triangle Triangle of the binary triangle tree.
+    \param flags Culling flags inherited from the parent, returns the flags
+      of the diamond.
+    \return \p TRUE if \p triangle is split. */
+    inline SbBool isSplit(const SbROAMTriangle & triangle, int & flags) const;
+    /** Collects tasks of the split-only refinement.
+    Splits \p triangle above the level ::SPLIT_TASK_LEVEL and adds a task
+    for every subtree of this level and every leaf above it in the order of
+    the curve.
+    \param triangle Triangle of the binary triangle tree.
+    \param flags Culling flags inherited by \p triangle. */
+    void collectSplitTasks(const SbROAMTriangle & triangle, int flags);
+    /** Traverses a subtree of the split-only refinement.
+    Appends the leaves of the subtree of \p triangle to the strip of
+    \p task in the order of the curve.
+    \param task Task traversing the subtree.
+    \param triangle Root of the subtree.
+    \param flags Culling flags inherited by \p triangle. */
+    void traverseSplitOnly(SbROAMSplitTask & task,
+      const SbROAMTriangle & triangle, int flags) const;
+    /** Function of the split-only refinement task.
+    \param task Pointer to a ::SbROAMSplitTask instance. */
+    static void splitTask(void * task);
     /* Callbacky. */
-    /** Callback zm�y pole \p ::mapSize.
-    Pi zm��hodnoty pole \p ::mapSize nastav�jeho intern�reprezentaci novou
-    hodnotu.
-    \param instance Ukazatel na instanci t�y \p SoSimpleROAMTerrain.
-    \param sensor Senzor, kter callback vyvolal. */
-    static void mapSizeChangedCB(void * instance, SoSensor * sensor);
-    /** Callback zm�y pole \p ::pixelError.
-    Pi zm��hodnoty pole \p ::pixelError nastav�jeho intern�reprezentaci
-    novou hodnotu.
-    \param instance Ukazatel na instanci t�y \p SoSimpleROAMTerrain.
-    \param sensor Senzor, kter callback vyvolal. */
-    static void pixelErrorChangedCB(void * instance, SoSensor * sensor);
-    /** Callback zm�y pole \p ::triangleCount.
-    Pi zm��hodnoty pole \p ::triangleCount nastav�jeho intern�reprezentaci
-    novou hodnotu.
-    \param instance Ukazatel na instanci t�y \p SoSimpleROAMTerrain.
-    \param sensor Senzor, kter callback vyvolal. */
-    static void triangleCountChangedCB(void * instance, SoSensor * sensor);
-    /** Callback zm�y pole \p ::frustumCulling.
-    Pi zm��hodnoty pole \p ::frustumCulling nastav�jeho intern�    reprezentaci novou hodnotu.
-    \param instance Ukazatel na instanci t�y \p SoSimpleROAMTerrain.
-    \param sensor Senzor, kter callback vyvolal. */
-    static void frustumCullingChangedCB(void * instance, SoSensor * sensor);
-    /** Callback zm�y pole \p ::freeze.
-    Pi zm��hodnoty pole \p ::freeze nastav�jeho intern�reprezentaci novou
-    hodnotu.
-    \param instance Ukazatel na instanci t�y \p SoSimpleROAMTerrain.
-    \param sensor Senzor, kter callback vyvolal. */
-    static void freezeChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::culledLevels field change.
+    Updates the internal value of the \p ::culledLevels field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void culledLevelsChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::queueType field change.
+    Updates the internal value of the \p ::queueType field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void queueTypeChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::maxCameraSpeed field change.
+    Updates the internal value of the \p ::maxCameraSpeed field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void maxCameraSpeedChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::threadCount field change.
+    Updates the internal value of the \p ::threadCount field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void threadCountChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::cacheDirectory field change.
+    Updates the internal value of the \p ::cacheDirectory field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void cacheDirectoryChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::refinementBudget field change.
+    Updates the internal value of the \p ::refinementBudget field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void refinementBudgetChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::asyncRefinement field change.
+    Updates the internal value of the \p ::asyncRefinement field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void asyncRefinementChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::errorMetric field change.
+    Updates the internal value of the \p ::errorMetric field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void errorMetricChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::master field change.
+    Removes the patch from the triangulation of its old master, it joins
+    the new one in its next rendering.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void masterChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::patchPosition field change.
+    Updates the internal value of the \p ::patchPosition field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void patchPositionChangedCB(void * instance, SoSensor * sensor);
+    /** Callback of the \p ::refinementMode field change.
+    Updates the internal value of the \p ::refinementMode field.
+    \param instance Pointer to the \p SoSimpleROAMTerrain instance.
+    \param sensor Sensor which triggered the callback. */
+    static void refinementModeChangedCB(void * instance, SoSensor * sensor);
     /* Zkratky elementu. */
     /// Body vykov�mapy.
     const SbVec3f * coords;
@@ -237,9 +562,7 @@ class SoSimpleROAMTerrain : public SoShape
     SbPlane planes[6];
     /* Datove polozky. */
     /// Bin�n�strom trojheln�.
-    SbROAMTriangle * triangle_tree;
-    /// Velikost bin�n�o stromu trojheln�.
-    int tree_size;
+    SbROAMTriangleTree * triangle_tree;
     /// Po�t rovn�bin�n�o stromu trojheln�.
     int level;
     /// Konstanta udavaj��po�t pixel na jeden radi� zorn�o pole.
@@ -248,37 +571,154 @@ class SoSimpleROAMTerrain : public SoShape
     SbROAMSplitQueue * split_queue;
     /// Fronta diamant pro spojen�
     SbROAMMergeQueue * merge_queue;
+    /// Pool of triangles of the split queue.
+    SbROAMPool<SbROAMSplitQueueTriangle> triangle_pool;
+    /// Pool of diamonds of the merge queue.
+    SbROAMPool<SbROAMMergeQueueDiamond> diamond_pool;
+    /// Queue of deferred recomputation of priorities.
+    SbROAMRecomputeQueue recompute_queue;
+    /// Batch of recomputed priorities.
+    SbROAMPriorityBatch priority_batch;
+    /// Triangles of the batch of recomputed priorities.
+    SbList<SbROAMSplitQueueTriangle *> batch_triangles;
+    /// Camera position in the last frame.
+    SbVec3f camera_position;
+    /// Split/merge threshold of the last frame.
+    float threshold;
+    /// Flag of the recomputation of all priorities in the next frame.
+    SbBool is_recompute_all;
+    /// Terrain whose queues refine this patch, the terrain itself without
+    /// a master.
+    SoSimpleROAMTerrain * master_terrain;
+    /// Patches refined in the queues of this terrain.
+    SbList<SoSimpleROAMTerrain *> patches;
+    /// Flag of the patch added to the triangulation of its master.
+    SbBool is_registered;
+    /// Number of synchronous refinements of the terrain.
+    unsigned int refinement_count;
+    /// Refinement of the master drawn by the patch last.
+    unsigned int drawn_refinement;
+    /// Flag of the refinement of the current frame run by a patch rendered
+    /// before the master.
+    SbBool is_refined;
+    /// Flag of a new triangulation of all patches in the next refinement.
+    SbBool is_reset;
+    /// Number of triangles of the triangulation in this patch.
+    int patch_triangle_count;
+    /// Vertex buffer with the vertices of the height map.
+    SbGLVertexBuffer vertex_buffer;
+    /// Triangle strips of the triangulation.
+    SbROAMTriangleStrips triangle_strips;
+    /// Index arrays of drawn, published and refined triangulation.
+    SbList<GLuint> index_buffers[3];
+    /// Number of triangles in the index arrays.
+    int index_triangle_counts[3];
+    /// Index array which is drawn.
+    SbList<GLuint> * front_indices;
+    /// Index array published by the refinement thread.
+    SbList<GLuint> * ready_indices;
+    /// Index array filled by the refinement thread.
+    SbList<GLuint> * back_indices;
+    /// Flag of a change of the triangulation since the last index update.
+    SbBool is_indices_dirty;
+    /// Refinement thread, \p NULL in synchronous mode.
+    SbThread * refinement_thread;
+    /// Mutex held during the refinement by the thread.
+    SbMutex refinement_mutex;
+    /// Mutex of the camera snapshot and of the published index array.
+    SbMutex snapshot_mutex;
+    /// Condition of a new camera snapshot or of the end of the thread.
+    SbCondVar snapshot_cond;
+    /// Latest camera for the refinement thread.
+    SbROAMCamera snapshot;
+    /// Flag of a camera snapshot not taken by the thread yet.
+    SbBool is_snapshot;
+    /// Flag of an index array published and not drawn yet.
+    SbBool is_published;
+    /// Flag of the end of the refinement thread.
+    SbBool is_exit_refinement;
+    /// Number of levels of the tree with culling flags in the table.
+    int cull_level;
+    /// Bounding spheres of the triangles in the culling table, the center is
+    /// in the first three components and the radius in the fourth one.
+    SbVec4f * cull_spheres;
+    /// Culling flags of the triangles of the top levels of the tree.
+    unsigned char * cull_flags;
+    /// Nested metric of the diamonds of the split-only refinement.
+    SbROAMDiamondTree * diamond_tree;
+    /// Threads of the split-only refinement.
+    SbTaskPool * task_pool;
+    /// Tasks of the split-only refinement.
+    SbROAMSplitTask * split_tasks;
+    /// Number of the tasks of the current split-only refinement.
+    int split_task_count;
+    /// Split threshold of the split-only refinement.
+    float split_threshold;
     /// P�nak pouit�textury.
     SbBool is_texture;
     /// P�nak pouit�norm�.
     SbBool is_normals;
     /* Interni pole. */
-    /// Velikost (vka i �ka) vkov�mapy ter�u.
-    int map_size;
-    /// Chyba zobrazen�v pixelech.
-    int pixel_error;
-    /// Maxim�n�po�t trojheln� v triangulaci.
-    int triangle_count;
-    /// P�nak oez���ter�u mimo zorn�pole.
-    SbBool is_frustum_culling;
-    /// P�nak "zmrazen� vykreslov��ter�u.
-    SbBool is_freeze;
+    /// Number of culled bottom levels of the triangle tree.
+    int culled_levels;
+    /// Backend of the split and merge queues.
+    int queue_type;
+    /// Maximal distance the camera moves in one frame.
+    float max_camera_speed;
+    /// Number of threads of the preprocessing and of the split-only
+    /// refinement.
+    int thread_count;
+    /// Directory of the preprocessing cache files.
+    SbString cache_directory;
+    /// Time for the refinement in one frame in seconds.
+    double refinement_budget;
+    /// Flag of the refinement on a worker thread.
+    SbBool is_async_refinement;
+    /// Error metric of the priority of triangles.
+    int error_metric;
+    /// Column and row of the patch in the grid of patches.
+    SbVec2s patch_position;
+    /// Strategy of the refinement.
+    int refinement_mode;
     /* Sensory. */
-    /// Senzor pole \p ::mapSize.
-    SoFieldSensor * map_size_sensor;
-    /// Senzor pole \p ::pixelError.
-    SoFieldSensor * pixel_error_sensor;
-    /// Senzor pole \p ::triangleCount.
-    SoFieldSensor * triangle_count_sensor;
-    /// Senzor pole \p ::frustumCulling.
-    SoFieldSensor * frustum_culling_sensor;
-    /// Senzor pole \p ::freeze.
-    SoFieldSensor * freeze_sensor;
+    /// Sensor of the \p ::culledLevels field.
+    SoFieldSensor * culled_levels_sensor;
+    /// Sensor of the \p ::queueType field.
+    SoFieldSensor * queue_type_sensor;
+    /// Sensor of the \p ::maxCameraSpeed field.
+    SoFieldSensor * max_camera_speed_sensor;
+    /// Sensor of the \p ::threadCount field.
+    SoFieldSensor * thread_count_sensor;
+    /// Sensor of the \p ::cacheDirectory field.
+    SoFieldSensor * cache_directory_sensor;
+    /// Sensor of the \p ::refinementBudget field.
+    SoFieldSensor * refinement_budget_sensor;
+    /// Sensor of the \p ::asyncRefinement field.
+    SoFieldSensor * async_refinement_sensor;
+    /// Sensor of the \p ::errorMetric field.
+    SoFieldSensor * error_metric_sensor;
+    /// Sensor of the \p ::master field.
+    SoFieldSensor * master_sensor;
+    /// Sensor of the \p ::patchPosition field.
+    SoFieldSensor * patch_position_sensor;
+    /// Sensor of the \p ::refinementMode field.
+    SoFieldSensor * refinement_mode_sensor;
     /* Konstanty. */
-    /// Vchoz�hodnota pro chybu triangulace v pixelech.
-    static const int DEFAULT_PIXEL_ERROR;
-    /// Vchoz�hodnota pro maxim�n�po�t trojheln� v triangulaci.
-    static const int DEFAULT_TRIANGLE_COUNT;
+    /// Number of refinement steps between two checks of the time budget.
+    static const int BUDGET_CHECK_STEPS;
+    /// Maximal number of levels of the tree with culling flags in the
+    /// table.
+    static const int CULL_LEVELS;
+    /// Culling flags of a triangle completely inside of the view volume.
+    static const int CULL_IN;
+    /// Culling flag of a triangle completely outside of the view volume.
+    static const int CULL_OUT;
+    /// Level of the roots of subtrees traversed by one task of the
+    /// split-only refinement.
+    static const int SPLIT_TASK_LEVEL;
+    /// Factor of the change of the split threshold of the split-only
+    /// refinement in one frame.
+    static const float SPLIT_THRESHOLD_STEP;
   private:
     /* Metody */
     /** Destruktor.
@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Hierarchical view frustum culling of a quadtree.
+/// \file SbFrustumCuller.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// Bounding boxes of the tiles of a terrain quadtree are nested, so a tile
+/// completely inside of a plane of the view volume has all its descendants
+/// inside of it too. The ::SbFrustumCuller class tests boxes only against the
+/// planes not containing their parents and starts with the plane which
+/// rejected the box in the previous frame.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// standard includes
+#include <cstring>
+
+// local includes
+#include <SbFrustumCuller.h>
+
+/******************************************************************************
+* SbFrustumCuller - public
+******************************************************************************/
+
+const int SbFrustumCuller::CULL_IN = 0x3f;
+const int SbFrustumCuller::CULL_OUT = 0x40;
+
+SbFrustumCuller::SbFrustumCuller():
+  last_planes(NULL), node_count(0), test_count(0)
+{
+  memset(normals, 0, sizeof(normals));
+  memset(distances, 0, sizeof(distances));
+}
+
+SbFrustumCuller::~SbFrustumCuller()
+{
+  delete[] last_planes;
+}
+
+void SbFrustumCuller::setNodeCount(const int count)
+{
+  delete[] last_planes;
+  node_count = count;
+  last_planes = new unsigned char[node_count];
+  memset(last_planes, 0, node_count);
+}
+
+void SbFrustumCuller::setViewVolume(const SbViewVolume & view_volume)
+{
+  /* Normals of the planes of the view volume point inside of it. */
+  SbPlane planes[6];
+  view_volume.getViewVolumePlanes(planes);
+  for (int I = 0; I < 6; ++I)
+  {
+    const SbVec3f & normal = planes[I].getNormal();
+    normals[I][0] = normal[0];
+    normals[I][1] = normal[1];
+    normals[I][2] = normal[2];
+    distances[I] = planes[I].getDistanceFromOrigin();
+  }
+}
+
+void SbFrustumCuller::resetTestCount()
+{
+  test_count = 0;
+}
+
+int SbFrustumCuller::getTestCount() const
+{
+  return test_count;
+}
@@ -0,0 +1,221 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Vertex buffer of a height map.
+/// \file SbGLVertexBuffer.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// Vertices of the height map do not change during rendering, only the
+/// triangulation does. The ::SbGLVertexBuffer class keeps the coordinates,
+/// normals and texture coordinates of the map in a vertex buffer object, so
+/// the terrain algorithms can draw their triangulation with indexed calls.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// Coin includes
+#include <Inventor/C/glue/gl.h>
+#include <Inventor/elements/SoGLCacheContextElement.h>
+
+// local includes
+#include <SbGLVertexBuffer.h>
+
+/* OpenGL 1.5 tokens missing in old headers. */
+#ifndef GL_ARRAY_BUFFER
+  #define GL_ARRAY_BUFFER 0x8892
+#endif
+#ifndef GL_STATIC_DRAW
+  #define GL_STATIC_DRAW 0x88E4
+#endif
+#ifndef GL_DYNAMIC_DRAW
+  #define GL_DYNAMIC_DRAW 0x88E8
+#endif
+
+/******************************************************************************
+* SbGLVertexBuffer - public
+******************************************************************************/
+
+SbGLVertexBuffer::SbGLVertexBuffer():
+  coords(NULL), normals(NULL), texture_coords(NULL), count(0), buffer(0),
+  context_id(0), is_dirty(TRUE), is_dynamic(FALSE), is_bound_buffer(FALSE)
+{
+  // nic
+}
+
+SbGLVertexBuffer::~SbGLVertexBuffer()
+{
+  /* The buffer object can be deleted only in its context. */
+  if (buffer != 0)
+  {
+    SoGLCacheContextElement::scheduleDeleteCallback(context_id,
+      deleteBufferCB, reinterpret_cast<void *>(static_cast<uintptr_t>(
+      buffer)));
+  }
+}
+
+void SbGLVertexBuffer::setArrays(const SbVec3f * _coords,
+  const SbVec3f * _normals, const SbVec2f * _texture_coords,
+  const int _count)
+{
+  coords = _coords;
+  normals = _normals;
+  texture_coords = _texture_coords;
+  count = _count;
+  is_dirty = TRUE;
+  is_dynamic = FALSE;
+}
+
+void SbGLVertexBuffer::setCoords(const SbVec3f * _coords)
+{
+  coords = _coords;
+  is_dirty = TRUE;
+  is_dynamic = TRUE;
+}
+
+void SbGLVertexBuffer::updateCoords(const uint32_t _context_id,
+  const int first, const int _count)
+{
+  /* Client side arrays are read directly from the memory. */
+  if ((buffer == 0) || is_dirty || (_context_id != context_id) ||
+    (_count <= 0))
+  {
+    return;
+  }
+
+  const cc_glglue * glue = cc_glglue_instance(context_id);
+  cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, buffer);
+  cc_glglue_glBufferSubData(glue, GL_ARRAY_BUFFER, first * sizeof(SbVec3f),
+    _count * sizeof(SbVec3f), coords + first);
+  cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+}
+
+void SbGLVertexBuffer::bind(const uint32_t _context_id,
+  const SbBool is_normals, const SbBool is_texture)
+{
+  /* Upload of changed arrays or of arrays for another context. */
+  if (is_dirty || (_context_id != context_id))
+  {
+    upload(_context_id);
+  }
+
+  /* Offsets of the arrays in the buffer object or their addresses. */
+  const char * coords_base = reinterpret_cast<const char *>(coords);
+  const char * normals_base = reinterpret_cast<const char *>(normals);
+  const char * texture_coords_base =
+    reinterpret_cast<const char *>(texture_coords);
+  is_bound_buffer = buffer != 0;
+  if (is_bound_buffer)
+  {
+    const cc_glglue * glue = cc_glglue_instance(context_id);
+    cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, buffer);
+    coords_base = NULL;
+    normals_base = coords_base + count * sizeof(SbVec3f);
+    texture_coords_base = normals_base + (normals != NULL ? count *
+      sizeof(SbVec3f) : 0);
+  }
+
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_FLOAT, 0, coords_base);
+  if (is_normals && (normals != NULL))
+  {
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, 0, normals_base);
+  }
+  if (is_texture && (texture_coords != NULL))
+  {
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glTexCoordPointer(2, GL_FLOAT, 0, texture_coords_base);
+  }
+}
+
+void SbGLVertexBuffer::unbind()
+{
+  if (is_bound_buffer)
+  {
+    const cc_glglue * glue = cc_glglue_instance(context_id);
+    cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+    is_bound_buffer = FALSE;
+  }
+  glPopClientAttrib();
+}
+
+SbBool SbGLVertexBuffer::isBufferObject() const
+{
+  return buffer != 0;
+}
+
+/******************************************************************************
+* SbGLVertexBuffer - private
+******************************************************************************/
+
+void SbGLVertexBuffer::upload(const uint32_t _context_id)
+{
+  /* Buffer object of another context is released. */
+  if ((buffer != 0) && (_context_id != context_id))
+  {
+    SoGLCacheContextElement::scheduleDeleteCallback(context_id,
+      deleteBufferCB, reinterpret_cast<void *>(static_cast<uintptr_t>(
+      buffer)));
+    buffer = 0;
+  }
+  context_id = _context_id;
+  is_dirty = FALSE;
+
+  /* Without vertex buffer objects the client arrays are used directly. */
+  const cc_glglue * glue = cc_glglue_instance(context_id);
+  if (!cc_glglue_has_vertex_buffer_object(glue) || (coords == NULL))
+  {
+    return;
+  }
+
+  /* Coordinates, normals and texture coordinates follow each other in one
+  buffer object, which is updated often after replaced coordinates. */
+  intptr_t coords_size = count * sizeof(SbVec3f);
+  intptr_t normals_size = normals != NULL ? count * sizeof(SbVec3f) : 0;
+  intptr_t texture_coords_size = texture_coords != NULL ? count *
+    sizeof(SbVec2f) : 0;
+  if (buffer == 0)
+  {
+    cc_glglue_glGenBuffers(glue, 1, &buffer);
+  }
+  cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, buffer);
+  cc_glglue_glBufferData(glue, GL_ARRAY_BUFFER, coords_size + normals_size +
+    texture_coords_size, NULL, is_dynamic ? GL_DYNAMIC_DRAW :
+    GL_STATIC_DRAW);
+  cc_glglue_glBufferSubData(glue, GL_ARRAY_BUFFER, 0, coords_size, coords);
+  if (normals != NULL)
+  {
+    cc_glglue_glBufferSubData(glue, GL_ARRAY_BUFFER, coords_size,
+      normals_size, normals);
+  }
+  if (texture_coords != NULL)
+  {
+    cc_glglue_glBufferSubData(glue, GL_ARRAY_BUFFER, coords_size +
+      normals_size, texture_coords_size, texture_coords);
+  }
+  cc_glglue_glBindBuffer(glue, GL_ARRAY_BUFFER, 0);
+}
+
+void SbGLVertexBuffer::deleteBufferCB(void * closure, uint32_t context_id)
+{
+  /* Deletion of the buffer object in its context. */
+  GLuint buffer = static_cast<GLuint>(reinterpret_cast<uintptr_t>(closure));
+  const cc_glglue * glue = cc_glglue_instance(context_id);
+  cc_glglue_glDeleteBuffers(glue, 1, &buffer);
+}
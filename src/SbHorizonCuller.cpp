@@ -0,0 +1,210 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Horizon occlusion culling of a height map.
+/// \file SbHorizonCuller.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// A height map seen from a low camera hides most of the terrain behind its
+/// nearest ridges. The ::SbHorizonCuller class keeps the horizon formed by
+/// the tiles drawn so far and tests bounding boxes of the following tiles
+/// against it, so tiles processed front to back are culled on the CPU
+/// without any occlusion queries.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// standard includes
+#include <cfloat>
+#include <cmath>
+
+// local includes
+#include <SbHorizonCuller.h>
+
+/******************************************************************************
+* SbHorizonCuller - public
+******************************************************************************/
+
+const int SbHorizonCuller::RESOLUTION = 2048;
+
+SbHorizonCuller::SbHorizonCuller():
+  horizon(NULL), eye(0.0f, 0.0f, 0.0f)
+{
+  horizon = new float[RESOLUTION];
+  for (int I = 0; I < RESOLUTION; ++I)
+  {
+    horizon[I] = -FLT_MAX;
+  }
+}
+
+SbHorizonCuller::~SbHorizonCuller()
+{
+  delete[] horizon;
+}
+
+void SbHorizonCuller::reset(const SbVec3f & _eye)
+{
+  eye = _eye;
+  for (int I = 0; I < RESOLUTION; ++I)
+  {
+    horizon[I] = -FLT_MAX;
+  }
+}
+
+SbBool SbHorizonCuller::isOccluded(const float min_x, const float min_y,
+  const float max_x, const float max_y, const float max_z) const
+{
+  float first, last, near_distance, far_distance;
+  if (!getColumns(min_x, min_y, max_x, max_y, first, last, near_distance,
+    far_distance))
+  {
+    return FALSE;
+  }
+
+  /* The steepest ray to the box goes to its top at the nearest point above
+  the camera or at the farthest point below it. */
+  float height = max_z - eye[2];
+  float slope = height / ((height >= 0.0f) ? near_distance : far_distance);
+
+  /* Every column touched by the box has to be above it. */
+  int first_column = static_cast<int>(floor(first));
+  int last_column = static_cast<int>(floor(last));
+  for (int I = first_column; I <= last_column; ++I)
+  {
+    if (slope >= horizon[((I % RESOLUTION) + RESOLUTION) % RESOLUTION])
+    {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+SbBool SbHorizonCuller::isOccluded(const SbBox3f & box) const
+{
+  const SbVec3f & min = box.getMin();
+  const SbVec3f & max = box.getMax();
+  return isOccluded(min[0], min[1], max[0], max[1], max[2]);
+}
+
+void SbHorizonCuller::addOccluder(const float min_x, const float min_y,
+  const float min_z, const float max_x, const float max_y)
+{
+  float first, last, near_distance, far_distance;
+  if (!getColumns(min_x, min_y, max_x, max_y, first, last, near_distance,
+    far_distance))
+  {
+    return;
+  }
+
+  /* Every ray of a completely covered column crosses the area of the tile
+  between its nearest and farthest distance, rays less steep than the lowest
+  of them pass below the minimal height of the tile. */
+  float height = min_z - eye[2];
+  float slope = height / ((height >= 0.0f) ? far_distance : near_distance);
+  int first_column = static_cast<int>(ceil(first));
+  int last_column = static_cast<int>(floor(last)) - 1;
+  for (int I = first_column; I <= last_column; ++I)
+  {
+    float & column = horizon[((I % RESOLUTION) + RESOLUTION) % RESOLUTION];
+    column = SbMax(column, slope);
+  }
+}
+
+void SbHorizonCuller::addOccluder(const SbBox3f & box)
+{
+  const SbVec3f & min = box.getMin();
+  const SbVec3f & max = box.getMax();
+  addOccluder(min[0], min[1], min[2], max[0], max[1]);
+}
+
+void SbHorizonCuller::getChildOrder(const SbBox3f * boxes, int order[4]) const
+{
+  /* Children on the side of the splitting lines with the camera are passed
+  first by every ray, the ones separated by both lines last. */
+  SbBox3f bounds;
+  for (int I = 0; I < 4; ++I)
+  {
+    bounds.extendBy(boxes[I]);
+  }
+  SbVec3f center = bounds.getCenter();
+  int count = 0;
+  for (int J = 0; J <= 2; ++J)
+  {
+    for (int I = 0; I < 4; ++I)
+    {
+      SbVec3f child_center = boxes[I].getCenter();
+      int rank = (((child_center[0] >= center[0]) != (eye[0] >= center[0])) ?
+        1 : 0) + (((child_center[1] >= center[1]) != (eye[1] >= center[1])) ?
+        1 : 0);
+      if (rank == J)
+      {
+        order[count++] = I;
+      }
+    }
+  }
+}
+
+/******************************************************************************
+* SbHorizonCuller - private
+******************************************************************************/
+
+SbBool SbHorizonCuller::getColumns(const float min_x, const float min_y,
+  const float max_x, const float max_y, float & first, float & last,
+  float & near_distance, float & far_distance) const
+{
+  /* Rectangle below the camera covers all columns. */
+  float delta_x = SbMax(SbMax(min_x - eye[0], eye[0] - max_x), 0.0f);
+  float delta_y = SbMax(SbMax(min_y - eye[1], eye[1] - max_y), 0.0f);
+  if ((delta_x == 0.0f) && (delta_y == 0.0f))
+  {
+    return FALSE;
+  }
+  near_distance = sqrt((delta_x * delta_x) + (delta_y * delta_y));
+  delta_x = SbMax(max_x - eye[0], eye[0] - min_x);
+  delta_y = SbMax(max_y - eye[1], eye[1] - min_y);
+  far_distance = sqrt((delta_x * delta_x) + (delta_y * delta_y));
+
+  /* Azimuths of the corners relative to the center are in the interval
+  from -pi to pi, the rectangle does not contain the camera. */
+  const float pi = static_cast<float>(M_PI);
+  const float corners[4][2] = {{min_x, min_y}, {max_x, min_y},
+    {min_x, max_y}, {max_x, max_y}};
+  float center = atan2((0.5f * (min_y + max_y)) - eye[1],
+    (0.5f * (min_x + max_x)) - eye[0]);
+  float min_angle = 0.0f;
+  float max_angle = 0.0f;
+  for (int I = 0; I < 4; ++I)
+  {
+    float angle = atan2(corners[I][1] - eye[1], corners[I][0] - eye[0]) -
+      center;
+    if (angle > pi)
+    {
+      angle -= 2.0f * pi;
+    }
+    else if (angle < -pi)
+    {
+      angle += 2.0f * pi;
+    }
+    min_angle = SbMin(min_angle, angle);
+    max_angle = SbMax(max_angle, angle);
+  }
+  float scale = RESOLUTION / (2.0f * pi);
+  first = (center + min_angle + pi) * scale;
+  last = (center + max_angle + pi) * scale;
+  return TRUE;
+}
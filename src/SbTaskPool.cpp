@@ -0,0 +1,166 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Pool of worker threads.
+/// \file SbTaskPool.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// Preprocessing of the terrain algorithms consists of many independent
+/// tasks. The ::SbTaskPool class runs them on a set of worker threads built
+/// on the Coin threads abstraction.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// standard includes
+#if defined(__WIN32__) || defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+// local includes
+#include <SbTaskPool.h>
+
+/******************************************************************************
+* SbTaskPool - public
+******************************************************************************/
+
+SbTaskPool::SbTaskPool(const int _thread_count):
+  threads(), tasks(), next_task(0), pending_count(0), thread_count(0),
+  is_exit(FALSE), mutex(), task_cond(), done_cond()
+{
+  /* Number of threads defaults to number of processors. */
+  thread_count = _thread_count > 0 ? _thread_count : getProcessorCount();
+  thread_count = SbMax(thread_count, 1);
+
+  /* The calling thread executes the tasks within waitAll() as one of the
+  threads, so a single thread pool does not start any worker. */
+  for (int I = 1; I < thread_count; ++I)
+  {
+    threads.append(SbThread::create(workerMain, this));
+  }
+}
+
+SbTaskPool::~SbTaskPool()
+{
+  waitAll();
+
+  /* Stop and release the worker threads. */
+  mutex.lock();
+  is_exit = TRUE;
+  task_cond.wakeAll();
+  mutex.unlock();
+  for (int I = 0; I < threads.getLength(); ++I)
+  {
+    threads[I]->join();
+    SbThread::destroy(threads[I]);
+  }
+}
+
+void SbTaskPool::addTask(SbTaskFunc * func, void * closure)
+{
+  SbTask task;
+  task.func = func;
+  task.closure = closure;
+
+  /* Append the task and wake up one worker. */
+  mutex.lock();
+  tasks.append(task);
+  ++pending_count;
+  task_cond.wakeOne();
+  mutex.unlock();
+}
+
+void SbTaskPool::waitAll()
+{
+  mutex.lock();
+
+  /* The calling thread helps with the waiting tasks. */
+  while (runTask())
+  {
+    // nic
+  }
+
+  /* Wait for the tasks executed by the workers. */
+  while (pending_count > 0)
+  {
+    done_cond.wait(mutex);
+  }
+  tasks.truncate(0);
+  next_task = 0;
+  mutex.unlock();
+}
+
+int SbTaskPool::getThreadCount() const
+{
+  return thread_count;
+}
+
+int SbTaskPool::getProcessorCount()
+{
+#if defined(__WIN32__) || defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  int count = static_cast<int>(info.dwNumberOfProcessors);
+#else
+  int count = static_cast<int>(sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+  return count > 0 ? count : 1;
+}
+
+/******************************************************************************
+* SbTaskPool - private
+******************************************************************************/
+
+void * SbTaskPool::workerMain(void * _pool)
+{
+  SbTaskPool * pool = reinterpret_cast<SbTaskPool *>(_pool);
+  pool->mutex.lock();
+  while (!pool->is_exit)
+  {
+    /* Execute the waiting tasks or sleep till a new one comes. */
+    if (!pool->runTask())
+    {
+      pool->task_cond.wait(pool->mutex);
+    }
+  }
+  pool->mutex.unlock();
+  return NULL;
+}
+
+SbBool SbTaskPool::runTask()
+{
+  if (next_task >= tasks.getLength())
+  {
+    return FALSE;
+  }
+
+  /* Execute the task outside of the lock. */
+  SbTask task = tasks[next_task++];
+  mutex.unlock();
+  task.func(task.closure);
+  mutex.lock();
+
+  /* Wake up the waiting threads after the last task. */
+  if (--pending_count == 0)
+  {
+    done_cond.wakeAll();
+  }
+  return TRUE;
+}
@@ -62,10 +62,10 @@ SbChunkedLoDTileTree::SbChunkedLoDTileTree(int _tree_size, int _tile_size):
   tree_size(_tree_size), tile_size(_tile_size),
   tiles(SbChunkedLoDTileList(_tree_size))
 {
-  int vertex_count = SbSqr(this->tile_size);
+  // Vertex indices are allocated by the preprocessing tasks of the tiles.
   for (int I = 0; I < this->tree_size; I++)
   {
-    this->tiles.append(SbChunkedLoDTile(0.0f, vertex_count, SbBox3f()));
+    this->tiles.append(SbChunkedLoDTile());
   }
 }
 
@@ -71,11 +71,15 @@ void SoSimpleChunkedLoDTerrain::initClass()
 SoSimpleChunkedLoDTerrain::SoSimpleChunkedLoDTerrain():
   coords(NULL), texture_coords(NULL), normals(NULL),
   view_volume(SbViewVolume()), viewport_region(SbViewportRegion()),
-  tile_tree(NULL), distance_const(0.0f), is_texture(FALSE), is_normals(FALSE),
+  tile_tree(NULL), frustum_culler(), horizon_culler(), distance_const(0.0f),
+  is_texture(FALSE),
+  is_normals(FALSE),
   map_size(2), tile_size(2), pixel_error(DEFAULT_PIXEL_ERROR),
-  is_frustum_culling(TRUE), is_freeze(FALSE), map_size_sensor(NULL),
+  is_frustum_culling(TRUE), is_freeze(FALSE), is_occlusion_culling(FALSE),
+  thread_count(0), map_size_sensor(NULL),
   tile_size_sensor(NULL), pixel_error_sensor(NULL),
-  frustum_culling_sensor(NULL), freeze_sensor(NULL)
+  frustum_culling_sensor(NULL), freeze_sensor(NULL),
+  occlusion_culling_sensor(NULL), thread_count_sensor(NULL)
 {
   // Init object.
   SO_NODE_CONSTRUCTOR(SoSimpleChunkedLoDTerrain);
@@ -86,6 +90,8 @@ SoSimpleChunkedLoDTerrain::SoSimpleChunkedLoDTerrain():
   SO_NODE_ADD_FIELD(pixelError, (DEFAULT_PIXEL_ERROR));
   SO_NODE_ADD_FIELD(frustumCulling, (TRUE));
   SO_NODE_ADD_FIELD(freeze, (FALSE));
+  SO_NODE_ADD_FIELD(occlusionCulling, (FALSE));
+  SO_NODE_ADD_FIELD(threadCount, (0));
 
   // Create sensors.
   this->map_size_sensor = new SoFieldSensor(mapSizeChangedCB, this);
@@ -94,6 +100,9 @@ SoSimpleChunkedLoDTerrain::SoSimpleChunkedLoDTerrain():
   this->frustum_culling_sensor = new SoFieldSensor(frustumCullingChangedCB,
     this);
   this->freeze_sensor = new SoFieldSensor(freezeChangedCB, this);
+  this->occlusion_culling_sensor = new SoFieldSensor(
+    occlusionCullingChangedCB, this);
+  this->thread_count_sensor = new SoFieldSensor(threadCountChangedCB, this);
 
   // Connect fields to sensors.
   this->map_size_sensor->attach(&(this->mapSize));
@@ -101,6 +110,75 @@ SoSimpleChunkedLoDTerrain::SoSimpleChunkedLoDTerrain():
   this->pixel_error_sensor->attach(&(this->pixelError));
   this->frustum_culling_sensor->attach(&(this->frustumCulling));
   this->freeze_sensor->attach(&(this->freeze));
+  this->occlusion_culling_sensor->attach(&(this->occlusionCulling));
+  this->thread_count_sensor->attach(&(this->threadCount));
+}
+
+int SoSimpleChunkedLoDTerrain::getCullTestCount() const
+{
+  return this->frustum_culler.getTestCount();
+}
+
+void SoSimpleChunkedLoDTerrain::preprocess(const SbVec3f * _coords)
+{
+  this->coords = _coords;
+
+  // Field sensors are delayed, a direct call after setting the fields would
+  // see their old internal values.
+  this->map_size = this->mapSize.getValue();
+  this->tile_size = this->tileSize.getValue();
+  this->thread_count = this->threadCount.getValue();
+
+  // Check map and tile size values.
+  assert(((this->map_size - 1) % (this->tile_size - 1)) == 0);
+
+  // Count tile tree size.
+  int tile_count = (this->map_size - 1) / (this->tile_size - 1);
+  int level_size = SbSqr(tile_count);
+  int tree_size = level_size;
+  while (level_size > 1)
+  {
+    level_size >>= 2;
+    tree_size+= level_size;
+  }
+
+  // Create tile tree.
+  delete this->tile_tree;
+  this->tile_tree = new SbChunkedLoDTileTree(tree_size, this->tile_size);
+  SbBox2s coord_box(0, 0, this->map_size - 1, this->map_size - 1);
+  SbTaskPool pool(this->thread_count);
+
+  // The split depth gives at least eight subtrees per thread.
+  int leaf_depth = 0;
+  for (int I = 1; I < tree_size; I = (I << 2) + 1)
+  {
+    ++leaf_depth;
+  }
+  int split_depth = 1;
+  while (((1 << (split_depth << 1)) < (pool.getThreadCount() << 3)) &&
+    (split_depth < leaf_depth))
+  {
+    ++split_depth;
+  }
+
+  // Small trees and single thread builds are not split.
+  if ((pool.getThreadCount() == 1) || (split_depth >= leaf_depth))
+  {
+    this->initTree(0, coord_box, -1);
+    return;
+  }
+
+  // Parallel initialisation of the subtrees.
+  SbList<SbChunkedLoDInitTask> tasks;
+  this->initTasks(0, coord_box, split_depth, tasks);
+  for (int I = 0; I < tasks.getLength(); ++I)
+  {
+    pool.addTask(initTask, &tasks[I]);
+  }
+  pool.waitAll();
+
+  // Initialisation of the levels above the subtrees.
+  this->initTree(0, coord_box, split_depth);
 }
 
 void SoSimpleChunkedLoDTerrain::GLRender(SoGLRenderAction * action)
@@ -122,29 +200,15 @@ void SoSimpleChunkedLoDTerrain::GLRender(SoGLRenderAction * action)
     assert(SoCoordinateElement::getInstance(state)->is3D() &&
       (SoTextureCoordinateElement::getInstance(state)->getDimension() == 2));
 
-    // Check map and tile size values.
-    assert(((this->map_size - 1) % (this->tile_size - 1)) == 0);
-
     // Get texture and geomety coordinates and normals.
-    this->coords = SoCoordinateElement::getInstance(state)->getArrayPtr3();
     this->texture_coords = SoTextureCoordinateElement::getInstance(state)->
       getArrayPtr2();
     this->normals = SoNormalElement::getInstance(state)->getArrayPtr();
 
-    // Count tile tree size.
-    int tile_count = (this->map_size - 1) / (this->tile_size - 1);
-    int level_size = SbSqr(tile_count);
-    int tree_size = level_size;
-    while (level_size > 1)
-    {
-      level_size >>= 2;
-      tree_size+= level_size;
-    }
-
     // Create tile tree.
     PR_START_PROFILE(preprocess);
-    this->tile_tree = new SbChunkedLoDTileTree(tree_size, this->tile_size);
-    initTree(0, SbBox2s(0, 0, this->map_size - 1, this->map_size - 1));
+    this->preprocess(SoCoordinateElement::getInstance(state)->getArrayPtr3());
+    this->frustum_culler.setNodeCount(this->tile_tree->tree_size);
     PR_STOP_PROFILE(preprocess);
 
     // Init rendering.
@@ -161,6 +225,7 @@ void SoSimpleChunkedLoDTerrain::GLRender(SoGLRenderAction * action)
     // Update view volume, viewport.
     this->view_volume = SoViewVolumeElement::get(state);
     this->viewport_region = SoViewportRegionElement::get(state);
+    this->frustum_culler.setViewVolume(this->view_volume);
 
     // Recompute distance constant.
     distance_const = (this->view_volume.getNearDist() *
@@ -172,7 +237,10 @@ void SoSimpleChunkedLoDTerrain::GLRender(SoGLRenderAction * action)
   this->beginSolidShape(action);
   SoMaterialBundle mat_bundle = SoMaterialBundle(action);
   mat_bundle.sendFirst();
-  this->renderTree(action, 0);
+  this->frustum_culler.resetTestCount();
+  this->horizon_culler.reset(this->view_volume.getProjectionPoint());
+  this->renderTree(action, 0, this->is_frustum_culling ? 0 :
+    SbFrustumCuller::CULL_IN);
   this->endSolidShape(action);
 }
 
@@ -289,14 +357,39 @@ void SoSimpleChunkedLoDTerrain::freezeChangedCB(void * _instance,
   instance->is_freeze = instance->freeze.getValue();
 }
 
+void SoSimpleChunkedLoDTerrain::occlusionCullingChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  // Actualize occlusion culling field internal value.
+  SoSimpleChunkedLoDTerrain * instance =
+    reinterpret_cast<SoSimpleChunkedLoDTerrain *>(_instance);
+  instance->is_occlusion_culling = instance->occlusionCulling.getValue();
+}
+
+void SoSimpleChunkedLoDTerrain::threadCountChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  // Actualize thread count field internal value.
+  SoSimpleChunkedLoDTerrain * instance =
+    reinterpret_cast<SoSimpleChunkedLoDTerrain *>(_instance);
+  instance->thread_count = instance->threadCount.getValue();
+}
+
 /******************************************************************************
 * SoSimpleGeoMipmapTerrain - private
 ******************************************************************************/
 
-SbBox3f SoSimpleChunkedLoDTerrain::initTree(const int index, SbBox2s coord_box)
+SbBox3f SoSimpleChunkedLoDTerrain::initTree(const int index, SbBox2s coord_box,
+  const int depth)
 {
   SbChunkedLoDTile & tile = this->tile_tree->tiles[index];
 
+  // Subtree was initialised by a task already.
+  if (depth == 0)
+  {
+    return tile.bounds;
+  }
+
   // Recurse to tile's child tiles if not at bottom.
   if (((index << 2 ) + 4) < (this->tile_tree->tree_size))
   {
@@ -313,13 +406,13 @@ SbBox3f SoSimpleChunkedLoDTerrain::initTree(const int index, SbBox2s coord_box)
 
     // Compute tile bounding box.
     tile.bounds.extendBy(initTree(first_index, SbBox2s(min[0], min[1],
-      center[0], center[1])));
+      center[0], center[1]), depth - 1));
     tile.bounds.extendBy(initTree(second_index, SbBox2s(center[0], min[1],
-      max[0], center[1])));
+      max[0], center[1]), depth - 1));
     tile.bounds.extendBy(initTree(third_index, SbBox2s(min[0], center[1],
-      center[0], max[1])));
+      center[0], max[1]), depth - 1));
     tile.bounds.extendBy(initTree(fourth_index, SbBox2s(center[0], center[1],
-      max[0], max[1])));
+      max[0], max[1]), depth - 1));
   }
 
   // Init this tile and return bounding box.
@@ -327,6 +420,49 @@ SbBox3f SoSimpleChunkedLoDTerrain::initTree(const int index, SbBox2s coord_box)
   return tile.bounds;
 }
 
+void SoSimpleChunkedLoDTerrain::initTasks(const int index, SbBox2s coord_box,
+  const int depth, SbList<SbChunkedLoDInitTask> & tasks)
+{
+  // Subtree at split depth is initialised by a task.
+  if (depth == 0)
+  {
+    SbChunkedLoDInitTask task;
+    task.terrain = this;
+    task.index = index;
+    task.coord_box = coord_box;
+    tasks.append(task);
+    return;
+  }
+
+  // Count indices of succesors.
+  int first_index = (index << 2) + 1;
+  int second_index = first_index + 1;
+  int third_index = second_index + 1;
+  int fourth_index = third_index + 1;
+
+  // Get corners and center of tile bounding area.
+  const SbVec2s & min = coord_box.getMin();
+  const SbVec2s & max = coord_box.getMax();
+  SbVec2s center = SbVec2s((max + min) / 2);
+
+  // Collect tasks of successors.
+  this->initTasks(first_index, SbBox2s(min[0], min[1], center[0], center[1]),
+    depth - 1, tasks);
+  this->initTasks(second_index, SbBox2s(center[0], min[1], max[0], center[1]),
+    depth - 1, tasks);
+  this->initTasks(third_index, SbBox2s(min[0], center[1], center[0], max[1]),
+    depth - 1, tasks);
+  this->initTasks(fourth_index, SbBox2s(center[0], center[1], max[0], max[1]),
+    depth - 1, tasks);
+}
+
+void SoSimpleChunkedLoDTerrain::initTask(void * _task)
+{
+  SbChunkedLoDInitTask * task = reinterpret_cast<SbChunkedLoDInitTask *>(
+    _task);
+  task->terrain->initTree(task->index, task->coord_box, -1);
+}
+
 inline void SoSimpleChunkedLoDTerrain::initTile(SbChunkedLoDTile & tile,
   int index, SbBox2s coord_box)
 {
@@ -339,20 +475,22 @@ inline void SoSimpleChunkedLoDTerrain::initTile(SbChunkedLoDTile & tile,
   int inc_x = (max[0] - min[0]) / (this->tile_size - 1);
   int inc_y = (max[1] - min[1]) / (this->tile_size - 1);
 
+  // Vertex indices are allocated here, in the task of the tile.
+  tile.vertices.ensureCapacity(SbSqr(this->tile_size));
+
   // Simplified intitialization for tiles on bottom level of tile tree.
   if (((index << 2) + 4) >= this->tile_tree->tree_size)
   {
     // Copy every vertex index within coordinates box.
-    int vertex_index = 0;
     for (int Y = min_y; Y <= max_y; ++Y)
     {
-      for (int X = min_x; X <= max_x; ++X, ++vertex_index)
+      for (int X = min_x; X <= max_x; ++X)
       {
         int coord_index = Y * this->map_size + X;
         const SbVec3f & vertex = this->coords[coord_index];
 
         tile.bounds.extendBy(vertex);
-        tile.vertices[vertex_index] = coord_index;
+        tile.vertices.append(coord_index);
       }
     }
 
@@ -365,10 +503,9 @@ inline void SoSimpleChunkedLoDTerrain::initTile(SbChunkedLoDTile & tile,
     int half_inc_x = inc_x >> 1;
     int half_inc_y = inc_y >> 1;
 
-    int vertex_index = 0;
     for (int Y = min_y; Y <= max_y; Y+= inc_y)
     {
-      for (int X = min_x; X <= max_x; X+= inc_x, ++vertex_index)
+      for (int X = min_x; X <= max_x; X+= inc_x)
       {
         int this_index = Y * this->map_size + X;
         const SbVec3f & this_vertex = this->coords[this_index];
@@ -404,7 +541,7 @@ inline void SoSimpleChunkedLoDTerrain::initTile(SbChunkedLoDTile & tile,
         }
 
         tile.bounds.extendBy(this_vertex);
-        tile.vertices[vertex_index] = this_index;
+        tile.vertices.append(this_index);
       }
     }
 
@@ -802,10 +939,27 @@ inline void SoSimpleChunkedLoDTerrain::renderTile(SoGLRenderAction * action,
 }
 
 void SoSimpleChunkedLoDTerrain::renderTree(SoGLRenderAction * action,
-  const int index)
+  const int index, int cull_flags)
 {
-  // Compute distance from camera to tile.
+  // Skip tile outside of view volume, tiles completely inside aren't tested.
   SbChunkedLoDTile & tile = tile_tree->tiles[index];
+  if (cull_flags != SbFrustumCuller::CULL_IN)
+  {
+    cull_flags = this->frustum_culler.cull(index, cull_flags, tile.bounds);
+    if (cull_flags == SbFrustumCuller::CULL_OUT)
+    {
+      return;
+    }
+  }
+
+  // Skip tile hidden behind horizon of already rendered tiles.
+  if (this->is_occlusion_culling && this->horizon_culler.isOccluded(
+    tile.bounds))
+  {
+    return;
+  }
+
+  // Compute distance from camera to tile.
   SbVec3f camera_position = this->view_volume.getProjectionPoint();
   float distance = (tile.bounds.getCenter() - camera_position).sqrLength();
 
@@ -814,36 +968,48 @@ void SoSimpleChunkedLoDTerrain::renderTree(SoGLRenderAction * action,
     (distance < SbSqr(tile.error * distance_const)))
   {
     int first_index = (index << 2) + 1;
-    int second_index = first_index + 1;
-    int third_index = second_index + 1;
-    int fourth_index = third_index + 1;
+    int order[4] = {0, 1, 2, 3};
 
-    this->renderTree(action, first_index);
-    this->renderTree(action, second_index);
-    this->renderTree(action, third_index);
-    this->renderTree(action, fourth_index);
+    // Occlusion culling needs front to back order of children.
+    if (this->is_occlusion_culling)
+    {
+      SbBox3f boxes[4];
+      for (int I = 0; I < 4; ++I)
+      {
+        boxes[I] = this->tile_tree->tiles[first_index + I].bounds;
+      }
+      this->horizon_culler.getChildOrder(boxes, order);
+    }
+
+    for (int I = 0; I < 4; ++I)
+    {
+      this->renderTree(action, first_index + order[I], cull_flags);
+    }
   }
   else
   {
-    // Render tile if is in view volume or frustum culling is disabled.
-    if (!this->is_frustum_culling || this->view_volume.intersect(tile.bounds))
-    {
-      distance = sqrt(distance);
-      float morph = (distance_const * tile.error) / distance;
-      morph = SbClamp(2.0f * ((2.0f * morph) - 1.0f), 0.0f, 1.0f);
+    // Render tile, it is visible or culling is disabled.
+    distance = sqrt(distance);
+    float morph = (distance_const * tile.error) / distance;
+    morph = SbClamp(2.0f * ((2.0f * morph) - 1.0f), 0.0f, 1.0f);
 
-      Debug(morph);
+    Debug(morph);
 
-      if (morph < 1.0f)
-      {
-        this->renderTile(action, tile, morph);
-        this->renderSkirt(action, tile, morph);
-      }
-      else
-      {
-        this->renderTile(action, tile);
-        this->renderSkirt(action, tile);
-      }
+    if (morph < 1.0f)
+    {
+      this->renderTile(action, tile, morph);
+      this->renderSkirt(action, tile, morph);
+    }
+    else
+    {
+      this->renderTile(action, tile);
+      this->renderSkirt(action, tile);
+    }
+
+    // Rendered tile hides tiles behind it.
+    if (this->is_occlusion_culling)
+    {
+      this->horizon_culler.addOccluder(tile.bounds);
     }
   }
 }
@@ -857,4 +1023,6 @@ SoSimpleChunkedLoDTerrain::~SoSimpleChunkedLoDTerrain()
   delete this->pixel_error_sensor;
   delete this->frustum_culling_sensor;
   delete this->freeze_sensor;
+  delete this->occlusion_culling_sensor;
+  delete this->thread_count_sensor;
 }
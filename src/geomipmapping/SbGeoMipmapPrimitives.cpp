@@ -6,14 +6,11 @@
 /// \author Radek Barton - xbarto33
 /// \date 30.01.2006
 ///
-/// The basic data types of the Geo Mip-Mapping algorithm are defined here.
-/// The quadrant tile tree in t  ::SbGeoMipmapTileTree recursively
-/// splits the current age map into tiles of SbGeoMipmapTile. In his
-/// on the upper levels, the tiles are only virtual, i.e. those that do not contain
-/// /// their own geometry, but only world descendants. Tiles on the lowest level
-/// the tree contains an array of individual equal tile details in t
-/// /// ::SbGeoMipmapTileLevel, only for geometry it includes
-/// //////////////////////////////////////////////////////////////////////////////
+/// Basic data types of the Geo Mip-Mapping algorithm. The tile quadtree
+/// ::SbGeoMipmapTileTree recursively divides the height map to tiles. Its
+/// inner nodes are virtual tiles ::SbGeoMipmapTile without own geometry, the
+/// leaf tiles are stored in flat arrays of the tree.
+//////////////////////////////////////////////////////////////////////////////
 // Copyright (C) 2006 Radek Barton
 //
 // This library is free software; you can redistribute it and/or
@@ -33,22 +30,6 @@
 
 #include <geomipmapping/SbGeoMipmapPrimitives.h>
 
-/******************************************************************************
-* SbGeoMipmapTileLevel - public
-******************************************************************************/
-
-SbGeoMipmapTileLevel::SbGeoMipmapTileLevel(float _error, int * _vertices):
-  error(_error), vertices(_vertices)
-{
-  // nic
-}
-
-SbGeoMipmapTileLevel::~SbGeoMipmapTileLevel()
-{
-  /* Uvolneni pameti. */
-  delete[] vertices;
-}
-
 /******************************************************************************
 * SbGeoMipmapTile - public
 ******************************************************************************/
@@ -56,28 +37,25 @@ SbGeoMipmapTileLevel::~SbGeoMipmapTileLevel()
 /* Staticke konstanty. */
 const int SbGeoMipmapTile::LEVEL_NONE = -1;
 
-SbGeoMipmapTile::SbGeoMipmapTile(SbGeoMipmapTileLevel * _levels,
-  SbGeoMipmapTile * _left, SbGeoMipmapTile * _right, SbGeoMipmapTile * _top,
-  SbGeoMipmapTile * _bottom, int _level, SbBox3f _bounds, SbVec3f _center):
-  levels(_levels), left(_left), right(_right), top(_top), bottom(_bottom),
-  level(_level), bounds(_bounds), center(_center)
+SbGeoMipmapTile::SbGeoMipmapTile(int _level, SbBox3f _bounds):
+  level(_level), cull_flags(0), bounds(_bounds)
 {
   // nic
 }
 
-SbGeoMipmapTile::~SbGeoMipmapTile()
-{
-  /* Uvolneni pameti. */
-  delete[] levels;
-}
-
 /******************************************************************************
 * SbGeoMipmapTileTree - public
 ******************************************************************************/
 
-SbGeoMipmapTileTree::SbGeoMipmapTileTree(int _tile_count, int _tile_size):
+SbGeoMipmapTileTree::SbGeoMipmapTileTree(int _tile_count, int _tile_size,
+  int map_size):
   tile_count(_tile_count), tile_size(_tile_size), tree_size(0), level_count(0),
-  level_sizes(NULL), tiles(NULL)
+  level_sizes(NULL), level_vertices(NULL), morph_vertices(NULL),
+  morph_counts(NULL), morph_deltas(NULL), tiles(NULL), bounds(),
+  base_vertices(NULL), errors(NULL), min_x(NULL), min_y(NULL), min_z(NULL),
+  max_x(NULL), max_y(NULL), max_z(NULL), center_x(NULL), center_y(NULL),
+  center_z(NULL), thresholds(NULL), distances(NULL), levels(NULL),
+  max_levels(NULL), last_levels(NULL), right_tiles(NULL), bottom_tiles(NULL)
 {
   /* Vypocet velikosti stromu dlazdic. */
   tree_size = tile_count;
@@ -104,14 +82,149 @@ SbGeoMipmapTileTree::SbGeoMipmapTileTree(int _tile_count, int _tile_size):
     level_sizes[I] = (level_sizes[I - 1] >> 1) + 1;
   }
 
-  /* Alokace pole dlazdic. */
-  tiles = new SbGeoMipmapTile[tree_size];
+  /* Every level of detail takes every second vertex of the previous one,
+  the same vertices for all tiles relative to their first vertex. */
+  level_vertices = new int *[level_count];
+  for (int I = 0; I < level_count; ++I)
+  {
+    int level_size = level_sizes[I];
+    int step = 1 << I;
+    level_vertices[I] = new int[SbSqr(level_size)];
+    for (int Y = 0; Y < level_size; ++Y)
+    {
+      for (int X = 0; X < level_size; ++X)
+      {
+        level_vertices[I][(Y * level_size) + X] = (Y * step * map_size) +
+          (X * step);
+      }
+    }
+  }
+
+  /* Every level of detail leaves out the vertices of the previous level in
+  odd rows or columns, the finest level leaves out none. Vertices of the
+  right column and of the bottom row follow the other ones. */
+  morph_vertices = new int *[level_count];
+  morph_counts = new int[level_count];
+  morph_vertices[0] = new int[0];
+  morph_counts[0] = 0;
+  for (int I = 1; I < level_count; ++I)
+  {
+    int parent_size = level_sizes[I - 1];
+    const int * parent_vertices = level_vertices[I - 1];
+    morph_counts[I] = SbSqr(parent_size) - SbSqr(level_sizes[I]);
+    morph_vertices[I] = new int[morph_counts[I]];
+    int count = 0;
+    for (int Y = 0; Y < (parent_size - 1); ++Y)
+    {
+      for (int X = 0; X < (parent_size - 1); ++X)
+      {
+        if ((X & 0x01) || (Y & 0x01))
+        {
+          morph_vertices[I][count++] = parent_vertices[(Y * parent_size) + X];
+        }
+      }
+    }
+    for (int Y = 1; Y < parent_size; Y += 2)
+    {
+      morph_vertices[I][count++] = parent_vertices[(Y * parent_size) +
+        parent_size - 1];
+    }
+    for (int X = 1; X < parent_size; X += 2)
+    {
+      morph_vertices[I][count++] = parent_vertices[((parent_size - 1) *
+        parent_size) + X];
+    }
+  }
+
+  /* Alokace virtualnich dlazdic a poli dlazdic na nejnizsi urovni. */
+  tiles = new SbGeoMipmapTile[bottom_start];
+  base_vertices = new int[tile_count];
+  errors = new float[tile_count * level_count];
+  min_x = new float[tile_count];
+  min_y = new float[tile_count];
+  min_z = new float[tile_count];
+  max_x = new float[tile_count];
+  max_y = new float[tile_count];
+  max_z = new float[tile_count];
+  center_x = new float[tile_count];
+  center_y = new float[tile_count];
+  center_z = new float[tile_count];
+  thresholds = new float[tile_count * level_count];
+  distances = new float[tile_count];
+  levels = new int[tile_count];
+  max_levels = new int[tile_count];
+  last_levels = new int[tile_count];
+  right_tiles = new int[tile_count];
+  bottom_tiles = new int[tile_count];
+  for (int I = 0; I < tile_count; ++I)
+  {
+    levels[I] = SbGeoMipmapTile::LEVEL_NONE;
+    max_levels[I] = 0;
+    last_levels[I] = 0;
+  }
+
+  /* Children of a tile are ordered left to right and top to bottom, so bits
+  of the index of a leaf tile interleave its column and row. */
+  int side = 1 << (ilog2(tile_count) >> 1);
+  int * grid = new int[tile_count];
+  for (int I = 0; I < tile_count; ++I)
+  {
+    int X = 0;
+    int Y = 0;
+    for (int B = 0; (1 << B) < side; ++B)
+    {
+      X |= ((I >> (B << 1)) & 0x01) << B;
+      Y |= ((I >> ((B << 1) + 1)) & 0x01) << B;
+    }
+    grid[(Y * side) + X] = I;
+  }
+  for (int Y = 0; Y < side; ++Y)
+  {
+    for (int X = 0; X < side; ++X)
+    {
+      int tile = grid[(Y * side) + X];
+      right_tiles[tile] = (X < (side - 1)) ? grid[(Y * side) + X + 1] : -1;
+      bottom_tiles[tile] = (Y < (side - 1)) ? grid[((Y + 1) * side) + X] :
+        -1;
+    }
+  }
+  delete[] grid;
 }
 
 SbGeoMipmapTileTree::~SbGeoMipmapTileTree()
 {
+  for (int I = 0; I < level_count; ++I)
+  {
+    delete[] level_vertices[I];
+  }
+  delete[] level_vertices;
+  for (int I = 0; I < level_count; ++I)
+  {
+    delete[] morph_vertices[I];
+  }
+  delete[] morph_vertices;
+  delete[] morph_counts;
+  delete[] morph_deltas;
   delete[] level_sizes;
   delete[] tiles;
+  delete[] base_vertices;
+  delete[] errors;
+  delete[] min_x;
+  delete[] min_y;
+  delete[] min_z;
+  delete[] max_x;
+  delete[] max_y;
+  delete[] max_z;
+  delete[] center_x;
+  delete[] center_y;
+  delete[] center_z;
+  delete[] thresholds;
+  delete[] distances;
+  delete[] levels;
+  delete[] max_levels;
+  delete[] last_levels;
+  delete[] right_tiles;
+  delete[] bottom_tiles;
 }
 
 /******************************************************************************
@@ -25,6 +25,10 @@
 // License along with this library; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 ///////////////////////////////////////////////////////////////////////////////
+// Coin includy
+#include <Inventor/C/glue/gl.h>
+
+// lokalni includy
 #include <geomipmapping/SoSimpleGeoMipmapTerrain.h>
 
 /******************************************************************************
@@ -50,12 +54,23 @@ void SoSimpleGeoMipmapTerrain::initClass()
 
 SoSimpleGeoMipmapTerrain::SoSimpleGeoMipmapTerrain():
   coords(NULL), texture_coords(NULL), normals(NULL), view_volume(NULL),
-  viewport_region(NULL), tile_tree(NULL), distance_const(0.0f),
-  is_texture(FALSE), is_normals(FALSE),
-  map_size(2), tile_size(2), pixel_error(DEFAULT_PIXEL_ERROR),
-  is_frustum_culling(TRUE), is_freeze(FALSE),
+  viewport_region(NULL), tile_tree(NULL), frustum_culler(), horizon_culler(),
+  distance_const(0.0f),
+  threshold_distance_const(-1.0f), body_indices(NULL), stitch_indices(NULL),
+  morph_stitch_vertices(NULL), morph_stitch_weights(NULL), vertex_buffer(),
+  draw_counts(), draw_indices(), draw_bases(), frame_indices(),
+  draw_context_id(0), is_draw_context(FALSE),
+  multi_draw_func(NULL), morph_coords(NULL), morphed_vertices(),
+  morphed_tiles(), changed_tiles(NULL),
+  is_texture(FALSE), is_normals(FALSE), map_size(2), tile_size(2),
+  pixel_error(DEFAULT_PIXEL_ERROR),
+  is_frustum_culling(TRUE), is_freeze(FALSE), is_occlusion_culling(FALSE),
+  level_hysteresis(DEFAULT_LEVEL_HYSTERESIS), is_morphing(FALSE),
+  thread_count(0),
   map_size_sensor(NULL), tile_size_sensor(NULL), pixel_error_sensor(NULL),
-  frustum_culling_sensor(NULL), freeze_sensor(NULL)
+  frustum_culling_sensor(NULL), freeze_sensor(NULL),
+  occlusion_culling_sensor(NULL), level_hysteresis_sensor(NULL),
+  morphing_sensor(NULL), thread_count_sensor(NULL)
 {
   /* Inicializace tridy. */
   SO_NODE_CONSTRUCTOR(SoSimpleGeoMipmapTerrain);
@@ -66,6 +81,10 @@ SoSimpleGeoMipmapTerrain::SoSimpleGeoMipmapTerrain():
   SO_NODE_ADD_FIELD(pixelError, (DEFAULT_PIXEL_ERROR));
   SO_NODE_ADD_FIELD(frustumCulling, (TRUE));
   SO_NODE_ADD_FIELD(freeze, (FALSE));
+  SO_NODE_ADD_FIELD(occlusionCulling, (FALSE));
+  SO_NODE_ADD_FIELD(levelHysteresis, (DEFAULT_LEVEL_HYSTERESIS));
+  SO_NODE_ADD_FIELD(morphing, (FALSE));
+  SO_NODE_ADD_FIELD(threadCount, (0));
 
   /* Vytvoreni senzoru. */
   map_size_sensor = new SoFieldSensor(mapSizeChangedCB, this);
@@ -73,6 +92,12 @@ SoSimpleGeoMipmapTerrain::SoSimpleGeoMipmapTerrain():
   pixel_error_sensor = new SoFieldSensor(pixelErrorChangedCB, this);
   frustum_culling_sensor = new SoFieldSensor(frustumCullingChangedCB, this);
   freeze_sensor = new SoFieldSensor(freezeChangedCB, this);
+  occlusion_culling_sensor = new SoFieldSensor(occlusionCullingChangedCB,
+    this);
+  level_hysteresis_sensor = new SoFieldSensor(levelHysteresisChangedCB,
+    this);
+  morphing_sensor = new SoFieldSensor(morphingChangedCB, this);
+  thread_count_sensor = new SoFieldSensor(threadCountChangedCB, this);
 
   /* Napojeni senzoru na pole */
   map_size_sensor->attach(&mapSize);
@@ -80,6 +105,71 @@ SoSimpleGeoMipmapTerrain::SoSimpleGeoMipmapTerrain():
   pixel_error_sensor->attach(&pixelError);
   frustum_culling_sensor->attach(&frustumCulling);
   freeze_sensor->attach(&freeze);
+  occlusion_culling_sensor->attach(&occlusionCulling);
+  level_hysteresis_sensor->attach(&levelHysteresis);
+  morphing_sensor->attach(&morphing);
+  thread_count_sensor->attach(&threadCount);
+}
+
+int SoSimpleGeoMipmapTerrain::getCullTestCount() const
+{
+  return frustum_culler.getTestCount();
+}
+
+void SoSimpleGeoMipmapTerrain::preprocess(const SbVec3f * _coords)
+{
+  coords = _coords;
+
+  /* Field sensors are delayed, a direct call after setting the fields would
+  see their old internal values. */
+  map_size = mapSize.getValue();
+  tile_size = tileSize.getValue();
+  thread_count = threadCount.getValue();
+
+  /* Kontrlola velikosti mapy a dlazdice. */
+  assert(((map_size - 1) % (tile_size - 1)) == 0);
+
+  /* Celkovy pocet dlazdic. */
+  int tile_count = (map_size - 1) / (tile_size - 1);
+  tile_count = SbSqr(tile_count);
+
+  /* Vytvoreni stromu dlazdic. */
+  delete tile_tree;
+  tile_tree = new SbGeoMipmapTileTree(tile_count, tile_size, map_size);
+  SbBox2s coord_box(0, 0, map_size - 1, map_size - 1);
+  SbTaskPool pool(thread_count);
+
+  /* The split depth gives at least eight subtrees per thread. */
+  int leaf_depth = 0;
+  for (int I = 0; I < tile_tree->bottom_start; I = (I << 2) + 1)
+  {
+    ++leaf_depth;
+  }
+  int split_depth = 1;
+  while (((1 << (split_depth << 1)) < (pool.getThreadCount() << 3)) &&
+    (split_depth < leaf_depth))
+  {
+    ++split_depth;
+  }
+
+  /* Small trees and single thread builds are not split. */
+  if ((pool.getThreadCount() == 1) || (split_depth >= leaf_depth))
+  {
+    tile_tree->bounds = initTree(0, coord_box, -1);
+    return;
+  }
+
+  /* Parallel initialization of the subtrees. */
+  SbList<SbGeoMipmapInitTask> tasks;
+  initTasks(0, coord_box, split_depth, tasks);
+  for (int I = 0; I < tasks.getLength(); ++I)
+  {
+    pool.addTask(initTask, &tasks[I]);
+  }
+  pool.waitAll();
+
+  /* Initialization of the levels above the subtrees. */
+  tile_tree->bounds = initTree(0, coord_box, split_depth);
 }
 
 /******************************************************************************
@@ -88,6 +178,9 @@ SoSimpleGeoMipmapTerrain::SoSimpleGeoMipmapTerrain():
 
 /* Staticke konstanty. */
 const int SoSimpleGeoMipmapTerrain::DEFAULT_PIXEL_ERROR = 20;
+const float SoSimpleGeoMipmapTerrain::DEFAULT_LEVEL_HYSTERESIS = 0.1f;
+const float SoSimpleGeoMipmapTerrain::THRESHOLD_TOLERANCE = 1e-4f;
+const float SoSimpleGeoMipmapTerrain::MORPH_RANGE = 0.5f;
 
 void SoSimpleGeoMipmapTerrain::GLRender(SoGLRenderAction * action)
 {
@@ -120,21 +213,26 @@ void SoSimpleGeoMipmapTerrain::GLRender(SoGLRenderAction * action)
       getArrayPtr2();
     normals = SoNormalElement::getInstance(state)->getArrayPtr();
 
-    /* Kontrlola velikosti mapy a dlazdice. */
-    assert(((map_size - 1) % (tile_size - 1)) == 0);
-
-    /* Celkovy pocet dlazdic. */
-    int tile_count = (map_size - 1) / (tile_size - 1);
-    tile_count = SbSqr(tile_count);
+    /* Vertices of the height map are drawn from a vertex buffer, arrays
+    shorter than the map are not used. */
+    int vertex_count = map_size * map_size;
+    vertex_buffer.setArrays(coords,
+      (SoNormalElement::getInstance(state)->getNum() >= vertex_count) ?
+      normals : NULL,
+      (SoTextureCoordinateElement::getInstance(state)->getNum() >=
+      vertex_count) ? texture_coords : NULL, vertex_count);
 
     /* Vytvoreni stromu dlazdic. */
-    tile_tree = new SbGeoMipmapTileTree(tile_count, tile_size);
-    initTree(0, SbBox2s(0, 0, map_size - 1, map_size - 1));
+    preprocess(coords);
+    initIndices();
+    frustum_culler.setNodeCount(tile_tree->bottom_start +
+      tile_tree->tile_count);
     PR_STOP_PROFILE(preprocess);
   }
 
   /* Neni-li algoritmus vypnut provedeme vyber urovni dlazdic a frustum
   culling. */
+  frustum_culler.resetTestCount();
   if (!is_freeze)
   {
     /* Vypocet konstanty pro vypocet vzdalenosti pro zvoleni dane urovne
@@ -143,7 +241,7 @@ void SoSimpleGeoMipmapTerrain::GLRender(SoGLRenderAction * action)
       viewport_region->getViewportSizePixels()[1]) /
       (pixel_error * view_volume->getHeight());
 
-    recomputeTree(0, TRUE);
+    recomputeTiles();
   }
 
   /* Inicializace vykreslovani. */
@@ -170,7 +268,47 @@ void SoSimpleGeoMipmapTerrain::GLRender(SoGLRenderAction * action)
     glNormal3f(0.0f, 0.0f, 1.0f);
   }
 
-  renderTree(action, 0);
+  /* Draws of the visible tiles are collected for one submission. */
+  uint32_t context_id = action->getCacheContext();
+  if (!is_draw_context || (context_id != draw_context_id))
+  {
+    initDrawFunc(context_id);
+  }
+  draw_counts.truncate(0);
+  draw_indices.truncate(0);
+  draw_bases.truncate(0);
+  frame_indices.truncate(0);
+  for (int I = 0; I < tile_tree->tile_count; ++I)
+  {
+    if (tile_tree->levels[I] != SbGeoMipmapTile::LEVEL_NONE)
+    {
+      addTile(I);
+    }
+  }
+
+  /* Morphing of the vertices of the visible tiles. */
+  if (!is_freeze)
+  {
+    morphTiles(context_id);
+  }
+
+  /* Vykresleni viditelnych dlazdic. */
+  vertex_buffer.bind(context_id, is_normals, is_texture);
+  if (multi_draw_func != NULL)
+  {
+    if (draw_counts.getLength() > 0)
+    {
+      multi_draw_func(GL_TRIANGLES, draw_counts.getArrayPtr(),
+        GL_UNSIGNED_INT, draw_indices.getArrayPtr(), draw_counts.getLength(),
+        draw_bases.getArrayPtr());
+    }
+  }
+  else
+  {
+    glDrawElements(GL_TRIANGLES, frame_indices.getLength(), GL_UNSIGNED_INT,
+      frame_indices.getArrayPtr());
+  }
+  vertex_buffer.unbind();
   endSolidShape(action);
 }
 
@@ -216,7 +354,7 @@ void SoSimpleGeoMipmapTerrain::computeBBox(SoAction * action, SbBox3f & box,
   /* Vypocet ohranicujiciho kvadru a jeho stredu. */
   if (tile_tree != NULL)
   {
-    box = tile_tree->tiles[0].bounds;
+    box = tile_tree->bounds;
   }
   /* Ohraniceni neni jeste spocitano v preprocesingu. */
   else
@@ -235,120 +373,141 @@ void SoSimpleGeoMipmapTerrain::computeBBox(SoAction * action, SbBox3f & box,
   center = box.getCenter();
 }
 
-SbBox3f SoSimpleGeoMipmapTerrain::initTree(const int index, SbBox2s coord_box)
+SbBox3f SoSimpleGeoMipmapTerrain::initTree(const int index, SbBox2s coord_box,
+  const int depth)
 {
-  SbGeoMipmapTile & tile = tile_tree->tiles[index];
-
   if (index >= tile_tree->bottom_start)
   {
     /* Inicializace dlazdice na nejnizsi urovni. */
-    initTile(tile, coord_box);
+    return initTile(index - tile_tree->bottom_start, coord_box);
   }
-  else
+
+  SbGeoMipmapTile & tile = tile_tree->tiles[index];
+
+  /* The subtree is initialized by a task already. */
+  if (depth == 0)
   {
-    /* Vypocet indexu potomku. */
-    int first_index = (index << 2) + 1;
-    int second_index = first_index + 1;
-    int third_index = second_index + 1;
-    int fourth_index = third_index + 1;
-
-    /* Zjisteni ohraniceni souradnic dlazdice. */
-    SbVec2s min = coord_box.getMin();
-    SbVec2s max = coord_box.getMax();
-    SbVec2s center = SbVec2s((max + min) / 2);
-
-    SbGeoMipmapTile * tiles = tile_tree->tiles;
-
-    /* Inicializace odkazu na sousedy prvni dlazdice. */
-    tiles[first_index].left = (tile.left == NULL) ? NULL :
-      &tiles[((tile.left - tiles) << 2) + 2];
-    tiles[first_index].right = &tiles[second_index];
-    tiles[first_index].top = (tile.top == NULL) ? NULL :
-      &(tiles[((tile.top - tiles) << 2) + 3]);
-    tiles[first_index].bottom = &tiles[third_index];
-
-    /* Inicializace odkazu na sousedy druhe dlazdice. */
-    tiles[second_index].left = &tiles[first_index];
-    tiles[second_index].right = (tile.right == NULL) ? NULL :
-      &(tiles[((tile.right - tiles) << 2) + 1]);
-    tiles[second_index].top = (tile.top == NULL) ? NULL :
-      &(tiles[((tile.top - tiles) << 2) + 4]);
-    tiles[second_index].bottom = &tiles[fourth_index];
-
-    /* Inicializace odkazu na sousedy treti dlazdice. */
-    tiles[third_index].left = (tile.left == NULL) ? NULL :
-      &(tiles[((tile.left - tiles) << 2) + 4]);
-    tiles[third_index].right = &tiles[fourth_index];
-    tiles[third_index].top = &tiles[first_index];
-    tiles[third_index].bottom = (tile.bottom == NULL) ? NULL :
-      &(tiles[((tile.bottom - tiles) << 2) + 1]);
-
-    /* Inicializace odkazu na sousedy ctvrte dlazdice. */
-    tiles[fourth_index].left = &tiles[third_index];
-    tiles[fourth_index].right = (tile.right == NULL) ? NULL :
-      &(tiles[((tile.right - tiles) << 2) + 3]);
-    tiles[fourth_index].top = &tiles[second_index];
-    tiles[fourth_index].bottom = (tile.bottom == NULL) ? NULL :
-      &tiles[((tile.bottom - tiles) << 2) + 2];
-
-    /* Rekurzivni inicializace stromu a vypocet ohraniceni dlazdice. */
-    tile.bounds.extendBy(initTree(first_index, SbBox2s(min[0], min[1],
-      center[0], center[1])));
-    tile.bounds.extendBy(initTree(second_index, SbBox2s(center[0], min[1],
-      max[0], center[1])));
-    tile.bounds.extendBy(initTree(third_index, SbBox2s(min[0], center[1],
-      center[0], max[1])));
-    tile.bounds.extendBy(initTree(fourth_index, SbBox2s(center[0], center[1],
-      max[0], max[1])));
+    return tile.bounds;
   }
 
+  /* Vypocet indexu potomku. */
+  int first_index = (index << 2) + 1;
+  int second_index = first_index + 1;
+  int third_index = second_index + 1;
+  int fourth_index = third_index + 1;
+
+  /* Zjisteni ohraniceni souradnic dlazdice. */
+  SbVec2s min = coord_box.getMin();
+  SbVec2s max = coord_box.getMax();
+  SbVec2s center = SbVec2s((max + min) / 2);
+
+  /* Rekurzivni inicializace stromu a vypocet ohraniceni dlazdice. */
+  tile.bounds.extendBy(initTree(first_index, SbBox2s(min[0], min[1],
+    center[0], center[1]), depth - 1));
+  tile.bounds.extendBy(initTree(second_index, SbBox2s(center[0], min[1],
+    max[0], center[1]), depth - 1));
+  tile.bounds.extendBy(initTree(third_index, SbBox2s(min[0], center[1],
+    center[0], max[1]), depth - 1));
+  tile.bounds.extendBy(initTree(fourth_index, SbBox2s(center[0], center[1],
+    max[0], max[1]), depth - 1));
+
   return tile.bounds;
 }
 
-inline void SoSimpleGeoMipmapTerrain::initTile(SbGeoMipmapTile & tile,
+void SoSimpleGeoMipmapTerrain::initTasks(const int index, SbBox2s coord_box,
+  const int depth, SbList<SbGeoMipmapInitTask> & tasks)
+{
+  /* The subtree at the split depth is initialized by a task. */
+  if (depth == 0)
+  {
+    SbGeoMipmapInitTask task;
+    task.terrain = this;
+    task.index = index;
+    task.coord_box = coord_box;
+    tasks.append(task);
+    return;
+  }
+
+  /* Vypocet indexu potomku. */
+  int first_index = (index << 2) + 1;
+  int second_index = first_index + 1;
+  int third_index = second_index + 1;
+  int fourth_index = third_index + 1;
+
+  /* Zjisteni ohraniceni souradnic dlazdice. */
+  SbVec2s min = coord_box.getMin();
+  SbVec2s max = coord_box.getMax();
+  SbVec2s center = SbVec2s((max + min) / 2);
+
+  initTasks(first_index, SbBox2s(min[0], min[1], center[0], center[1]),
+    depth - 1, tasks);
+  initTasks(second_index, SbBox2s(center[0], min[1], max[0], center[1]),
+    depth - 1, tasks);
+  initTasks(third_index, SbBox2s(min[0], center[1], center[0], max[1]),
+    depth - 1, tasks);
+  initTasks(fourth_index, SbBox2s(center[0], center[1], max[0], max[1]),
+    depth - 1, tasks);
+}
+
+void SoSimpleGeoMipmapTerrain::initTask(void * _task)
+{
+  SbGeoMipmapInitTask * task = reinterpret_cast<SbGeoMipmapInitTask *>(_task);
+  task->terrain->initTree(task->index, task->coord_box, -1);
+}
+
+inline SbBox3f SoSimpleGeoMipmapTerrain::initTile(const int tile,
   SbBox2s coord_box)
 {
-  /* Alokace vsech urovni detailu dlazdice. */
-  tile.levels = new SbGeoMipmapTileLevel[tile_tree->level_count];
+  SbBox3f bounds;
 
   /* Ziskani souradnic dlazdice ve vyskove mape */
   SbVec2s min = coord_box.getMin();
   SbVec2s max = coord_box.getMax();
 
-  /* Alokace a inicializace nejlepsi urovne detailu dlazdice. */
-  tile.levels[0].vertices = new int[SbSqr(tile_tree->level_sizes[0])];
-  int index = 0;
+  /* Vypocet ohraniceni dlazdice. */
   for (int Y = min[1]; Y <= max[1]; ++Y)
   {
-    for (int X = min[0]; X <= max[0]; ++X, ++index)
+    for (int X = min[0]; X <= max[0]; ++X)
     {
-      int coord_index = Y * map_size + X;
-      const SbVec3f & vertex = coords[coord_index];
-
-      /* Vypocet ohraniceni dlazdice a zapis indexu vrcholu do dlazdice. */
-      tile.bounds.extendBy(vertex);
-      tile.levels[0].vertices[index] = coord_index;
+      bounds.extendBy(coords[Y * map_size + X]);
     }
   }
 
-  tile.levels[0].error = 0.0f;
+  /* Levels of detail use the shared vertices relative to the first vertex
+  of the tile. */
+  tile_tree->base_vertices[tile] = min[1] * map_size + min[0];
+  tile_tree->getError(tile, 0) = 0.0f;
 
   /* Inicializace ostatnich urovni podle predchozich. */
   for (int I = 1; I < tile_tree->level_count; ++I)
   {
-    int level_size = tile_tree->level_sizes[I];
-    tile.levels[I].vertices = new int[SbSqr(level_size)];
-    initLevel(tile.levels[I], tile.levels[I - 1], level_size);
+    initLevel(tile, I);
   }
 
-  /* Vypocet stredu dlazdice. */
-  tile.center = tile.bounds.getCenter();
+  /* Ulozeni ohraniceni a stredu dlazdice. */
+  const SbVec3f & bounds_min = bounds.getMin();
+  const SbVec3f & bounds_max = bounds.getMax();
+  SbVec3f center = bounds.getCenter();
+  tile_tree->min_x[tile] = bounds_min[0];
+  tile_tree->min_y[tile] = bounds_min[1];
+  tile_tree->min_z[tile] = bounds_min[2];
+  tile_tree->max_x[tile] = bounds_max[0];
+  tile_tree->max_y[tile] = bounds_max[1];
+  tile_tree->max_z[tile] = bounds_max[2];
+  tile_tree->center_x[tile] = center[0];
+  tile_tree->center_y[tile] = center[1];
+  tile_tree->center_z[tile] = center[2];
+
+  return bounds;
 }
 
-inline void SoSimpleGeoMipmapTerrain::initLevel(SbGeoMipmapTileLevel & level,
-  SbGeoMipmapTileLevel & parent, const int level_size)
+inline void SoSimpleGeoMipmapTerrain::initLevel(const int tile,
+  const int level)
 {
-  int parent_size = (level_size << 1) - 1;
+  int base_vertex = tile_tree->base_vertices[tile];
+  const SbVec3f * tile_coords = coords + base_vertex;
+  const int * parent_vertices = tile_tree->level_vertices[level - 1];
+  int parent_size = tile_tree->level_sizes[level - 1];
   float max_error = 0.0f;
 
   for (int Y = 0; Y < parent_size; ++Y)
@@ -362,269 +521,778 @@ inline void SoSimpleGeoMipmapTerrain::initLevel(SbGeoMipmapTileLevel & level,
         if ((Y == 0) || (Y == (parent_size - 1)))
         {
           int index = (Y * parent_size) + X;
-          float tmp_error = SbAbs(coords[parent.vertices[index]][2] -
-            ((coords[parent.vertices[index - 1]][2] +
-            coords[parent.vertices[index + 1]][2]) * 0.5f));
+          float tmp_error = SbAbs(tile_coords[parent_vertices[index]][2] -
+            ((tile_coords[parent_vertices[index - 1]][2] +
+            tile_coords[parent_vertices[index + 1]][2]) * 0.5f));
           max_error = SbMax(max_error, tmp_error);
         }
         /* Chyba v levem a pravem sloupci se spocita vertikalne. */
         else if ((X == 0) || (X == (parent_size - 1)))
         {
           int index = (Y * parent_size) + X;
-          float tmp_error = SbAbs(coords[parent.vertices[index]][2] -
-            ((coords[parent.vertices[index - parent_size]][2] +
-            coords[parent.vertices[index + parent_size]][2]) * 0.5f));
+          float tmp_error = SbAbs(tile_coords[parent_vertices[index]][2] -
+            ((tile_coords[parent_vertices[index - parent_size]][2] +
+            tile_coords[parent_vertices[index + parent_size]][2]) * 0.5f));
           max_error = SbMax(max_error, tmp_error);
         }
         /* Uprostred dlazdice se chyba spocita podle prave diagonaly. */
         else
         {
           int index = (Y * parent_size) + X;
-          float tmp_error = SbAbs(coords[parent.vertices[index]][2] -
-            ((coords[parent.vertices[index - parent_size + 1]][2] +
-            coords[parent.vertices[index + parent_size - 1]][2]) * 0.5f));
+          float tmp_error = SbAbs(tile_coords[parent_vertices[index]][2] -
+            ((tile_coords[parent_vertices[index - parent_size + 1]][2] +
+            tile_coords[parent_vertices[index + parent_size - 1]][2]) * 0.5f));
           max_error = SbMax(max_error, tmp_error);
         }
       }
-      /* Sude indexy se zaradi do triangulace. */
-      else
-      {
-        level.vertices[((Y >> 1) * level_size) + (X >> 1)] = parent.vertices[
-          (Y * parent_size) + X];
-      }
     }
   }
 
   /* Ulozeni chyby a vypocet vzdalenosti pro zobrazeni urovne. */
-  level.error = parent.error + max_error;
+  tile_tree->getError(tile, level) = tile_tree->getError(tile, level - 1) +
+    max_error;
 }
 
-void SoSimpleGeoMipmapTerrain::recomputeTree(const int index,
-  const SbBool render_parent)
+void SoSimpleGeoMipmapTerrain::recomputeTiles()
 {
-  SbGeoMipmapTile & tile = tile_tree->tiles[index];
+  /* Prahy vzdalenosti se prepocitaji jen pri zmene konstanty. Rounding
+  differences of a moving near plane are ignored. */
+  if (fabs(distance_const - threshold_distance_const) >
+    (THRESHOLD_TOLERANCE * distance_const))
+  {
+    updateThresholds();
+  }
 
-  /* Neni-li dlazdice pouze virtualni dlazdici */
-  if (tile.levels != NULL)
+  /* Culling of the virtual tiles, parents precede their children in the
+  array of the tree. Tiles of parents completely inside or outside of the
+  view volume are not tested. */
+  SbGeoMipmapTile * tiles = tile_tree->tiles;
+  int root_flags = is_frustum_culling ? 0 : SbFrustumCuller::CULL_IN;
+  frustum_culler.setViewVolume(*view_volume);
+  for (int I = 0; I < tile_tree->bottom_start; ++I)
   {
-    /* Je-li dlazdice v pohledu kamery. */
-    if (!is_frustum_culling || (render_parent &&
-      view_volume->intersect(tile.bounds)))
+    int flags = (I == 0) ? root_flags : tiles[(I - 1) >> 2].cull_flags;
+    if ((flags != SbFrustumCuller::CULL_IN) &&
+      (flags != SbFrustumCuller::CULL_OUT))
     {
-      tile.level = pickLevel(tile);
+      flags = frustum_culler.cull(I, flags, tiles[I].bounds);
     }
-    else
+    tiles[I].cull_flags = flags;
+    tiles[I].level = (flags != SbFrustumCuller::CULL_OUT) ? 0 :
+      SbGeoMipmapTile::LEVEL_NONE;
+  }
+
+  /* Squared camera distances of the centers of the leaf tiles. */
+  SbVec3f camera_position = view_volume->getProjectionPoint();
+  const float camera_x = camera_position[0];
+  const float camera_y = camera_position[1];
+  const float camera_z = camera_position[2];
+  const int tile_count = tile_tree->tile_count;
+  const float * center_x = tile_tree->center_x;
+  const float * center_y = tile_tree->center_y;
+  const float * center_z = tile_tree->center_z;
+  float * distances = tile_tree->distances;
+  int * levels = tile_tree->levels;
+  int * max_levels = tile_tree->max_levels;
+  int * last_levels = tile_tree->last_levels;
+  for (int I = 0; I < tile_count; ++I)
+  {
+    float delta_x = center_x[I] - camera_x;
+    float delta_y = center_y[I] - camera_y;
+    float delta_z = center_z[I] - camera_z;
+    distances[I] = (delta_x * delta_x) + (delta_y * delta_y) +
+      (delta_z * delta_z);
+    levels[I] = 0;
+    max_levels[I] = 0;
+  }
+
+  /* Thresholds grow with the level, so a level is the number of the coarser
+  levels whose threshold the distance reached. The finest and the coarsest
+  level allowed by the hysteresis band are counted with the threshold
+  distances moved out and in by the band. */
+  float band = SbClamp(level_hysteresis, 0.0f, 0.5f);
+  const float finer_scale = 1.0f / SbSqr(1.0f + band);
+  const float coarser_scale = 1.0f / SbSqr(1.0f - band);
+  for (int J = 1; J < tile_tree->level_count; ++J)
+  {
+    const float * thresholds = tile_tree->thresholds + (J * tile_count);
+    for (int I = 0; I < tile_count; ++I)
     {
-      tile.level = SbGeoMipmapTile::LEVEL_NONE;
+      levels[I] += ((distances[I] * finer_scale) >= thresholds[I]);
+      max_levels[I] += ((distances[I] * coarser_scale) >= thresholds[I]);
     }
   }
-  /* Dlazdice je virtualni. */
-  else
+
+  /* Level of the last frame is kept if it is within the band. */
+  for (int I = 0; I < tile_count; ++I)
   {
-    /* Je-li dlazdice v pohledu kamery. */
-    if (!is_frustum_culling || (render_parent &&
-      view_volume->intersect(tile.bounds)))
+    int level = SbMax(levels[I], SbMin(last_levels[I], max_levels[I]));
+    levels[I] = level;
+    last_levels[I] = level;
+  }
+
+  /* Culling of the leaf tiles. */
+  if (is_frustum_culling)
+  {
+    const float * min_x = tile_tree->min_x;
+    const float * min_y = tile_tree->min_y;
+    const float * min_z = tile_tree->min_z;
+    const float * max_x = tile_tree->max_x;
+    const float * max_y = tile_tree->max_y;
+    const float * max_z = tile_tree->max_z;
+    for (int I = 0; I < tile_count; ++I)
     {
-      tile.level = 0;
+      int index = tile_tree->bottom_start + I;
+      int flags = (index == 0) ? root_flags :
+        tiles[(index - 1) >> 2].cull_flags;
+      if ((flags != SbFrustumCuller::CULL_IN) &&
+        (flags != SbFrustumCuller::CULL_OUT))
+      {
+        flags = frustum_culler.cull(index, flags, min_x[I], min_y[I],
+          min_z[I], max_x[I], max_y[I], max_z[I]);
+      }
+      if (flags == SbFrustumCuller::CULL_OUT)
+      {
+        levels[I] = SbGeoMipmapTile::LEVEL_NONE;
+      }
     }
-    else
+  }
+
+  /* Culling of the tiles behind the horizon. */
+  if (is_occlusion_culling)
+  {
+    cullOccluded();
+  }
+}
+
+void SoSimpleGeoMipmapTerrain::updateThresholds()
+{
+  /* Vypocet ctvercu vzdalenosti pro zobrazeni urovni detailu. */
+  const int tile_count = tile_tree->tile_count;
+  for (int J = 0; J < tile_tree->level_count; ++J)
+  {
+    float * thresholds = tile_tree->thresholds + (J * tile_count);
+    for (int I = 0; I < tile_count; ++I)
     {
-      tile.level = SbGeoMipmapTile::LEVEL_NONE;
+      thresholds[I] = SbSqr(tile_tree->getError(I, J) * distance_const);
     }
+  }
+  threshold_distance_const = distance_const;
+}
 
-    /* Vypocet indexu potomku. */
-    int first_index = (index << 2) + 1;
-    int second_index = first_index + 1;
-    int third_index = second_index + 1;
-    int fourth_index = third_index + 1;
+void SoSimpleGeoMipmapTerrain::cullOccluded()
+{
+  /* Children are pushed in reverse order, so the nearest one is taken from
+  the stack first. */
+  horizon_culler.reset(view_volume->getProjectionPoint());
+  SbGeoMipmapTile * tiles = tile_tree->tiles;
+  int * levels = tile_tree->levels;
+  const int bottom_start = tile_tree->bottom_start;
+  SbList<int> stack;
+  stack.push(0);
+  while (stack.getLength() > 0)
+  {
+    int index = stack.pop();
 
-    /* Vykresleni potomku dlazdice. */
-    recomputeTree(first_index, !tile.level);
-    recomputeTree(second_index, !tile.level);
-    recomputeTree(third_index, !tile.level);
-    recomputeTree(fourth_index, !tile.level);
+    /* Visible leaf tiles are tested and raise the horizon. */
+    if (index >= bottom_start)
+    {
+      int tile = index - bottom_start;
+      if (levels[tile] == SbGeoMipmapTile::LEVEL_NONE)
+      {
+        continue;
+      }
+      if (horizon_culler.isOccluded(tile_tree->min_x[tile],
+        tile_tree->min_y[tile], tile_tree->max_x[tile],
+        tile_tree->max_y[tile], tile_tree->max_z[tile]))
+      {
+        levels[tile] = SbGeoMipmapTile::LEVEL_NONE;
+      }
+      else
+      {
+        horizon_culler.addOccluder(tile_tree->min_x[tile],
+          tile_tree->min_y[tile], tile_tree->min_z[tile],
+          tile_tree->max_x[tile], tile_tree->max_y[tile]);
+      }
+      continue;
+    }
+
+    /* Leaf tiles of a hidden virtual tile form a continuous range. */
+    if (tiles[index].level == SbGeoMipmapTile::LEVEL_NONE)
+    {
+      continue;
+    }
+    if (horizon_culler.isOccluded(tiles[index].bounds))
+    {
+      tiles[index].level = SbGeoMipmapTile::LEVEL_NONE;
+      int first = index;
+      int count = 1;
+      while (first < bottom_start)
+      {
+        first = (first << 2) + 1;
+        count <<= 2;
+      }
+      for (int I = first - bottom_start; I < (first - bottom_start + count);
+        ++I)
+      {
+        levels[I] = SbGeoMipmapTile::LEVEL_NONE;
+      }
+      continue;
+    }
+
+    /* Children in the front to back order. */
+    int first_child = (index << 2) + 1;
+    SbBox3f boxes[4];
+    for (int I = 0; I < 4; ++I)
+    {
+      int child = first_child + I;
+      boxes[I] = (child >= bottom_start) ?
+        tile_tree->getBounds(child - bottom_start) : tiles[child].bounds;
+    }
+    int order[4];
+    horizon_culler.getChildOrder(boxes, order);
+    for (int I = 3; I >= 0; --I)
+    {
+      stack.push(first_child + order[I]);
+    }
   }
 }
 
-#define GL_SEND_VERTEX(index) vertex_index = index; \
-  if (is_texture) \
-    glTexCoord2fv(texture_coords[vertex_index].getValue()); \
-  if (is_normals) \
-    glNormal3fv(normals[vertex_index].getValue()); \
-  glVertex3fv(coords[vertex_index].getValue());
-
-void SoSimpleGeoMipmapTerrain::renderTree(SoAction * action, const int index)
+void SoSimpleGeoMipmapTerrain::morphTiles(const uint32_t context_id)
 {
-  SbGeoMipmapTile & tile = tile_tree->tiles[index];
+  if (!is_morphing && (morphed_vertices.getLength() == 0))
+  {
+    return;
+  }
 
-  /* Ma-li se dlazdice vykreslit. */
-  if (tile.level != SbGeoMipmapTile::LEVEL_NONE)
+  /* Morphed coordinates replace the height map in the vertex buffer. */
+  if (morph_coords == NULL)
   {
-    /* Neni-li dlazdice pouze virtualni dlazdici */
-    if (tile.levels != NULL)
+    int vertex_count = SbSqr(map_size);
+    morph_coords = new SbVec3f[vertex_count];
+    for (int I = 0; I < vertex_count; ++I)
     {
-      int vertex_index;
-
-      /* Vyber vrcholu urovne dlazdice, ktera se ma vykreslit. */
-      SbGeoMipmapTileLevel & level = tile.levels[tile.level];
-      int size = tile_tree->level_sizes[tile.level];
-      int * vertices = level.vertices;
-      int max_x = size;
-      int max_y = size;
-
-      // zkracene vyhodnoceni !!!
-      SbBool draw_right = (tile.right != NULL) && (tile.right->level !=
-        tile.level) && (tile.right->level != SbGeoMipmapTile::LEVEL_NONE);
-      SbBool draw_bottom = (tile.bottom != NULL) && (tile.bottom->level !=
-        tile.level) && (tile.bottom->level != SbGeoMipmapTile::LEVEL_NONE);
-
-      /* Napojeni sousedni dlazdice zprava. */
-      if (draw_right)
-      {
-        max_x--;
+      morph_coords[I] = coords[I];
+    }
+    vertex_buffer.setCoords(morph_coords);
+    changed_tiles = new SbBool[tile_tree->tile_count];
+    for (int I = 0; I < tile_tree->tile_count; ++I)
+    {
+      changed_tiles[I] = FALSE;
+    }
+    initMorphDeltas();
+  }
 
-        int right_level = tile.right->level;
-        int right_size = tile_tree->level_sizes[right_level];
+  /* Vertices morphed in the last frame get their heights back. */
+  for (int I = 0; I < morphed_vertices.getLength(); ++I)
+  {
+    int vertex = morphed_vertices[I];
+    morph_coords[vertex][2] = coords[vertex][2];
+  }
+  for (int I = 0; I < morphed_tiles.getLength(); ++I)
+  {
+    changed_tiles[getTileCell(morphed_tiles[I])] = TRUE;
+  }
+  morphed_vertices.truncate(0);
+  morphed_tiles.truncate(0);
 
-        /* Ma-li prava dlazdice mensi dataily. */
-        if (right_level > tile.level)
+  if (is_morphing)
+  {
+    /* Tiles morph in the last part of the distance range of their level,
+    they have the shape of the next level where the hysteresis band allows
+    to switch to it. */
+    const int tile_count = tile_tree->tile_count;
+    const int * levels = tile_tree->levels;
+    const float * distances = tile_tree->distances;
+    const float * morph_deltas = tile_tree->morph_deltas;
+    float band = SbClamp(level_hysteresis, 0.0f, 0.5f);
+    const float end_scale = 1.0f / SbSqr(1.0f - band);
+    for (int I = 0; I < tile_count; ++I)
+    {
+      int level = levels[I];
+      if ((level == SbGeoMipmapTile::LEVEL_NONE) ||
+        (level >= (tile_tree->level_count - 1)))
+      {
+        continue;
+      }
+      float threshold = tile_tree->thresholds[((level + 1) * tile_count) + I];
+      float morph = 1.0f;
+      if (threshold > 0.0f)
+      {
+        float ratio = sqrt((distances[I] * end_scale) / threshold);
+        morph = SbClamp((ratio - (1.0f - MORPH_RANGE)) / MORPH_RANGE, 0.0f,
+          1.0f);
+      }
+      if (morph <= 0.0f)
+      {
+        continue;
+      }
+      morphed_tiles.append(I);
+      changed_tiles[getTileCell(I)] = TRUE;
+
+      /* Shared right and bottom edges are drawn in the level of the visible
+      neighbour, which morphs them as its left and top edges. */
+      int right = tile_tree->right_tiles[I];
+      int bottom = tile_tree->bottom_tiles[I];
+      int edge_count = tile_tree->level_sizes[level + 1] - 1;
+      int count = tile_tree->morph_counts[level + 1] - (edge_count << 1);
+      int base = tile_tree->base_vertices[I];
+      const int * vertices = tile_tree->morph_vertices[level + 1];
+      int start = morphed_vertices.getLength();
+      for (int J = 0; J < count; ++J)
+      {
+        morphed_vertices.append(base + vertices[J]);
+      }
+      if ((right == -1) || (levels[right] == SbGeoMipmapTile::LEVEL_NONE))
+      {
+        for (int J = count; J < (count + edge_count); ++J)
         {
-          int fan_size = (size - 1) / (right_size - 1);
-          for (int Y = fan_size; Y < size; Y += fan_size)
-          {
-            glBegin(GL_TRIANGLE_FAN);
-            GL_SEND_VERTEX(vertices[(Y * size) + size - 1]);
-            int max_i = (Y == (size - 1)) && (draw_bottom) ? Y - 1 : Y;
-            for (int I = max_i; I >= (Y - fan_size); --I)
-            {
-              GL_SEND_VERTEX(vertices[(I * size) + size - 2]);
-            }
-            GL_SEND_VERTEX(vertices[((Y - fan_size) * size) + size - 1]);
-            glEnd();
-          }
+          morphed_vertices.append(base + vertices[J]);
         }
-        /* Ma-li prava dlazdice vetsi detaily. */
-        else if (tile.right->level < tile.level)
+      }
+      if ((bottom == -1) || (levels[bottom] == SbGeoMipmapTile::LEVEL_NONE))
+      {
+        for (int J = count + edge_count; J < (count + (edge_count << 1)); ++J)
         {
-          int fan_size = (right_size - 1) / (size - 1);
-          int * right_vertices = tile.right->levels[right_level].vertices;
-
-          for (int Y = 0; Y < (size - 1); ++Y)
-          {
-            glBegin(GL_TRIANGLE_FAN);
-            GL_SEND_VERTEX(vertices[(Y * size) + size - 2]);
-            for (int I = (Y * fan_size); I <= (Y * fan_size) + fan_size; ++I)
-            {
-              GL_SEND_VERTEX(right_vertices[I * right_size]);
-            }
-            if ((Y != (size - 2)) || (!draw_bottom))
-            {
-              GL_SEND_VERTEX(vertices[((Y + 1) * size) + size - 2]);
-            }
-            glEnd();
-          }
+          morphed_vertices.append(base + vertices[J]);
         }
       }
 
-      /* Napojeni sousedni dlazdice zdola. */
-      if (draw_bottom)
+      /* Heights move towards their interpolation in the next level. */
+      for (int J = start; J < morphed_vertices.getLength(); ++J)
+      {
+        int vertex = morphed_vertices[J];
+        morph_coords[vertex][2] = coords[vertex][2] + (morph *
+          morph_deltas[vertex]);
+      }
+
+      /* Strips stitched to the neighbours in the next level are morphed to
+      the stitching triangles. */
+      int next = level + 1;
+      int right_level = ((right != -1) && (levels[right] !=
+        SbGeoMipmapTile::LEVEL_NONE)) ? levels[right] : next;
+      int bottom_level = ((bottom != -1) && (levels[bottom] !=
+        SbGeoMipmapTile::LEVEL_NONE)) ? levels[bottom] : next;
+      int stitch = (((next * tile_tree->level_count) + right_level) *
+        tile_tree->level_count) + bottom_level;
+      const SbList<int> & stitch_vertices = morph_stitch_vertices[stitch];
+      const SbList<float> & stitch_weights = morph_stitch_weights[stitch];
+      for (int J = 0, K = 0; J < stitch_vertices.getLength(); J += 4, K += 3)
       {
-        max_y--;
+        int vertex = base + stitch_vertices[J];
+        float height = (stitch_weights[K] *
+          coords[base + stitch_vertices[J + 1]][2]) + (stitch_weights[K + 1] *
+          coords[base + stitch_vertices[J + 2]][2]) + (stitch_weights[K + 2] *
+          coords[base + stitch_vertices[J + 3]][2]);
+        morph_coords[vertex][2] = coords[vertex][2] + (morph * (height -
+          coords[vertex][2]));
+      }
+    }
+  }
+
+  uploadChangedTiles(context_id);
+}
 
-        int bottom_level = tile.bottom->level;
-        int bottom_size = tile_tree->level_sizes[bottom_level];
+void SoSimpleGeoMipmapTerrain::initMorphDeltas()
+{
+  int vertex_count = SbSqr(map_size);
+  tile_tree->morph_deltas = new float[vertex_count];
+  for (int I = 0; I < vertex_count; ++I)
+  {
+    tile_tree->morph_deltas[I] = 0.0f;
+  }
 
-        /* Ma-li spodni dlazdice mensi dataily. */
-        if (bottom_level > tile.level)
+  /* Every vertex left out by a level of detail lies in the middle of
+  a horizontal, vertical or diagonal edge of the triangles of the level and
+  is morphed to the height of the edge. Vertices of shared edges get the
+  same delta from both tiles. */
+  for (int I = 0; I < tile_tree->tile_count; ++I)
+  {
+    int base_vertex = tile_tree->base_vertices[I];
+    const SbVec3f * tile_coords = coords + base_vertex;
+    for (int J = 1; J < tile_tree->level_count; ++J)
+    {
+      const int * parent_vertices = tile_tree->level_vertices[J - 1];
+      int parent_size = tile_tree->level_sizes[J - 1];
+      for (int Y = 0; Y < parent_size; ++Y)
+      {
+        for (int X = 0; X < parent_size; ++X)
         {
-          int fan_size = (size - 1) / (bottom_size - 1);
-          for (int X = fan_size; X < size; X += fan_size)
+          if (!((X & 0x01) || (Y & 0x01)))
           {
-            glBegin(GL_TRIANGLE_FAN);
-            GL_SEND_VERTEX(vertices[((size - 1) * size) + X]);
-            GL_SEND_VERTEX(vertices[((size - 1) * size) + X - fan_size]);
-            int max_i = (X == (size - 1)) && (draw_right) ? X : X + 1;
-            for (int I = (X - fan_size); I < max_i; ++I)
-            {
-              GL_SEND_VERTEX(vertices[((size - 2) * size) + I]);
-            }
-            glEnd();
+            continue;
           }
+          int index = (Y * parent_size) + X;
+          int first = !(Y & 0x01) ? index - 1 : (!(X & 0x01) ? index -
+            parent_size : index - parent_size + 1);
+          int second = (index << 1) - first;
+          tile_tree->morph_deltas[base_vertex + parent_vertices[index]] =
+            ((tile_coords[parent_vertices[first]][2] +
+            tile_coords[parent_vertices[second]][2]) * 0.5f) -
+            tile_coords[parent_vertices[index]][2];
         }
-        /* Ma-li spodni dlazdice vetsi detaily. */
-        else if (tile.bottom->level < tile.level)
+      }
+    }
+  }
+}
+
+inline int SoSimpleGeoMipmapTerrain::getTileCell(const int tile) const
+{
+  int base_vertex = tile_tree->base_vertices[tile];
+  int step = tile_size - 1;
+  int side = (map_size - 1) / step;
+  return ((base_vertex / map_size / step) * side) +
+    ((base_vertex % map_size) / step);
+}
+
+void SoSimpleGeoMipmapTerrain::uploadChangedTiles(const uint32_t context_id)
+{
+  /* Rows of the height map are uploaded in runs of neighbouring changed
+  tiles. Runs closer than a tile row in the vertex array are joined, as
+  a call costs more than a short upload. The first and the last row of
+  a tile are shared with the tiles above and below. */
+  int step = tile_size - 1;
+  int side = (map_size - 1) / step;
+  int first = 0;
+  int count = 0;
+  for (int Y = 0; Y < map_size; ++Y)
+  {
+    int bottom_row = SbMin(Y / step, side - 1);
+    int top_row = ((Y > 0) && ((Y % step) == 0)) ? (Y / step) - 1 :
+      bottom_row;
+    const SbBool * top_cells = changed_tiles + (top_row * side);
+    const SbBool * bottom_cells = changed_tiles + (bottom_row * side);
+    for (int X = 0; X < side; ++X)
+    {
+      if (!top_cells[X] && !bottom_cells[X])
+      {
+        continue;
+      }
+      int start = X;
+      while ((X < (side - 1)) && (top_cells[X + 1] || bottom_cells[X + 1]))
+      {
+        ++X;
+      }
+      int run_first = (Y * map_size) + (start * step);
+      int run_count = ((X - start + 1) * step) + 1;
+      if ((count > 0) && (run_first <= (first + count + tile_size)))
+      {
+        count = SbMax(count, run_first + run_count - first);
+        continue;
+      }
+      vertex_buffer.updateCoords(context_id, first, count);
+      first = run_first;
+      count = run_count;
+    }
+  }
+  vertex_buffer.updateCoords(context_id, first, count);
+
+  for (int I = 0; I < tile_tree->tile_count; ++I)
+  {
+    changed_tiles[I] = FALSE;
+  }
+}
+
+void SoSimpleGeoMipmapTerrain::initIndices()
+{
+  /* Inner parts for every combination of stitched edges and stitching of
+  every combination of neighbour levels for every level of detail. */
+  const int level_count = tile_tree->level_count;
+  const int stitch_count = level_count * SbSqr(level_count);
+  body_indices = new SbList<GLuint>[level_count << 2];
+  stitch_indices = new SbList<GLuint>[stitch_count];
+  morph_stitch_vertices = new SbList<int>[stitch_count];
+  morph_stitch_weights = new SbList<float>[stitch_count];
+  for (int I = 0; I < level_count; ++I)
+  {
+    for (int J = 0; J < 4; ++J)
+    {
+      initBody(I, J & 0x01, J & 0x02, body_indices[(I << 2) + J]);
+    }
+    for (int J = 0; J < level_count; ++J)
+    {
+      for (int K = 0; K < level_count; ++K)
+      {
+        int stitch = (((I * level_count) + J) * level_count) + K;
+        initStitch(I, J, K, stitch_indices[stitch]);
+        if (I > 0)
         {
-          int fan_size = (bottom_size - 1) / (size - 1);
-          int * bottom_vertices = tile.bottom->levels[bottom_level].vertices;
+          initMorphStitch(I, stitch_indices[stitch],
+            morph_stitch_vertices[stitch], morph_stitch_weights[stitch]);
+        }
+      }
+    }
+  }
+}
 
-          for (int X = 0; X < (size - 1); ++X)
-          {
-            glBegin(GL_TRIANGLE_FAN);
-            GL_SEND_VERTEX(vertices[((size - 2) * size) + X]);
-            if ((X != (size - 2)) || (!draw_right))
-            {
-              GL_SEND_VERTEX(vertices[((size - 2) * size) + X + 1]);
-            }
-            for (int I = (X * fan_size) + fan_size; I >= (X * fan_size); --I)
-            {
-              GL_SEND_VERTEX(bottom_vertices[I]);
-            }
-            glEnd();
-          }
+void SoSimpleGeoMipmapTerrain::initBody(const int level,
+  const SbBool draw_right, const SbBool draw_bottom, SbList<GLuint> & indices)
+{
+  int size = tile_tree->level_sizes[level];
+  const int * vertices = tile_tree->level_vertices[level];
+
+  /* Stitched edges are left to the stitching. */
+  int max_x = draw_right ? size - 1 : size;
+  int max_y = draw_bottom ? size - 1 : size;
+
+  /* Two triangles for every quad, divided by the same diagonal as the error
+  metric uses. */
+  for (int Y = 0; Y < (max_y - 1); ++Y)
+  {
+    for (int X = 0; X < (max_x - 1); ++X)
+    {
+      int top_left = (Y * size) + X;
+      int bottom_left = top_left + size;
+      indices.append(vertices[bottom_left]);
+      indices.append(vertices[top_left]);
+      indices.append(vertices[top_left + 1]);
+      indices.append(vertices[bottom_left]);
+      indices.append(vertices[top_left + 1]);
+      indices.append(vertices[bottom_left + 1]);
+    }
+  }
+}
+
+void SoSimpleGeoMipmapTerrain::initStitch(const int level,
+  const int right_level, const int bottom_level, SbList<GLuint> & indices)
+{
+  int size = tile_tree->level_sizes[level];
+  const int * vertices = tile_tree->level_vertices[level];
+  SbBool draw_right = right_level != level;
+  SbBool draw_bottom = bottom_level != level;
+  SbList<GLuint> fan;
+
+  /* Napojeni sousedni dlazdice zprava. */
+  if (draw_right)
+  {
+    int right_size = tile_tree->level_sizes[right_level];
+
+    /* Ma-li prava dlazdice mensi dataily. */
+    if (right_level > level)
+    {
+      int fan_size = (size - 1) / (right_size - 1);
+      for (int Y = fan_size; Y < size; Y += fan_size)
+      {
+        fan.truncate(0);
+        fan.append(vertices[(Y * size) + size - 1]);
+        int max_i = (Y == (size - 1)) && (draw_bottom) ? Y - 1 : Y;
+        for (int I = max_i; I >= (Y - fan_size); --I)
+        {
+          fan.append(vertices[(I * size) + size - 2]);
         }
+        fan.append(vertices[((Y - fan_size) * size) + size - 1]);
+        appendFan(indices, fan);
       }
+    }
+    /* Ma-li prava dlazdice vetsi detaily. */
+    else if (right_level < level)
+    {
+      int fan_size = (right_size - 1) / (size - 1);
+      const int * right_vertices = tile_tree->level_vertices[right_level];
+      int right_offset = tile_tree->tile_size - 1;
 
-      /* Vykresleni vnitrku dlazdice. */
-      for (int Y = 0; Y < (max_y - 1); ++Y)
+      for (int Y = 0; Y < (size - 1); ++Y)
       {
-        glBegin(GL_QUAD_STRIP);
+        fan.truncate(0);
+        fan.append(vertices[(Y * size) + size - 2]);
+        for (int I = (Y * fan_size); I <= (Y * fan_size) + fan_size; ++I)
+        {
+          fan.append(right_offset + right_vertices[I * right_size]);
+        }
+        if ((Y != (size - 2)) || (!draw_bottom))
+        {
+          fan.append(vertices[((Y + 1) * size) + size - 2]);
+        }
+        appendFan(indices, fan);
+      }
+    }
+  }
 
-        /* Prvni dva vrcholy pasu. */
-        GL_SEND_VERTEX(vertices[(Y + 1) * size]);
-        GL_SEND_VERTEX(vertices[Y * size]);
+  /* Napojeni sousedni dlazdice zdola. */
+  if (draw_bottom)
+  {
+    int bottom_size = tile_tree->level_sizes[bottom_level];
 
-        for (int X = 1; X < max_x; ++X)
+    /* Ma-li spodni dlazdice mensi dataily. */
+    if (bottom_level > level)
+    {
+      int fan_size = (size - 1) / (bottom_size - 1);
+      for (int X = fan_size; X < size; X += fan_size)
+      {
+        fan.truncate(0);
+        fan.append(vertices[((size - 1) * size) + X]);
+        fan.append(vertices[((size - 1) * size) + X - fan_size]);
+        int max_i = (X == (size - 1)) && (draw_right) ? X : X + 1;
+        for (int I = (X - fan_size); I < max_i; ++I)
         {
-          /* Vykresleni dalsich dvou vrcholu pasu. */
-          GL_SEND_VERTEX(vertices[((Y + 1)  * size) + X]);
-          GL_SEND_VERTEX(vertices[(Y * size) + X]);
+          fan.append(vertices[((size - 2) * size) + I]);
         }
-        glEnd();
+        appendFan(indices, fan);
       }
     }
-    /* Dlazdice je virtualni. */
-    else
+    /* Ma-li spodni dlazdice vetsi detaily. */
+    else if (bottom_level < level)
     {
-      /* Vypocet indexu potomku. */
-      int first_index = (index << 2) + 1;
-      int second_index = first_index + 1;
-      int third_index = second_index + 1;
-      int fourth_index = third_index + 1;
-
-      /* Vykresleni potomku dlazdice. */
-      renderTree(action, first_index);
-      renderTree(action, second_index);
-      renderTree(action, third_index);
-      renderTree(action, fourth_index);
+      int fan_size = (bottom_size - 1) / (size - 1);
+      const int * bottom_vertices = tile_tree->level_vertices[bottom_level];
+      int bottom_offset = (tile_tree->tile_size - 1) * map_size;
+
+      for (int X = 0; X < (size - 1); ++X)
+      {
+        fan.truncate(0);
+        fan.append(vertices[((size - 2) * size) + X]);
+        if ((X != (size - 2)) || (!draw_right))
+        {
+          fan.append(vertices[((size - 2) * size) + X + 1]);
+        }
+        for (int I = (X * fan_size) + fan_size; I >= (X * fan_size); --I)
+        {
+          fan.append(bottom_offset + bottom_vertices[I]);
+        }
+        appendFan(indices, fan);
+      }
     }
   }
 }
 
-inline int SoSimpleGeoMipmapTerrain::pickLevel(const SbGeoMipmapTile & tile) const
+void SoSimpleGeoMipmapTerrain::initMorphStitch(const int level,
+  const SbList<GLuint> & stitch, SbList<int> & vertices,
+  SbList<float> & weights)
 {
-  /* Vypocet vzdalenosti kamery od dlazdice. */
-  SbVec3f camera_position = view_volume->getProjectionPoint();
-  float distance = (tile.center - camera_position).sqrLength();
+  int step = 1 << (level - 1);
+  int last = tile_tree->tile_size - 1;
+  SbBool * is_done = new SbBool[SbSqr(tile_tree->tile_size)];
+  for (int I = 0; I < SbSqr(tile_tree->tile_size); ++I)
+  {
+    is_done[I] = FALSE;
+  }
 
-  /* Vyber urovne detailu dlazdice podle vzdalenosti od kamery. */
-  for (int I = 0; I < tile_tree->level_count; ++I)
+  for (int I = 0; I < stitch.getLength(); I += 3)
   {
-    if (distance < SbSqr(tile.levels[I].error * distance_const))
+    /* Stitching of the neighbours lies in the area of the tile. */
+    int x[3];
+    int y[3];
+    for (int J = 0; J < 3; ++J)
     {
-      return I - 1;
+      x[J] = stitch[I + J] % map_size;
+      y[J] = stitch[I + J] / map_size;
     }
+    int area = ((x[1] - x[0]) * (y[2] - y[0])) - ((y[1] - y[0]) *
+      (x[2] - x[0]));
+    int min_x = SbMin(SbMin(x[0], x[1]), x[2]);
+    int min_y = SbMin(SbMin(y[0], y[1]), y[2]);
+    int max_x = SbMin(SbMax(SbMax(x[0], x[1]), x[2]), last - 1);
+    int max_y = SbMin(SbMax(SbMax(y[0], y[1]), y[2]), last - 1);
+
+    /* Vertices of the previous level in odd rows or columns inside of the
+    triangle. */
+    for (int Y = ((min_y + step - 1) / step) * step; Y <= max_y; Y += step)
+    {
+      for (int X = ((min_x + step - 1) / step) * step; X <= max_x; X += step)
+      {
+        if (!(((X / step) | (Y / step)) & 0x01) ||
+          is_done[(Y * tile_tree->tile_size) + X])
+        {
+          continue;
+        }
+        int first = ((X - x[0]) * (y[2] - y[0])) - ((Y - y[0]) *
+          (x[2] - x[0]));
+        int second = ((x[1] - x[0]) * (Y - y[0])) - ((y[1] - y[0]) *
+          (X - x[0]));
+        int third = area - first - second;
+        if ((area < 0) ? ((first > 0) || (second > 0) || (third > 0)) :
+          ((first < 0) || (second < 0) || (third < 0)))
+        {
+          continue;
+        }
+        is_done[(Y * tile_tree->tile_size) + X] = TRUE;
+        vertices.append((Y * map_size) + X);
+        vertices.append(stitch[I]);
+        vertices.append(stitch[I + 1]);
+        vertices.append(stitch[I + 2]);
+        weights.append(static_cast<float>(third) / area);
+        weights.append(static_cast<float>(first) / area);
+        weights.append(static_cast<float>(second) / area);
+      }
+    }
+  }
+  delete[] is_done;
+}
+
+void SoSimpleGeoMipmapTerrain::appendFan(SbList<GLuint> & indices,
+  const SbList<GLuint> & fan)
+{
+  for (int I = 1; I < (fan.getLength() - 1); ++I)
+  {
+    indices.append(fan[0]);
+    indices.append(fan[I]);
+    indices.append(fan[I + 1]);
   }
-  return tile_tree->level_count - 1;
+}
+
+void SoSimpleGeoMipmapTerrain::addTile(const int tile)
+{
+  const int * levels = tile_tree->levels;
+  int level = levels[tile];
+  int right = tile_tree->right_tiles[tile];
+  int bottom = tile_tree->bottom_tiles[tile];
+
+  /* Neighbours with another visible level are stitched. */
+  int right_level = ((right != -1) && (levels[right] !=
+    SbGeoMipmapTile::LEVEL_NONE)) ? levels[right] : level;
+  int bottom_level = ((bottom != -1) && (levels[bottom] !=
+    SbGeoMipmapTile::LEVEL_NONE)) ? levels[bottom] : level;
+  const SbList<GLuint> & body = body_indices[(level << 2) +
+    ((right_level != level) ? 0x01 : 0) + ((bottom_level != level) ? 0x02 : 0)];
+  const SbList<GLuint> & stitch = stitch_indices[(((level *
+    tile_tree->level_count) + right_level) * tile_tree->level_count) +
+    bottom_level];
+
+  int base = tile_tree->base_vertices[tile];
+  addDraw(body, base);
+  addDraw(stitch, base);
+}
+
+inline void SoSimpleGeoMipmapTerrain::addDraw(const SbList<GLuint> & indices,
+  const int base)
+{
+  int length = indices.getLength();
+  if (length == 0)
+  {
+    return;
+  }
+
+  /* Shared indices are drawn with the base vertex of the tile, or moved to
+  the frame indices if the base vertex is not supported. */
+  if (multi_draw_func != NULL)
+  {
+    draw_counts.append(length);
+    draw_indices.append(indices.getArrayPtr());
+    draw_bases.append(base);
+  }
+  else
+  {
+    for (int I = 0; I < length; ++I)
+    {
+      frame_indices.append(indices[I] + base);
+    }
+  }
+}
+
+void SoSimpleGeoMipmapTerrain::initDrawFunc(const uint32_t context_id)
+{
+  /* glMultiDrawElementsBaseVertex is in OpenGL 3.2 and in the
+  GL_ARB_draw_elements_base_vertex extension. */
+  const cc_glglue * glue = cc_glglue_instance(context_id);
+  multi_draw_func = NULL;
+  if (cc_glglue_glversion_matches_at_least(glue, 3, 2, 0) ||
+    cc_glglue_glext_supported(glue, "GL_ARB_draw_elements_base_vertex"))
+  {
+    multi_draw_func = reinterpret_cast<SbGLMultiDrawElementsBaseVertex>(
+      cc_glglue_getprocaddress(glue, "glMultiDrawElementsBaseVertex"));
+  }
+  draw_context_id = context_id;
+  is_draw_context = TRUE;
 }
 
 void SoSimpleGeoMipmapTerrain::mapSizeChangedCB(void * _instance,
@@ -672,6 +1340,42 @@ void SoSimpleGeoMipmapTerrain::freezeChangedCB(void * _instance,
   instance->is_freeze = instance->freeze.getValue();
 }
 
+void SoSimpleGeoMipmapTerrain::occlusionCullingChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoSimpleGeoMipmapTerrain * instance =
+    reinterpret_cast<SoSimpleGeoMipmapTerrain *>(_instance);
+  instance->is_occlusion_culling = instance->occlusionCulling.getValue();
+}
+
+void SoSimpleGeoMipmapTerrain::levelHysteresisChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoSimpleGeoMipmapTerrain * instance =
+    reinterpret_cast<SoSimpleGeoMipmapTerrain *>(_instance);
+  instance->level_hysteresis = instance->levelHysteresis.getValue();
+}
+
+void SoSimpleGeoMipmapTerrain::morphingChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoSimpleGeoMipmapTerrain * instance =
+    reinterpret_cast<SoSimpleGeoMipmapTerrain *>(_instance);
+  instance->is_morphing = instance->morphing.getValue();
+}
+
+void SoSimpleGeoMipmapTerrain::threadCountChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoSimpleGeoMipmapTerrain * instance =
+    reinterpret_cast<SoSimpleGeoMipmapTerrain *>(_instance);
+  instance->thread_count = instance->threadCount.getValue();
+}
+
 /******************************************************************************
 * SoSimpleGeoMipmapTerrain - private
 ******************************************************************************/
@@ -680,9 +1384,19 @@ SoSimpleGeoMipmapTerrain::~SoSimpleGeoMipmapTerrain()
 {
   /* Uvolneni pameti. */
   delete tile_tree;
+  delete[] body_indices;
+  delete[] stitch_indices;
+  delete[] morph_stitch_vertices;
+  delete[] morph_stitch_weights;
+  delete[] morph_coords;
+  delete[] changed_tiles;
   delete map_size_sensor;
   delete tile_size_sensor;
   delete pixel_error_sensor;
   delete frustum_culling_sensor;
   delete freeze_sensor;
+  delete occlusion_culling_sensor;
+  delete level_hysteresis_sensor;
+  delete morphing_sensor;
+  delete thread_count_sensor;
 }
@@ -0,0 +1,331 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Bucketed priority queues of the ROAM algorithm.
+/// \file SbROAMBucketQueue.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// The split and merge queues only need an approximate order of their items,
+/// because the priorities change every frame anyway. The bucketed queues
+/// quantize the priority to a fixed number of buckets and keep an intrusive
+/// list of items in every bucket, so that insertion, removal and change of
+/// priority cost O(1) instead of O(log n) of the binary heap.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+
+// standardni includy
+#include <cstring>
+
+// lokalni includy
+#include <roam/SbROAMBucketQueue.h>
+#include <roam/SbROAMPrimitives.h>
+
+/******************************************************************************
+* SbROAMBucketQueue - public
+******************************************************************************/
+
+const int SbROAMBucketQueue::BUCKET_COUNT;
+
+SbROAMBucketQueue::SbROAMBucketQueue(const int init_size):
+  items(init_size), buckets(NULL), max_bucket(-1), min_bucket(BUCKET_COUNT)
+{
+  /* All buckets are empty. */
+  buckets = new SbROAMQueueItem * [BUCKET_COUNT];
+  memset(buckets, 0, BUCKET_COUNT * sizeof(SbROAMQueueItem *));
+}
+
+SbROAMBucketQueue::~SbROAMBucketQueue()
+{
+  delete[] buckets;
+}
+
+void SbROAMBucketQueue::emptyQueue()
+{
+  /* Clear the non-empty buckets and the list of items. */
+  for (int I = min_bucket; I <= max_bucket; ++I)
+  {
+    buckets[I] = NULL;
+  }
+  items.truncate(0);
+  max_bucket = -1;
+  min_bucket = BUCKET_COUNT;
+}
+
+void SbROAMBucketQueue::add(SbROAMQueueItem * item)
+{
+  /* Append the item to the list and link it to its bucket. */
+  items.append(item);
+  item->index = items.getLength();
+  link(item);
+}
+
+void SbROAMBucketQueue::remove(SbROAMQueueItem * item)
+{
+  unlink(item);
+
+  /* The last item of the list takes the place of the removed one. */
+  int index = item->index - 1;
+  items.removeFast(index);
+  if (index < items.getLength())
+  {
+    items[index]->index = index + 1;
+  }
+  item->index = -1;
+}
+
+void SbROAMBucketQueue::update(SbROAMQueueItem * item)
+{
+  /* Move the item only if its bucket has changed. */
+  int bucket = getBucket(item->priority);
+  if (bucket != item->bucket)
+  {
+    unlink(item);
+    link(item);
+  }
+}
+
+void SbROAMBucketQueue::rebuild()
+{
+  /* Clear the buckets and sort all items again. */
+  for (int I = min_bucket; I <= max_bucket; ++I)
+  {
+    buckets[I] = NULL;
+  }
+  max_bucket = -1;
+  min_bucket = BUCKET_COUNT;
+  for (int I = 0; I < items.getLength(); ++I)
+  {
+    link(items[I]);
+  }
+}
+
+SbROAMQueueItem * SbROAMBucketQueue::getMax()
+{
+  if (items.getLength() == 0)
+  {
+    return NULL;
+  }
+
+  /* Move the upper bound to the highest non-empty bucket. */
+  while (buckets[max_bucket] == NULL)
+  {
+    --max_bucket;
+  }
+  return buckets[max_bucket];
+}
+
+SbROAMQueueItem * SbROAMBucketQueue::getMin()
+{
+  if (items.getLength() == 0)
+  {
+    return NULL;
+  }
+
+  /* Move the lower bound to the lowest non-empty bucket. */
+  while (buckets[min_bucket] == NULL)
+  {
+    ++min_bucket;
+  }
+  return buckets[min_bucket];
+}
+
+/******************************************************************************
+* SbROAMBucketQueue - private
+******************************************************************************/
+
+inline void SbROAMBucketQueue::link(SbROAMQueueItem * item)
+{
+  /* Insert the item at the head of its bucket. */
+  int bucket = getBucket(item->priority);
+  item->bucket = bucket;
+  item->previous = NULL;
+  item->next = buckets[bucket];
+  if (item->next != NULL)
+  {
+    item->next->previous = item;
+  }
+  buckets[bucket] = item;
+
+  /* Extend the bounds of the non-empty buckets. */
+  max_bucket = SbMax(max_bucket, bucket);
+  min_bucket = SbMin(min_bucket, bucket);
+}
+
+inline void SbROAMBucketQueue::unlink(SbROAMQueueItem * item)
+{
+  /* Unlink the item from the list of its bucket. */
+  if (item->previous != NULL)
+  {
+    item->previous->next = item->next;
+  }
+  else
+  {
+    buckets[item->bucket] = item->next;
+  }
+  if (item->next != NULL)
+  {
+    item->next->previous = item->previous;
+  }
+  item->previous = NULL;
+  item->next = NULL;
+}
+
+/******************************************************************************
+* SbROAMBucketSplitQueue - public
+******************************************************************************/
+
+SbROAMBucketSplitQueue::SbROAMBucketSplitQueue(const int init_size):
+  queue(init_size)
+{
+  // nic
+}
+
+SbROAMBucketSplitQueue::~SbROAMBucketSplitQueue()
+{
+  // nic
+}
+
+SbROAMSplitQueue::Type SbROAMBucketSplitQueue::getType() const
+{
+  return BUCKETS;
+}
+
+void SbROAMBucketSplitQueue::emptyQueue()
+{
+  queue.emptyQueue();
+}
+
+void SbROAMBucketSplitQueue::add(SbROAMSplitQueueTriangle * triangle)
+{
+  queue.add(triangle);
+}
+
+void SbROAMBucketSplitQueue::remove(SbROAMSplitQueueTriangle * triangle)
+{
+  queue.remove(triangle);
+}
+
+SbROAMSplitQueueTriangle * SbROAMBucketSplitQueue::extractMax()
+{
+  /* Take a triangle with the highest priority. */
+  SbROAMSplitQueueTriangle * triangle = getMax();
+  if (triangle != NULL)
+  {
+    queue.remove(triangle);
+  }
+  return triangle;
+}
+
+SbROAMSplitQueueTriangle * SbROAMBucketSplitQueue::getMax()
+{
+  return static_cast<SbROAMSplitQueueTriangle *>(queue.getMax());
+}
+
+SbROAMSplitQueueTriangle * SbROAMBucketSplitQueue::operator[](const int
+  index)
+{
+  return static_cast<SbROAMSplitQueueTriangle *>(queue[index]);
+}
+
+int SbROAMBucketSplitQueue::size() const
+{
+  return queue.size();
+}
+
+void SbROAMBucketSplitQueue::update(SbROAMSplitQueueTriangle * triangle)
+{
+  queue.update(triangle);
+}
+
+void SbROAMBucketSplitQueue::rebuild()
+{
+  queue.rebuild();
+}
+
+/******************************************************************************
+* SbROAMBucketMergeQueue - public
+******************************************************************************/
+
+SbROAMBucketMergeQueue::SbROAMBucketMergeQueue(const int init_size):
+  queue(init_size)
+{
+  // nic
+}
+
+SbROAMBucketMergeQueue::~SbROAMBucketMergeQueue()
+{
+  // nic
+}
+
+SbROAMMergeQueue::Type SbROAMBucketMergeQueue::getType() const
+{
+  return BUCKETS;
+}
+
+void SbROAMBucketMergeQueue::emptyQueue()
+{
+  queue.emptyQueue();
+}
+
+void SbROAMBucketMergeQueue::add(SbROAMMergeQueueDiamond * diamond)
+{
+  queue.add(diamond);
+}
+
+void SbROAMBucketMergeQueue::remove(SbROAMMergeQueueDiamond * diamond)
+{
+  queue.remove(diamond);
+}
+
+SbROAMMergeQueueDiamond * SbROAMBucketMergeQueue::extractMin()
+{
+  /* Take a diamond with the lowest priority. */
+  SbROAMMergeQueueDiamond * diamond = getMin();
+  if (diamond != NULL)
+  {
+    queue.remove(diamond);
+  }
+  return diamond;
+}
+
+SbROAMMergeQueueDiamond * SbROAMBucketMergeQueue::getMin()
+{
+  return static_cast<SbROAMMergeQueueDiamond *>(queue.getMin());
+}
+
+SbROAMMergeQueueDiamond * SbROAMBucketMergeQueue::operator[](const int index)
+{
+  return static_cast<SbROAMMergeQueueDiamond *>(queue[index]);
+}
+
+int SbROAMBucketMergeQueue::size() const
+{
+  return queue.size();
+}
+
+void SbROAMBucketMergeQueue::update(SbROAMMergeQueueDiamond * diamond)
+{
+  queue.update(diamond);
+}
+
+void SbROAMBucketMergeQueue::rebuild()
+{
+  queue.rebuild();
+}
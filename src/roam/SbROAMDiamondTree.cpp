@@ -0,0 +1,124 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Diamonds of the diamond based ROAM algorithm.
+/// \file SbROAMDiamondTree.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// Every vertex of the height map except of its corners is the center of one
+/// diamond, which is split when the vertex is part of the triangulation. The
+/// ::SbROAMDiamondTree class keeps one record per vertex in an array indexed
+/// like the height map and finds parents, children and the hypotenuse of a
+/// diamond from the coordinates of its center.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// lokalni includy
+#include <roam/SbROAMDiamondTree.h>
+
+/******************************************************************************
+* SbROAMDiamondTree - public
+******************************************************************************/
+
+SbROAMDiamondTree::SbROAMDiamondTree(const SbVec3f * _coords,
+  const int _map_size):
+  coords(_coords), map_size(_map_size), diamonds(NULL)
+{
+  diamonds = new SbROAMDiamond[map_size * map_size];
+
+  /* Corners of the map are the parents of the root. */
+  int last = map_size - 1;
+  diamonds[0].flags = SbROAMDiamond::IS_SPLIT | SbROAMDiamond::IS_VIRTUAL;
+  diamonds[last].flags = SbROAMDiamond::IS_SPLIT |
+    SbROAMDiamond::IS_VIRTUAL;
+  diamonds[last * map_size].flags = SbROAMDiamond::IS_SPLIT |
+    SbROAMDiamond::IS_VIRTUAL;
+  diamonds[last * map_size + last].flags = SbROAMDiamond::IS_SPLIT |
+    SbROAMDiamond::IS_VIRTUAL;
+}
+
+SbROAMDiamondTree::~SbROAMDiamondTree()
+{
+  delete[] diamonds;
+}
+
+void SbROAMDiamondTree::build()
+{
+  /* Children of edge diamonds are square diamonds of the half scale,
+  children of square diamonds are edge diamonds of the same scale. */
+  int last = map_size - 1;
+  for (int scale = 1; scale < last; scale <<= 1)
+  {
+    for (int y = 0; y <= last; y += scale)
+    {
+      for (int x = ((y / scale) & 1) ? 0 : scale; x <= last;
+        x += scale << 1)
+      {
+        computeMetric(y * map_size + x);
+      }
+    }
+    for (int y = scale; y <= last; y += scale << 1)
+    {
+      for (int x = scale; x <= last; x += scale << 1)
+      {
+        computeMetric(y * map_size + x);
+      }
+    }
+  }
+}
+
+/******************************************************************************
+* SbROAMDiamondTree - private
+******************************************************************************/
+
+void SbROAMDiamondTree::computeMetric(const int index)
+{
+  /* Height difference of the center and the middle of the hypotenuse. */
+  const SbVec3f & center = coords[index];
+  int first = 0;
+  int second = 0;
+  getHypotenuse(index, first, second);
+  float error = SbAbs(center[2] - (coords[first][2] + coords[second][2]) *
+    0.5f);
+
+  /* The sphere contains the corners of the diamond. */
+  float radius = SbMax((coords[first] - center).length(),
+    (coords[second] - center).length());
+  int parents[2];
+  int parent_count = getParents(index, parents);
+  for (int I = 0; I < parent_count; ++I)
+  {
+    radius = SbMax(radius, (coords[parents[I]] - center).length());
+  }
+
+  /* Error is accumulated over the descendants and the sphere contains the
+  spheres of the children like in the binary triangle tree. */
+  int children[4];
+  int child_count = getChildren(index, children);
+  float child_error = 0.0f;
+  for (int I = 0; I < child_count; ++I)
+  {
+    const SbROAMDiamond & child = diamonds[children[I]];
+    child_error = SbMax(child_error, child.error);
+    radius = SbMax(radius, (coords[children[I]] - center).length() +
+      child.radius);
+  }
+  diamonds[index].error = error + child_error;
+  diamonds[index].radius = radius;
+}
@@ -31,16 +31,24 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <roam/SbROAMMergeQueue.h>
+#include <roam/SbROAMBucketQueue.h>
 #include <roam/SbROAMPrimitives.h>
 
 /******************************************************************************
 * SbROAMMergeQueue - public
 ******************************************************************************/
 
-SbROAMMergeQueue::SbROAMMergeQueue(const int init_size):
-  SbHeap(heap_funcs, init_size)
+SbROAMMergeQueue * SbROAMMergeQueue::create(const Type type)
 {
-  // nic
+  /* Create the queue of the requested type. */
+  switch (type)
+  {
+    case BUCKETS:
+      return new SbROAMBucketMergeQueue();
+    case HEAP:
+    default:
+      return new SbROAMHeapMergeQueue();
+  }
 }
 
 SbROAMMergeQueue::~SbROAMMergeQueue()
@@ -48,23 +56,6 @@ SbROAMMergeQueue::~SbROAMMergeQueue()
   // nic
 }
 
-void SbROAMMergeQueue::emptyQueue()
-{
-  SbHeap::emptyHeap(); // vyprazdneni fronty
-}
-
-void SbROAMMergeQueue::add(SbROAMMergeQueueDiamond * diamond)
-{
-  /* Vlozeni diamondu a aktualizace indexu ve fronte. */
-  int index = SbHeap::add(diamond);
-  diamond->index = index;
-}
-
-void SbROAMMergeQueue::remove(SbROAMMergeQueueDiamond * diamond)
-{
-  SbHeap::remove(diamond->index); // odstraneni diamondu z fronty
-}
-
 SbROAMMergeQueueDiamond * SbROAMMergeQueue::remove(
   SbROAMSplitQueueTriangle * triangle)
 {
@@ -82,48 +73,100 @@ SbROAMMergeQueueDiamond * SbROAMMergeQueue::remove(
       diamond->third->diamond = NULL;
       diamond->fourth->diamond = NULL;
     }
-    SbHeap::remove(diamond->index); // odstraneni diamondu z fronty
+    remove(diamond); // odstraneni diamondu z fronty
   }
   return diamond;
 }
 
-SbROAMMergeQueueDiamond * SbROAMMergeQueue::extractMin()
+/******************************************************************************
+* SbROAMHeapMergeQueue - public
+******************************************************************************/
+
+SbROAMHeapMergeQueue::SbROAMHeapMergeQueue(const int init_size):
+  SbHeap(heap_funcs, init_size)
+{
+  // nic
+}
+
+SbROAMHeapMergeQueue::~SbROAMHeapMergeQueue()
+{
+  // nic
+}
+
+SbROAMMergeQueue::Type SbROAMHeapMergeQueue::getType() const
+{
+  return HEAP;
+}
+
+void SbROAMHeapMergeQueue::emptyQueue()
+{
+  SbHeap::emptyHeap(); // vyprazdneni fronty
+}
+
+void SbROAMHeapMergeQueue::add(SbROAMMergeQueueDiamond * diamond)
+{
+  /* Vlozeni diamondu a aktualizace indexu ve fronte. */
+  int index = SbHeap::add(diamond);
+  diamond->index = index;
+}
+
+void SbROAMHeapMergeQueue::remove(SbROAMMergeQueueDiamond * diamond)
+{
+  SbHeap::remove(diamond->index); // odstraneni diamondu z fronty
+}
+
+SbROAMMergeQueueDiamond * SbROAMHeapMergeQueue::extractMin()
 {
   /* Vyber trojuhelniku s maximalni prioritou. */
   return reinterpret_cast<SbROAMMergeQueueDiamond *>(SbHeap::extractMin());
 }
 
-SbROAMMergeQueueDiamond * SbROAMMergeQueue::getMin()
+SbROAMMergeQueueDiamond * SbROAMHeapMergeQueue::getMin()
 {
   /* Vraceni trojuhelniku s maximalni prioritou. */
   return reinterpret_cast<SbROAMMergeQueueDiamond *>(SbHeap::getMin());
 }
 
-SbROAMMergeQueueDiamond * SbROAMMergeQueue::operator[](const int index)
+SbROAMMergeQueueDiamond * SbROAMHeapMergeQueue::operator[](const int index)
 {
   return reinterpret_cast<SbROAMMergeQueueDiamond *>(SbHeap::operator[](index));
 }
 
+int SbROAMHeapMergeQueue::size() const
+{
+  return SbHeap::size();
+}
+
+void SbROAMHeapMergeQueue::update(SbROAMMergeQueueDiamond * diamond)
+{
+  SbHeap::newWeight(diamond, diamond->index); // move the diamond in the heap
+}
+
+void SbROAMHeapMergeQueue::rebuild()
+{
+  SbHeap::buildHeap(NULL, NULL); // restore the heap
+}
+
 /******************************************************************************
-* SbROAMMergeQueue - protected
+* SbROAMHeapMergeQueue - protected
 ******************************************************************************/
 
-SbHeapFuncs SbROAMMergeQueue::heap_funcs = {getDiamondPriority, getDiamondIndex,
-  setDiamondIndex};
+SbHeapFuncs SbROAMHeapMergeQueue::heap_funcs = {getDiamondPriority,
+  getDiamondIndex, setDiamondIndex};
 
-float SbROAMMergeQueue::getDiamondPriority(void * diamond)
+float SbROAMHeapMergeQueue::getDiamondPriority(void * diamond)
 {
   /* Zjisteni priority diamondu ve fronte. */
   return reinterpret_cast<SbROAMMergeQueueDiamond * >(diamond)->priority;
 }
 
-int SbROAMMergeQueue::getDiamondIndex(void * diamond)
+int SbROAMHeapMergeQueue::getDiamondIndex(void * diamond)
 {
   /* Zjisteni priority diamondu ve fronte. */
   return reinterpret_cast<SbROAMMergeQueueDiamond * >(diamond)->index;
 }
 
-void SbROAMMergeQueue::setDiamondIndex(void * diamond, int index)
+void SbROAMHeapMergeQueue::setDiamondIndex(void * diamond, int index)
 {
   /* Nataveni priority diamondu ve fronte. */
   reinterpret_cast<SbROAMMergeQueueDiamond * >(diamond)->index = index;
@@ -31,29 +31,422 @@
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 ///////////////////////////////////////////////////////////////////////////////
 
+// OpenInventor includy
+#include <Inventor/SbString.h>
+
+// standardni includy
+#include <cstdio>
+#if !defined(__WIN32__) && !defined(_WIN32)
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+// lokalni includy
 #include <roam/SbROAMPrimitives.h>
+#include <SbTaskPool.h>
 
 /******************************************************************************
 * SbROAMTriangle - public
 ******************************************************************************/
 
-SbROAMTriangle::SbROAMTriangle(int _first, int _second, int _apex, int _level):
-  first(_first), second(_second), apex(_apex), level(_level), error(0.0f),
-  radius(0.0)
+SbROAMTriangle::SbROAMTriangle(int _first, int _second, int _apex, int _level,
+  int _index):
+  first(_first), second(_second), apex(_apex), level(_level), index(_index),
+  error(0.0f), radius(0.0)
 {
   // nic
 }
 
+/******************************************************************************
+* SbROAMTriangleTree - public
+******************************************************************************/
+
+SbROAMTriangleTree::SbROAMTriangleTree(const SbVec3f * _coords,
+  const int _map_size, const int culled_levels):
+  coords(_coords), map_size(_map_size), level(0), stored_level(0), size(0),
+  metrics(NULL), mapping(NULL), mapping_size(0), hash(0), is_hash(FALSE)
+{
+  /* Vypocet levelu jako 2 * log2(map_size - 1) */
+  int tmp_size = map_size - 1;
+  while (tmp_size > 1)
+  {
+    level += 2;
+    tmp_size >>= 1;
+  }
+
+  /* Korenove urovne se oriznout nedaji. */
+  stored_level = SbMax(level - SbMax(culled_levels, 0), SbMin(level, 1));
+
+  /* Pocet ulozenych trojuhelniku, 2^(stored_level + 1) - 1. Metrika se
+  alokuje az pri jejim vypoctu nebo nacteni. */
+  size = (1 << (stored_level + 1)) - 1;
+}
+
+SbROAMTriangleTree::~SbROAMTriangleTree()
+{
+  releaseMetrics();
+}
+
+void SbROAMTriangleTree::getRoot(const int index, SbROAMTriangle & triangle)
+  const
+{
+  /* Vypocet indexu rohovych vertexu mapy. */
+  int top_left = 0;
+  int top_right = map_size - 1;
+  int bottom_left = map_size * (map_size - 1);
+  int bottom_right = map_size * map_size - 1;
+
+  /* Oba koreny sdili diagonalu mapy. */
+  if (index == 1)
+  {
+    triangle = SbROAMTriangle(top_left, bottom_right, top_right, 1, 1);
+  }
+  else
+  {
+    triangle = SbROAMTriangle(bottom_right, top_left, bottom_left, 1, 2);
+  }
+}
+
+void SbROAMTriangleTree::getTriangle(const int index, SbROAMTriangle &
+  triangle) const
+{
+  /* Cesta od trojuhelniku ke koreni jako posloupnost levych a pravych
+  potomku. */
+  unsigned int path = 0;
+  int depth = 0;
+  int root = index;
+  while (root > 2)
+  {
+    path = (path << 1) | (root & 1);
+    root = (root - 1) >> 1;
+    ++depth;
+  }
+
+  /* Sestup od korene po zaznamenane ceste. */
+  getRoot(root, triangle);
+  for (int I = 0; I < depth; ++I, path >>= 1)
+  {
+    SbROAMTriangle left_child;
+    SbROAMTriangle right_child;
+    getChildren(triangle, left_child, right_child);
+    triangle = (path & 1) ? left_child : right_child;
+  }
+  loadMetric(triangle);
+}
+
+void SbROAMTriangleTree::computeMetric(SbROAMTriangle & triangle) const
+{
+  /* Trojuhelniky na dne stromu maji nulovou metriku. */
+  if (triangle.level >= level)
+  {
+    triangle.error = PRIORITY_MIN;
+    triangle.radius = 0.0f;
+    return;
+  }
+
+  /* Vrcholy trojuhelniku a metrika jeho potomku. */
+  const SbVec3f & first = coords[triangle.first];
+  const SbVec3f & second = coords[triangle.second];
+  const SbVec3f & apex = coords[triangle.apex];
+  SbROAMTriangle left_child;
+  SbROAMTriangle right_child;
+  getChildren(triangle, left_child, right_child);
+  loadMetric(left_child);
+  loadMetric(right_child);
+
+  /* Vypocet "podpadku" jako maximum chyby obou potomku + rozdil vysky
+  vrcholu s pravym uhlem a prumene vysky obou vrcholu prepony. */
+  float error = SbMax(left_child.error, right_child.error) +
+    SbAbs(apex[2] - (first[2] + second[2]) * 0.5f);
+
+  /* Vypocet polomeru kuloplochy ohranicujici trojuhelnik. */
+  const SbVec3f & left_apex = coords[left_child.apex];
+  const SbVec3f & right_apex = coords[right_child.apex];
+  float left_radius = (apex - left_apex).length() + left_child.radius;
+  float right_radius = (apex - right_apex).length() + right_child.radius;
+  float radius = SbMax(left_radius, right_radius);
+
+  /* Kvantovani stejne jako u ulozenych hodnot. */
+  triangle.error = decode(encode(error));
+  triangle.radius = decode(encode(radius));
+}
+
+void SbROAMTriangleTree::build(const int thread_count)
+{
+  /* Allocation of the storage of the metric. */
+  releaseMetrics();
+  metrics = new SbROAMTriangleMetric[size];
+  memset(metrics, 0, size * sizeof(SbROAMTriangleMetric));
+
+  SbTaskPool pool(thread_count);
+  SbROAMTriangle roots[2];
+  getRoot(1, roots[0]);
+  getRoot(2, roots[1]);
+
+  /* The split level gives at least eight subtrees per thread. */
+  int split_level = 1;
+  while (((1 << split_level) < (pool.getThreadCount() << 3)) &&
+    (split_level < stored_level))
+  {
+    ++split_level;
+  }
+
+  /* Small trees and single thread builds are not split. */
+  if ((pool.getThreadCount() == 1) || (split_level >= stored_level))
+  {
+    buildSubtree(roots[0], stored_level);
+    buildSubtree(roots[1], stored_level);
+    return;
+  }
+
+  /* Roots of the subtrees at the split level. */
+  SbList<SbROAMTriangle> subtrees;
+  subtrees.append(roots[0]);
+  subtrees.append(roots[1]);
+  for (int I = 1; I < split_level; ++I)
+  {
+    SbList<SbROAMTriangle> children;
+    for (int J = 0; J < subtrees.getLength(); ++J)
+    {
+      SbROAMTriangle left_child;
+      SbROAMTriangle right_child;
+      getChildren(subtrees[J], left_child, right_child);
+      children.append(left_child);
+      children.append(right_child);
+    }
+    subtrees = children;
+  }
+
+  /* Parallel build of the subtrees. */
+  SbROAMBuildTask * tasks = new SbROAMBuildTask[subtrees.getLength()];
+  for (int I = 0; I < subtrees.getLength(); ++I)
+  {
+    tasks[I].tree = this;
+    tasks[I].root = subtrees[I];
+    pool.addTask(buildTask, &tasks[I]);
+  }
+  pool.waitAll();
+  delete[] tasks;
+
+  /* Build of the levels above the subtrees. */
+  buildSubtree(roots[0], split_level - 1);
+  buildSubtree(roots[1], split_level - 1);
+}
+
+uint64_t SbROAMTriangleTree::getHash() const
+{
+  if (!is_hash)
+  {
+    /* FNV-1a hash of the size and of all coordinates taken as 32-bit
+    words. */
+    uint64_t value = 14695981039346656037ULL;
+    value = (value ^ static_cast<uint32_t>(map_size)) * 1099511628211ULL;
+    int count = map_size * map_size;
+    for (int I = 0; I < count; ++I)
+    {
+      const float * vertex = coords[I].getValue();
+      for (int J = 0; J < 3; ++J)
+      {
+        uint32_t word;
+        memcpy(&word, &vertex[J], sizeof(word));
+        value = (value ^ word) * 1099511628211ULL;
+      }
+    }
+    hash = value;
+    is_hash = TRUE;
+  }
+  return hash;
+}
+
+SbBool SbROAMTriangleTree::load(const char * filename)
+{
+  FILE * file = fopen(filename, "rb");
+  if (file == NULL)
+  {
+    return FALSE;
+  }
+
+  /* The header has to match this tree exactly. */
+  SbROAMTreeCacheHeader header;
+  SbROAMTreeCacheHeader expected;
+  fillHeader(expected);
+  if ((fread(&header, sizeof(header), 1, file) != 1) ||
+    (memcmp(&header, &expected, sizeof(header)) != 0))
+  {
+    fclose(file);
+    return FALSE;
+  }
+  size_t metrics_size = size * sizeof(SbROAMTriangleMetric);
+
+#if !defined(__WIN32__) && !defined(_WIN32)
+  /* Mapping of the whole file, the metric follows the header. */
+  struct stat info;
+  size_t file_size = sizeof(header) + metrics_size;
+  if ((fstat(fileno(file), &info) != 0) ||
+    (static_cast<size_t>(info.st_size) != file_size))
+  {
+    fclose(file);
+    return FALSE;
+  }
+  void * data = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fileno(file), 0);
+  if (data != MAP_FAILED)
+  {
+    fclose(file);
+    releaseMetrics();
+    mapping = data;
+    mapping_size = file_size;
+    metrics = reinterpret_cast<SbROAMTriangleMetric *>(
+      reinterpret_cast<char *>(data) + sizeof(header));
+    return TRUE;
+  }
+#endif
+
+  /* Reading of the metric if the file can not be mapped. */
+  SbROAMTriangleMetric * data_metrics = new SbROAMTriangleMetric[size];
+  if (fread(data_metrics, 1, metrics_size, file) != metrics_size)
+  {
+    delete[] data_metrics;
+    fclose(file);
+    return FALSE;
+  }
+  fclose(file);
+  releaseMetrics();
+  metrics = data_metrics;
+  return TRUE;
+}
+
+SbBool SbROAMTriangleTree::save(const char * filename) const
+{
+  if (metrics == NULL)
+  {
+    return FALSE;
+  }
+
+  /* Writing to a temporary file of this process. */
+  SbString temp_name;
+#if !defined(__WIN32__) && !defined(_WIN32)
+  temp_name.sprintf("%s.%d.tmp", filename, static_cast<int>(getpid()));
+#else
+  temp_name.sprintf("%s.tmp", filename);
+#endif
+  FILE * file = fopen(temp_name.getString(), "wb");
+  if (file == NULL)
+  {
+    return FALSE;
+  }
+  SbROAMTreeCacheHeader header;
+  fillHeader(header);
+  size_t metrics_size = size * sizeof(SbROAMTriangleMetric);
+  SbBool is_written = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+    (fwrite(metrics, 1, metrics_size, file) == metrics_size);
+  is_written = (fclose(file) == 0) && is_written;
+
+  /* Replacing of the cache file by the complete temporary file. */
+  if (is_written && (rename(temp_name.getString(), filename) != 0))
+  {
+    /* Rename does not replace existing files everywhere. */
+    remove(filename);
+    is_written = rename(temp_name.getString(), filename) == 0;
+  }
+  if (!is_written)
+  {
+    remove(temp_name.getString());
+  }
+  return is_written;
+}
+
+/******************************************************************************
+* SbROAMTriangleTree - private
+******************************************************************************/
+
+const uint32_t SbROAMTriangleTree::CACHE_VERSION = 1;
+
+void SbROAMTriangleTree::fillHeader(SbROAMTreeCacheHeader & header) const
+{
+  /* Nulovani vcetne pripadnych vyplnovych bajtu, hlavicky se porovnavaji
+  po bajtech. */
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "SOTROAM", 8);
+  header.version = CACHE_VERSION;
+  header.map_size = map_size;
+  header.hash = getHash();
+  header.level = level;
+  header.stored_level = stored_level;
+  header.count = size;
+  header.metric_size = sizeof(SbROAMTriangleMetric);
+}
+
+void SbROAMTriangleTree::releaseMetrics()
+{
+#if !defined(__WIN32__) && !defined(_WIN32)
+  if (mapping != NULL)
+  {
+    munmap(mapping, mapping_size);
+    mapping = NULL;
+    mapping_size = 0;
+    metrics = NULL;
+  }
+#endif
+  delete[] metrics;
+  metrics = NULL;
+}
+
+void SbROAMTriangleTree::buildSubtree(const SbROAMTriangle & root,
+  const int bottom_level)
+{
+  /* Explicit stack of the post-order traversal. A triangle is computed
+  when its children were computed or it lies at the bottom level. */
+  SbList<SbROAMTriangle> stack(2 * (level + 1));
+  SbList<SbBool> expanded(2 * (level + 1));
+  stack.append(root);
+  expanded.append(FALSE);
+  while (stack.getLength() > 0)
+  {
+    int top = stack.getLength() - 1;
+    if (!expanded[top] && (stack[top].level < bottom_level))
+    {
+      /* Children go to the stack first. */
+      SbROAMTriangle left_child;
+      SbROAMTriangle right_child;
+      getChildren(stack[top], left_child, right_child);
+      expanded[top] = TRUE;
+      stack.append(right_child);
+      expanded.append(FALSE);
+      stack.append(left_child);
+      expanded.append(FALSE);
+    }
+    else
+    {
+      /* Computation of the metric from the metric of the children. */
+      SbROAMTriangle triangle = stack[top];
+      stack.truncate(top);
+      expanded.truncate(top);
+      computeMetric(triangle);
+      storeMetric(triangle);
+    }
+  }
+}
+
+void SbROAMTriangleTree::buildTask(void * _task)
+{
+  SbROAMBuildTask * task = reinterpret_cast<SbROAMBuildTask *>(_task);
+  task->tree->buildSubtree(task->root, task->tree->stored_level);
+}
+
 /******************************************************************************
 * SbROAMSplitQueueTriangle - public
 ******************************************************************************/
 
-SbROAMSplitQueueTriangle::SbROAMSplitQueueTriangle(SbROAMTriangle * _triangle,
+SbROAMSplitQueueTriangle::SbROAMSplitQueueTriangle(
+  const SbROAMTriangle & _triangle,
   float _priority, SbROAMSplitQueueTriangle * _left,
   SbROAMSplitQueueTriangle * _right, SbROAMSplitQueueTriangle * _base,
   SbROAMMergeQueueDiamond * _diamond):
-  triangle(_triangle), left(_left), right(_right), base(_base),
-  diamond(_diamond),  priority(-_priority), index(-1)
+  SbROAMQueueItem(_priority), triangle(_triangle), left(_left),
+  right(_right), base(_base), diamond(_diamond), patch(NULL),
+  recompute_slot(-1), recompute_index(-1), previous_leaf(NULL),
+  next_leaf(NULL)
 {
   // nic
 }
@@ -68,8 +461,8 @@ SbROAMMergeQueueDiamond::SbROAMMergeQueueDiamond(
   SbROAMSplitQueueTriangle * _third,
   SbROAMSplitQueueTriangle * _fourth,
   float _priority):
-  first(_first), second(_second), third(_third), fourth(_fourth),
-  priority(_priority), index(-1)
+  SbROAMQueueItem(_priority), first(_first), second(_second),
+  third(_third), fourth(_fourth)
 {
   // nic
 }
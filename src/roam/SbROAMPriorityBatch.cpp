@@ -0,0 +1,320 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Batched priority evaluation of the ROAM algorithm.
+/// \file SbROAMPriorityBatch.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// Priorities of many triangles are recomputed at once in every frame. The
+/// ::SbROAMPriorityBatch class gathers apices, radii and errors of the
+/// triangles to separate arrays and evaluates their priorities with a SSE or
+/// AVX2 kernel selected by the capabilities of the processor. The error of
+/// the triangles is either isotropic or scaled by the projection of the
+/// wedgie thickness to the view ray.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// standardni includy
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+/* Vector kernels are available only on x86 processors. The kernel functions
+are compiled for their instruction set, the rest of the file is not. */
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || \
+  defined(_M_X64)
+  #define SB_ROAM_X86
+  #include <immintrin.h>
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+    #define SB_ROAM_TARGET_SSE
+    #define SB_ROAM_TARGET_AVX2
+  #else
+    #define SB_ROAM_TARGET_SSE __attribute__((target("sse2")))
+    #define SB_ROAM_TARGET_AVX2 __attribute__((target("avx2")))
+  #endif
+#endif
+
+// lokalni includy
+#include <roam/SbROAMPriorityBatch.h>
+#include <roam/SbROAMPrimitives.h>
+
+/******************************************************************************
+* SbROAMPriorityBatch - public
+******************************************************************************/
+
+SbROAMPriorityBatch::SbROAMPriorityBatch():
+  memory(NULL), x(NULL), y(NULL), z(NULL), radii(NULL), errors(NULL),
+  priorities(NULL), count(0), capacity(0), kernel(getBestKernel()),
+  metric(ISOTROPIC)
+{
+  // nic
+}
+
+SbROAMPriorityBatch::~SbROAMPriorityBatch()
+{
+  delete[] memory;
+}
+
+void SbROAMPriorityBatch::resize(const int _count)
+{
+  count = _count;
+  if (count <= capacity)
+  {
+    return;
+  }
+
+  /* Capacity is a multiple of eight, so that all arrays stay aligned to 32
+  bytes when the first one is. */
+  delete[] memory;
+  capacity = SbMax((count + 7) & ~7, capacity * 2);
+  memory = new float[capacity * 6 + 8];
+  size_t offset = (32 - (reinterpret_cast<size_t>(memory) & 31)) & 31;
+  x = memory + offset / sizeof(float);
+  y = x + capacity;
+  z = y + capacity;
+  radii = z + capacity;
+  errors = radii + capacity;
+  priorities = errors + capacity;
+}
+
+void SbROAMPriorityBatch::compute(const SbVec3f & camera, const float lambda)
+{
+  /* Vector kernels evaluate whole groups, the rest is evaluated by the
+  scalar code. */
+  int begin = 0;
+  switch (kernel)
+  {
+    case AVX2:
+    {
+      begin = computeAVX2(camera, lambda);
+    }
+    break;
+    case SSE:
+    {
+      begin = computeSSE(camera, lambda);
+    }
+    break;
+    default:
+    {
+      // nic
+    }
+    break;
+  }
+  computeScalar(camera, lambda, begin, count);
+}
+
+void SbROAMPriorityBatch::setKernel(const Kernel _kernel)
+{
+  kernel = (_kernel <= getBestKernel()) ? _kernel : getBestKernel();
+}
+
+SbROAMPriorityBatch::Kernel SbROAMPriorityBatch::getKernel() const
+{
+  return kernel;
+}
+
+void SbROAMPriorityBatch::setMetric(const Metric _metric)
+{
+  metric = _metric;
+}
+
+SbROAMPriorityBatch::Metric SbROAMPriorityBatch::getMetric() const
+{
+  return metric;
+}
+
+SbROAMPriorityBatch::Kernel SbROAMPriorityBatch::getBestKernel()
+{
+#if defined(SB_ROAM_X86) && defined(_MSC_VER)
+  /* SSE2 in EDX of leaf 1, AVX2 needs OS support of the YMM registers and
+  the flag in EBX of leaf 7. */
+  int info[4];
+  __cpuid(info, 0);
+  int max_leaf = info[0];
+  __cpuid(info, 1);
+  SbBool is_sse = (info[3] & (1 << 26)) != 0;
+  SbBool is_avx = ((info[2] & (1 << 27)) != 0) && ((info[2] & (1 << 28)) !=
+    0) && ((_xgetbv(0) & 0x06) == 0x06);
+  SbBool is_avx2 = FALSE;
+  if (is_avx && (max_leaf >= 7))
+  {
+    __cpuidex(info, 7, 0);
+    is_avx2 = (info[1] & (1 << 5)) != 0;
+  }
+  return is_avx2 ? AVX2 : (is_sse ? SSE : SCALAR);
+#elif defined(SB_ROAM_X86)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return AVX2;
+  }
+  return __builtin_cpu_supports("sse2") ? SSE : SCALAR;
+#else
+  return SCALAR;
+#endif
+}
+
+/******************************************************************************
+* SbROAMPriorityBatch - private
+******************************************************************************/
+
+void SbROAMPriorityBatch::computeScalar(const SbVec3f & camera,
+  const float lambda, const int begin, const int end)
+{
+  for (int I = begin; I < end; ++I)
+  {
+    /* Distance of the camera from the apex. */
+    float dx = camera[0] - x[I];
+    float dy = camera[1] - y[I];
+    float dz = camera[2] - z[I];
+    float distance = static_cast<float>(sqrt(dx * dx + dy * dy + dz * dz));
+    float error = errors[I];
+    if (metric == WEDGIE)
+    {
+      error *= getWedgieFactor(dz, distance, radii[I]);
+    }
+
+    /* Camera inside of the sphere gets the highest priority. */
+    priorities[I] = (distance < radii[I]) ? PRIORITY_MAX : lambda *
+      error / SbMax(distance - radii[I], FLT_MIN);
+  }
+}
+
+#if defined(SB_ROAM_X86)
+
+SB_ROAM_TARGET_SSE int SbROAMPriorityBatch::computeSSE(const SbVec3f &
+  camera, const float lambda)
+{
+  __m128 camera_x = _mm_set1_ps(camera[0]);
+  __m128 camera_y = _mm_set1_ps(camera[1]);
+  __m128 camera_z = _mm_set1_ps(camera[2]);
+  __m128 lambdas = _mm_set1_ps(lambda);
+  __m128 minimum = _mm_set1_ps(FLT_MIN);
+  __m128 maximum = _mm_set1_ps(PRIORITY_MAX);
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  int I = 0;
+  for (; (I + 4) <= count; I += 4)
+  {
+    /* Same operations in the same order as the scalar code. */
+    __m128 dx = _mm_sub_ps(camera_x, _mm_load_ps(x + I));
+    __m128 dy = _mm_sub_ps(camera_y, _mm_load_ps(y + I));
+    __m128 dz = _mm_sub_ps(camera_z, _mm_load_ps(z + I));
+    __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx),
+      _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+    __m128 radius = _mm_load_ps(radii + I);
+    __m128 error = _mm_load_ps(errors + I);
+    if (metric == WEDGIE)
+    {
+      /* Wedgie factor with the exact division and square roots of
+      ::SbROAMPriorityBatch::getWedgieFactor. */
+      __m128 inverse = _mm_div_ps(one, _mm_max_ps(distance, minimum));
+      __m128 cos_view = _mm_min_ps(_mm_mul_ps(_mm_and_ps(dz, sign_mask),
+        inverse), one);
+      __m128 sin_view = _mm_sqrt_ps(_mm_sub_ps(one, _mm_mul_ps(cos_view,
+        cos_view)));
+      __m128 sin_sphere = _mm_min_ps(_mm_mul_ps(radius, inverse), one);
+      __m128 cos_sphere = _mm_sqrt_ps(_mm_sub_ps(one, _mm_mul_ps(sin_sphere,
+        sin_sphere)));
+      __m128 factor = _mm_add_ps(_mm_mul_ps(sin_view, cos_sphere),
+        _mm_mul_ps(cos_view, sin_sphere));
+      __m128 right = _mm_cmple_ps(_mm_mul_ps(cos_view, cos_sphere),
+        _mm_mul_ps(sin_view, sin_sphere));
+      error = _mm_mul_ps(error, _mm_or_ps(_mm_and_ps(right, one),
+        _mm_andnot_ps(right, factor)));
+    }
+    __m128 priority = _mm_div_ps(_mm_mul_ps(lambdas, error),
+      _mm_max_ps(_mm_sub_ps(distance, radius), minimum));
+
+    /* Selection of the highest priority inside of the sphere. */
+    __m128 inside = _mm_cmplt_ps(distance, radius);
+    _mm_store_ps(priorities + I, _mm_or_ps(_mm_and_ps(inside, maximum),
+      _mm_andnot_ps(inside, priority)));
+  }
+  return I;
+}
+
+SB_ROAM_TARGET_AVX2 int SbROAMPriorityBatch::computeAVX2(const SbVec3f &
+  camera, const float lambda)
+{
+  __m256 camera_x = _mm256_set1_ps(camera[0]);
+  __m256 camera_y = _mm256_set1_ps(camera[1]);
+  __m256 camera_z = _mm256_set1_ps(camera[2]);
+  __m256 lambdas = _mm256_set1_ps(lambda);
+  __m256 minimum = _mm256_set1_ps(FLT_MIN);
+  __m256 maximum = _mm256_set1_ps(PRIORITY_MAX);
+  __m256 one = _mm256_set1_ps(1.0f);
+  __m256 sign_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  int I = 0;
+  for (; (I + 8) <= count; I += 8)
+  {
+    /* Same operations in the same order as the scalar code, no fused
+    multiply-add. */
+    __m256 dx = _mm256_sub_ps(camera_x, _mm256_load_ps(x + I));
+    __m256 dy = _mm256_sub_ps(camera_y, _mm256_load_ps(y + I));
+    __m256 dz = _mm256_sub_ps(camera_z, _mm256_load_ps(z + I));
+    __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(
+      _mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+    __m256 radius = _mm256_load_ps(radii + I);
+    __m256 error = _mm256_load_ps(errors + I);
+    if (metric == WEDGIE)
+    {
+      /* Wedgie factor with the exact division and square roots of
+      ::SbROAMPriorityBatch::getWedgieFactor. */
+      __m256 inverse = _mm256_div_ps(one, _mm256_max_ps(distance, minimum));
+      __m256 cos_view = _mm256_min_ps(_mm256_mul_ps(_mm256_and_ps(dz,
+        sign_mask), inverse), one);
+      __m256 sin_view = _mm256_sqrt_ps(_mm256_sub_ps(one,
+        _mm256_mul_ps(cos_view, cos_view)));
+      __m256 sin_sphere = _mm256_min_ps(_mm256_mul_ps(radius, inverse), one);
+      __m256 cos_sphere = _mm256_sqrt_ps(_mm256_sub_ps(one,
+        _mm256_mul_ps(sin_sphere, sin_sphere)));
+      __m256 factor = _mm256_add_ps(_mm256_mul_ps(sin_view, cos_sphere),
+        _mm256_mul_ps(cos_view, sin_sphere));
+      __m256 right = _mm256_cmp_ps(_mm256_mul_ps(cos_view, cos_sphere),
+        _mm256_mul_ps(sin_view, sin_sphere), _CMP_LE_OQ);
+      error = _mm256_mul_ps(error, _mm256_blendv_ps(factor, one, right));
+    }
+    __m256 priority = _mm256_div_ps(_mm256_mul_ps(lambdas, error),
+      _mm256_max_ps(_mm256_sub_ps(distance, radius), minimum));
+
+    /* Selection of the highest priority inside of the sphere. */
+    __m256 inside = _mm256_cmp_ps(distance, radius, _CMP_LT_OQ);
+    _mm256_store_ps(priorities + I, _mm256_blendv_ps(priority, maximum,
+      inside));
+  }
+  return I;
+}
+
+#else
+
+int SbROAMPriorityBatch::computeSSE(const SbVec3f & camera,
+  const float lambda)
+{
+  return 0;
+}
+
+int SbROAMPriorityBatch::computeAVX2(const SbVec3f & camera,
+  const float lambda)
+{
+  return 0;
+}
+
+#endif
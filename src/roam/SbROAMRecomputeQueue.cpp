@@ -0,0 +1,126 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Queue of deferred priority recomputation of the ROAM algorithm.
+/// \file SbROAMRecomputeQueue.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// When the speed of the camera is limited, the priority of a triangle can
+/// not cross the split/merge threshold sooner than after a number of frames
+/// given by its distance from the threshold. The queue keeps every triangle
+/// of the triangulation in the slot of the frame in which its priority has
+/// to be recomputed, so that only a small part of the triangulation is
+/// recomputed in every frame.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// lokalni includy
+#include <roam/SbROAMRecomputeQueue.h>
+#include <roam/SbROAMPrimitives.h>
+
+/******************************************************************************
+* SbROAMRecomputeQueue - public
+******************************************************************************/
+
+const int SbROAMRecomputeQueue::SLOT_COUNT;
+
+SbROAMRecomputeQueue::SbROAMRecomputeQueue():
+  current(0)
+{
+  // nic
+}
+
+SbROAMRecomputeQueue::~SbROAMRecomputeQueue()
+{
+  // nic
+}
+
+void SbROAMRecomputeQueue::emptyQueue()
+{
+  /* Forget the slots of all scheduled triangles. */
+  for (int I = 0; I < SLOT_COUNT; ++I)
+  {
+    for (int J = 0; J < slots[I].getLength(); ++J)
+    {
+      slots[I][J]->recompute_slot = -1;
+      slots[I][J]->recompute_index = -1;
+    }
+    slots[I].truncate(0);
+  }
+}
+
+void SbROAMRecomputeQueue::add(SbROAMSplitQueueTriangle * triangle,
+  const int delay)
+{
+  /* Append the triangle to the slot of the requested frame. */
+  int slot = (current + SbClamp(delay, 1, SLOT_COUNT - 1)) % SLOT_COUNT;
+  triangle->recompute_slot = slot;
+  triangle->recompute_index = slots[slot].getLength();
+  slots[slot].append(triangle);
+}
+
+void SbROAMRecomputeQueue::remove(SbROAMSplitQueueTriangle * triangle)
+{
+  if (triangle->recompute_slot >= 0)
+  {
+    /* The last triangle of the slot takes the place of the removed one. */
+    SbList<SbROAMSplitQueueTriangle *> & slot =
+      slots[triangle->recompute_slot];
+    int index = triangle->recompute_index;
+    slot.removeFast(index);
+    if (index < slot.getLength())
+    {
+      slot[index]->recompute_index = index;
+    }
+    triangle->recompute_slot = -1;
+    triangle->recompute_index = -1;
+  }
+}
+
+void SbROAMRecomputeQueue::nextFrame()
+{
+  current = (current + 1) % SLOT_COUNT;
+}
+
+SbROAMSplitQueueTriangle * SbROAMRecomputeQueue::extract()
+{
+  /* Take the last triangle of the current slot. */
+  SbList<SbROAMSplitQueueTriangle *> & slot = slots[current];
+  int length = slot.getLength();
+  if (length == 0)
+  {
+    return NULL;
+  }
+  SbROAMSplitQueueTriangle * triangle = slot[length - 1];
+  slot.truncate(length - 1);
+  triangle->recompute_slot = -1;
+  triangle->recompute_index = -1;
+  return triangle;
+}
+
+int SbROAMRecomputeQueue::size() const
+{
+  /* Sum of the sizes of all slots. */
+  int size = 0;
+  for (int I = 0; I < SLOT_COUNT; ++I)
+  {
+    size += slots[I].getLength();
+  }
+  return size;
+}
@@ -28,78 +28,121 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include <roam/SbROAMSplitQueue.h>
+#include <roam/SbROAMBucketQueue.h>
 #include <roam/SbROAMPrimitives.h>
 
 /******************************************************************************
 * SbROAMSplitQueue - public
 ******************************************************************************/
 
-SbROAMSplitQueue::SbROAMSplitQueue(const int init_size):
+SbROAMSplitQueue * SbROAMSplitQueue::create(const Type type)
+{
+  /* Create the queue of the requested type. */
+  switch (type)
+  {
+    case BUCKETS:
+      return new SbROAMBucketSplitQueue();
+    case HEAP:
+    default:
+      return new SbROAMHeapSplitQueue();
+  }
+}
+
+SbROAMSplitQueue::~SbROAMSplitQueue()
+{
+  // nic
+}
+
+/******************************************************************************
+* SbROAMHeapSplitQueue - public
+******************************************************************************/
+
+SbROAMHeapSplitQueue::SbROAMHeapSplitQueue(const int init_size):
   SbHeap(heap_funcs, init_size)
 {
   // nic
 }
 
-SbROAMSplitQueue::~SbROAMSplitQueue()
+SbROAMHeapSplitQueue::~SbROAMHeapSplitQueue()
 {
   // nic
 }
 
-void SbROAMSplitQueue::emptyQueue()
+SbROAMSplitQueue::Type SbROAMHeapSplitQueue::getType() const
+{
+  return HEAP;
+}
+
+void SbROAMHeapSplitQueue::emptyQueue()
 {
   SbHeap::emptyHeap(); // vyprazdneni fronty
 }
 
-void SbROAMSplitQueue::add(SbROAMSplitQueueTriangle * triangle)
+void SbROAMHeapSplitQueue::add(SbROAMSplitQueueTriangle * triangle)
 {
   /* Vlozeni trojuhelniku a aktualizace indexu ve fronte. */
   int index = SbHeap::add(triangle);
   triangle->index = index;
 }
 
-void SbROAMSplitQueue::remove(SbROAMSplitQueueTriangle * triangle)
+void SbROAMHeapSplitQueue::remove(SbROAMSplitQueueTriangle * triangle)
 {
   SbHeap::remove(triangle->index); // odstraneni trojuhelniku z fronty
 }
 
-SbROAMSplitQueueTriangle * SbROAMSplitQueue::extractMax()
+SbROAMSplitQueueTriangle * SbROAMHeapSplitQueue::extractMax()
 {
   /* Vyber trojuhelniku s maximalni prioritou. */
   return reinterpret_cast<SbROAMSplitQueueTriangle *>(SbHeap::extractMin());
 }
 
-SbROAMSplitQueueTriangle * SbROAMSplitQueue::getMax()
+SbROAMSplitQueueTriangle * SbROAMHeapSplitQueue::getMax()
 {
   /* vraceni trojuhelniku s maximalni prioritou. */
   return reinterpret_cast<SbROAMSplitQueueTriangle *>(SbHeap::getMin());
 }
 
-SbROAMSplitQueueTriangle * SbROAMSplitQueue::operator[](const int index)
+SbROAMSplitQueueTriangle * SbROAMHeapSplitQueue::operator[](const int index)
 {
   return reinterpret_cast<SbROAMSplitQueueTriangle*>
     (SbHeap::operator[](index));
 }
 
+int SbROAMHeapSplitQueue::size() const
+{
+  return SbHeap::size();
+}
+
+void SbROAMHeapSplitQueue::update(SbROAMSplitQueueTriangle * triangle)
+{
+  SbHeap::newWeight(triangle, triangle->index); // move the triangle in the heap
+}
+
+void SbROAMHeapSplitQueue::rebuild()
+{
+  SbHeap::buildHeap(NULL, NULL); // restore the heap
+}
+
 /******************************************************************************
-* SbROAMSplitQueue - private
+* SbROAMHeapSplitQueue - private
 ******************************************************************************/
 
-SbHeapFuncs SbROAMSplitQueue::heap_funcs = {getTrianglePriority,
+SbHeapFuncs SbROAMHeapSplitQueue::heap_funcs = {getTrianglePriority,
   getTriangleIndex, setTriangleIndex};
 
-inline float SbROAMSplitQueue::getTrianglePriority(void * triangle)
+inline float SbROAMHeapSplitQueue::getTrianglePriority(void * triangle)
 {
-  /* Zjisteni priority trojuhelniku ve fronte. */
-  return reinterpret_cast<SbROAMSplitQueueTriangle *>(triangle)->priority;
+  /* The heap extracts minimum, so the priority is negated. */
+  return -reinterpret_cast<SbROAMSplitQueueTriangle *>(triangle)->priority;
 }
 
-inline int SbROAMSplitQueue::getTriangleIndex(void * triangle)
+inline int SbROAMHeapSplitQueue::getTriangleIndex(void * triangle)
 {
   /* Zjisteni priority trojuhelniku ve fronte. */
   return reinterpret_cast<SbROAMSplitQueueTriangle *>(triangle)->index;
 }
 
-inline void SbROAMSplitQueue::setTriangleIndex(void * triangle, int index)
+inline void SbROAMHeapSplitQueue::setTriangleIndex(void * triangle, int index)
 {
   /* Nataveni priority trojuhelniku ve fronte. */
   reinterpret_cast<SbROAMSplitQueueTriangle *>(triangle)->index = index;
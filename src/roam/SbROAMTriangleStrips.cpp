@@ -0,0 +1,356 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Triangle strips of the ROAM triangulation.
+/// \file SbROAMTriangleStrips.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// Triangles of the binary triangle tree ordered by the Sierpinski curve form
+/// a sequence in which neighbouring triangles share an edge. The
+/// ::SbROAMTriangleStrips class keeps the triangles of the triangulation in
+/// this order and divides them to strips by subtrees of a fixed level of the
+/// tree. Splits and merges only mark their strips as changed, so only the
+/// changed strips are rebuilt for the next frame.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// standardni includy
+#include <cstring>
+
+// lokalni includy
+#include <roam/SbROAMTriangleStrips.h>
+#include <roam/SbROAMPrimitives.h>
+
+/******************************************************************************
+* SbROAMTriangleStrips - public
+******************************************************************************/
+
+const int SbROAMTriangleStrips::STRIP_LEVEL = 6;
+
+SbROAMTriangleStrips::SbROAMTriangleStrips():
+  strip_level(0), strip_count(0), first_triangles(NULL), strips(NULL),
+  invalid_flags(NULL), invalid_strips()
+{
+  // nic
+}
+
+SbROAMTriangleStrips::~SbROAMTriangleStrips()
+{
+  delete[] first_triangles;
+  delete[] strips;
+  delete[] invalid_flags;
+}
+
+void SbROAMTriangleStrips::create(const int level,
+  SbROAMSplitQueueTriangle * first_root,
+  SbROAMSplitQueueTriangle * second_root)
+{
+  /* One strip for every triangle down to the strip level. */
+  strip_level = SbMin(level, STRIP_LEVEL);
+  strip_count = (1 << (strip_level + 1)) - 1;
+  delete[] first_triangles;
+  delete[] strips;
+  delete[] invalid_flags;
+  first_triangles = new SbROAMSplitQueueTriangle *[strip_count];
+  strips = new SbList<GLuint>[strip_count];
+  invalid_flags = new unsigned char[strip_count];
+  memset(first_triangles, 0, strip_count * sizeof(SbROAMSplitQueueTriangle *));
+  memset(invalid_flags, 0, strip_count);
+  invalid_strips.truncate(0);
+
+  /* The curve passes the first root from its first vertex to the second one
+  and returns through the second root. */
+  SbROAMSplitQueueTriangle * roots[2] = {first_root, second_root};
+  first_root->previous_leaf = NULL;
+  first_root->next_leaf = second_root;
+  second_root->previous_leaf = first_root;
+  second_root->next_leaf = NULL;
+  for (int I = 0; I < 2; ++I)
+  {
+    first_triangles[getStrip(roots[I])] = roots[I];
+    invalidate(getStrip(roots[I]));
+  }
+}
+
+void SbROAMTriangleStrips::split(SbROAMSplitQueueTriangle * parent,
+  SbROAMSplitQueueTriangle * left_child,
+  SbROAMSplitQueueTriangle * right_child)
+{
+  /* The curve enters triangles of odd levels at their first vertex, which
+  belongs to the left child, and triangles of even levels at their second
+  vertex. */
+  SbROAMSplitQueueTriangle * children[2];
+  if (parent->triangle.level & 1)
+  {
+    children[0] = left_child;
+    children[1] = right_child;
+  }
+  else
+  {
+    children[0] = right_child;
+    children[1] = left_child;
+  }
+  replace(&parent, 1, children, 2);
+}
+
+void SbROAMTriangleStrips::merge(SbROAMSplitQueueTriangle * first_child,
+  SbROAMSplitQueueTriangle * second_child,
+  SbROAMSplitQueueTriangle * parent)
+{
+  /* Siblings are neighbours in the order of the strips. */
+  SbROAMSplitQueueTriangle * children[2];
+  if (first_child->next_leaf == second_child)
+  {
+    children[0] = first_child;
+    children[1] = second_child;
+  }
+  else
+  {
+    children[0] = second_child;
+    children[1] = first_child;
+  }
+  replace(children, 2, &parent, 1);
+}
+
+void SbROAMTriangleStrips::update(SbList<GLuint> & indices)
+{
+  /* Rebuild of the changed strips only. */
+  for (int I = 0; I < invalid_strips.getLength(); ++I)
+  {
+    rebuild(invalid_strips[I]);
+    invalid_flags[invalid_strips[I]] = 0;
+  }
+  invalid_strips.truncate(0);
+
+  /* Cached strips are joined in the order of the curve. */
+  indices.truncate(0);
+  for (int I = 0; I < strip_count; ++I)
+  {
+    appendStrip(indices, strips[I]);
+  }
+}
+
+void SbROAMTriangleStrips::appendStrip(SbList<GLuint> & indices,
+  const SbList<GLuint> & strip)
+{
+  int length = strip.getLength();
+  if (length == 0)
+  {
+    return;
+  }
+
+  /* Strips are joined by repeating the last vertex of one strip and the
+  first vertex of the next one. The first vertex is repeated once more if
+  needed to start the next strip at an even position, which keeps the
+  orientation of its triangles. */
+  int offset = indices.getLength();
+  if (offset > 0)
+  {
+    indices.append(indices[offset - 1]);
+    indices.append(strip[0]);
+    if (offset & 1)
+    {
+      indices.append(strip[0]);
+    }
+  }
+  for (int I = 0; I < length; ++I)
+  {
+    indices.append(strip[I]);
+  }
+}
+
+void SbROAMTriangleStrips::appendTriangle(SbList<GLuint> & indices,
+  const SbROAMTriangle & triangle, const SbROAMTriangle * next)
+{
+  GLuint vertices[3] = {static_cast<GLuint>(triangle.first),
+    static_cast<GLuint>(triangle.apex), static_cast<GLuint>(triangle.second)};
+  int length = indices.getLength();
+  if (length >= 2)
+  {
+    /* Continuation over the last edge of the strip. The orientation of a
+    triangle at an odd position is reversed, so the last edge has to be in
+    the opposite direction in the triangle. If the next triangle shares the
+    other edge ending in the new vertex, the first vertex of the last edge
+    is repeated, which swaps the edge without changing the orientation. */
+    GLuint first = indices[length - 2];
+    GLuint second = indices[length - 1];
+    for (int I = 0; I < 3; ++I)
+    {
+      SbBool is_forward = (vertices[I] == first) &&
+        (vertices[(I + 1) % 3] == second);
+      SbBool is_backward = (vertices[I] == second) &&
+        (vertices[(I + 1) % 3] == first);
+      if ((is_forward || is_backward) &&
+        (is_forward == (((length - 2) & 1) == 0)))
+      {
+        if ((next != NULL) && !isVertex(*next, second) &&
+          isVertex(*next, first))
+        {
+          indices.append(first);
+        }
+        indices.append(vertices[(I + 2) % 3]);
+        return;
+      }
+    }
+
+    /* Continuation over the last vertex of the strip. The repeated vertex
+    forms two degenerate triangles with the second vertex of the new last
+    edge, which is chosen to keep the orientation. */
+    for (int I = 0; I < 3; ++I)
+    {
+      if (vertices[I] == second)
+      {
+        indices.append(second);
+        indices.append(vertices[(I + (((length & 1) == 0) ? 1 : 2)) % 3]);
+        appendTriangle(indices, triangle, next);
+        return;
+      }
+    }
+  }
+
+  /* New part of the strip starts at an even position, after joining by
+  degenerate triangles at the position two vertices behind the end. The
+  rotation of the vertices is chosen so that the last edge is shared with
+  the next triangle. */
+  int start = (length == 0) ? 0 : (length + 2);
+  int rotation = 0;
+  for (int I = 0; (next != NULL) && (I < 3); ++I)
+  {
+    GLuint first = (start & 1) ? vertices[I] : vertices[(I + 1) % 3];
+    GLuint second = vertices[(I + 2) % 3];
+    if (isVertex(*next, first) && isVertex(*next, second))
+    {
+      rotation = I;
+      break;
+    }
+  }
+  GLuint rotated[3] = {vertices[rotation], vertices[(rotation + 1) % 3],
+    vertices[(rotation + 2) % 3]};
+  if (start & 1)
+  {
+    GLuint swap = rotated[0];
+    rotated[0] = rotated[1];
+    rotated[1] = swap;
+  }
+  if (length > 0)
+  {
+    indices.append(indices[length - 1]);
+    indices.append(rotated[0]);
+  }
+  indices.append(rotated[0]);
+  indices.append(rotated[1]);
+  indices.append(rotated[2]);
+}
+
+/******************************************************************************
+* SbROAMTriangleStrips - private
+******************************************************************************/
+
+inline int SbROAMTriangleStrips::getStrip(
+  const SbROAMSplitQueueTriangle * triangle) const
+{
+  /* Triangles below the strip level belong to the strip of their ancestor
+  at the strip level. */
+  int level = triangle->triangle.level;
+  int index = triangle->triangle.index;
+  return (level <= strip_level) ? index :
+    ((index + 1) >> (level - strip_level)) - 1;
+}
+
+void SbROAMTriangleStrips::replace(
+  SbROAMSplitQueueTriangle * const * old_triangles, const int old_count,
+  SbROAMSplitQueueTriangle * const * new_triangles, const int new_count)
+{
+  /* Linking of the new triangles in place of the old ones. */
+  SbROAMSplitQueueTriangle * previous = old_triangles[0]->previous_leaf;
+  SbROAMSplitQueueTriangle * next = old_triangles[old_count - 1]->next_leaf;
+  for (int I = 0; I < new_count; ++I)
+  {
+    new_triangles[I]->previous_leaf = (I == 0) ? previous :
+      new_triangles[I - 1];
+    new_triangles[I]->next_leaf = (I == (new_count - 1)) ? next :
+      new_triangles[I + 1];
+  }
+  if (previous != NULL)
+  {
+    previous->next_leaf = new_triangles[0];
+  }
+  if (next != NULL)
+  {
+    next->previous_leaf = new_triangles[new_count - 1];
+  }
+
+  /* The new triangles take the place of the old ones, so a strip which
+  started by an old triangle starts by its first new one. Strips without
+  new triangles become empty. */
+  for (int I = 0; I < old_count; ++I)
+  {
+    int strip = getStrip(old_triangles[I]);
+    if (first_triangles[strip] == old_triangles[I])
+    {
+      first_triangles[strip] = NULL;
+    }
+    invalidate(strip);
+  }
+  for (int I = 0; I < new_count; ++I)
+  {
+    int strip = getStrip(new_triangles[I]);
+    if (first_triangles[strip] == NULL)
+    {
+      first_triangles[strip] = new_triangles[I];
+    }
+    invalidate(strip);
+  }
+}
+
+inline void SbROAMTriangleStrips::invalidate(const int strip)
+{
+  if (!invalid_flags[strip])
+  {
+    invalid_flags[strip] = 1;
+    invalid_strips.append(strip);
+  }
+}
+
+void SbROAMTriangleStrips::rebuild(const int strip)
+{
+  /* Triangles of the strip follow its first triangle. */
+  SbList<GLuint> & indices = strips[strip];
+  indices.truncate(0);
+  SbROAMSplitQueueTriangle * triangle = first_triangles[strip];
+  while (triangle != NULL)
+  {
+    SbROAMSplitQueueTriangle * next = triangle->next_leaf;
+    if ((next != NULL) && (getStrip(next) != strip))
+    {
+      next = NULL;
+    }
+    appendTriangle(indices, triangle->triangle, (next != NULL) ?
+      &next->triangle : NULL);
+    triangle = next;
+  }
+}
+
+inline SbBool SbROAMTriangleStrips::isVertex(const SbROAMTriangle &
+  triangle, const GLuint vertex)
+{
+  return (static_cast<GLuint>(triangle.first) == vertex) ||
+    (static_cast<GLuint>(triangle.apex) == vertex) ||
+    (static_cast<GLuint>(triangle.second) == vertex);
+}
@@ -0,0 +1,480 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Terrain rendered by the diamond based ROAM algorithm.
+/// \file SoDiamondROAMTerrain.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// The scene graph node represents the terrain rendered by the ROAM algorithm
+/// built on diamonds instead of triangles. The diamonds are records in one
+/// array indexed by their center vertex, their neighbours are found by index
+/// arithmetic instead of pointers. The node is used the same way as
+/// ::SoSimpleROAMTerrain, so both can be compared on the same scene.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// standard includes
+#include <cfloat>
+
+// local includes
+#include <roam/SoDiamondROAMTerrain.h>
+
+SO_NODE_SOURCE(SoDiamondROAMTerrain)
+
+/******************************************************************************
+* SoDiamondROAMTerrain - public
+******************************************************************************/
+
+void SoDiamondROAMTerrain::initClass()
+{
+  /* Inicializace tridy. */
+  SoROAMTerrain::initClass();
+  SO_NODE_INIT_CLASS(SoDiamondROAMTerrain, SoROAMTerrain, "SoROAMTerrain");
+  SO_ENABLE(SoGLRenderAction, SoMaterialBindingElement);
+  SO_ENABLE(SoGLRenderAction, SoCoordinateElement);
+  SO_ENABLE(SoGLRenderAction, SoTextureCoordinateElement);
+  SO_ENABLE(SoGLRenderAction, SoTextureEnabledElement);
+  SO_ENABLE(SoGLRenderAction, SoLightModelElement);
+  SO_ENABLE(SoGLRenderAction, SoNormalElement);
+  SO_ENABLE(SoGLRenderAction, SoNormalBindingElement);
+  SO_ENABLE(SoGLRenderAction, SoViewVolumeElement);
+  SO_ENABLE(SoGLRenderAction, SoViewportRegionElement);
+  SO_ENABLE(SoGetBoundingBoxAction, SoCoordinateElement);
+}
+
+SoDiamondROAMTerrain::SoDiamondROAMTerrain():
+  coords(NULL), texture_coords(NULL), normals(NULL), view_volume(NULL),
+  viewport_region(NULL), diamond_tree(NULL), lambda(0.0f),
+  camera_position(0.0f, 0.0f, 0.0f), split_queue(), merge_queue(),
+  triangles(0), priority_batch(), vertex_buffer(), indices(),
+  is_indices_dirty(TRUE), is_texture(FALSE), is_normals(FALSE)
+{
+  /* Inicializace tridy. */
+  SO_NODE_CONSTRUCTOR(SoDiamondROAMTerrain);
+}
+
+/******************************************************************************
+* SoDiamondROAMTerrain - protected
+******************************************************************************/
+
+void SoDiamondROAMTerrain::GLRender(SoGLRenderAction * action)
+{
+  if (!shouldGLRender(action))
+  {
+    return;
+  }
+
+  /* Ziskani informaci z grafu sceny. */
+  SoState * state = action->getState();
+  view_volume = &SoViewVolumeElement::get(state);
+  viewport_region = &SoViewportRegionElement::get(state);
+
+  /* Camera of the current frame. */
+  camera_position = view_volume->getProjectionPoint();
+  view_volume->getViewVolumePlanes(planes);
+  lambda = (view_volume->getNearDist() *
+    viewport_region->getViewportSizePixels()[1]) / (view_volume->getHeight());
+
+  /* Metric of the diamonds is computed in the first run. */
+  if (diamond_tree == NULL)
+  {
+    PR_START_PROFILE(preprocess);
+
+    /* Only three dimensional coordinates and two dimensional texture
+    coordinates are supported. */
+    assert(SoCoordinateElement::getInstance(state)->is3D() &&
+      (SoTextureCoordinateElement::getInstance(state)->getDimension() == 2));
+
+    /* Ziskani vrcholu a texturovych souradnic. */
+    coords = SoCoordinateElement::getInstance(state)->getArrayPtr3();
+    texture_coords = SoTextureCoordinateElement::getInstance(state)->
+      getArrayPtr2();
+    normals = SoNormalElement::getInstance(state)->getArrayPtr();
+
+    /* Vertices of the height map are drawn from a vertex buffer, arrays
+    shorter than the map are not used. */
+    int vertex_count = map_size * map_size;
+    vertex_buffer.setArrays(coords,
+      (SoNormalElement::getInstance(state)->getNum() >= vertex_count) ?
+      normals : NULL,
+      (SoTextureCoordinateElement::getInstance(state)->getNum() >=
+      vertex_count) ? texture_coords : NULL, vertex_count);
+
+    diamond_tree = new SbROAMDiamondTree(coords, map_size);
+    diamond_tree->build();
+
+    /* The root diamond covers the whole map with two triangles. */
+    addSplitQueue(diamond_tree->getRoot());
+    triangles = 2;
+
+    PR_STOP_PROFILE(preprocess);
+  }
+
+  if (!is_freeze)
+  {
+    PR_START_PROFILE(priorities);
+    recomputePriorities();
+    PR_STOP_PROFILE(priorities);
+    PR_START_PROFILE(refinement);
+    refine();
+    PR_STOP_PROFILE(refinement);
+  }
+  updateIndices();
+
+  /* Inicializace vykreslovani. */
+  beginSolidShape(action);
+  SoNormalBindingElement::Binding norm_bind =
+    SoNormalBindingElement::get(state);
+  SoMaterialBundle mat_bundle = SoMaterialBundle(action);
+
+  this->is_texture = (SoTextureEnabledElement::get(state) &&
+    SoTextureCoordinateElement::getType(state) !=
+    SoTextureCoordinateElement::NONE);
+  this->is_normals = (this->normals && SoLightModelElement::get(state) !=
+    SoLightModelElement::BASE_COLOR);
+
+  mat_bundle.sendFirst();
+
+  if (!is_normals)
+  {
+    norm_bind = SoNormalBindingElement::OVERALL;
+  }
+
+  if (norm_bind == SoNormalBindingElement::OVERALL)
+  {
+    glNormal3f(0.0f, 0.0f, 1.0f);
+  }
+
+  /* Vykresleni trojuhelniku. */
+  vertex_buffer.bind(action->getCacheContext(), is_normals, is_texture);
+  glDrawElements(GL_TRIANGLES, indices.getLength(), GL_UNSIGNED_INT,
+    indices.getArrayPtr());
+  vertex_buffer.unbind();
+
+  endSolidShape(action);
+}
+
+inline float SoDiamondROAMTerrain::computePriority(const int index) const
+{
+  /* Same priority as the batch computes for the diamond. */
+  const SbROAMDiamond & diamond = (*diamond_tree)[index];
+  float distance = (camera_position - coords[index]).length();
+  if (distance < diamond.radius)
+  {
+    return PRIORITY_MAX;
+  }
+  if (isCulled(index))
+  {
+    return PRIORITY_MIN;
+  }
+  return lambda * diamond.error / SbMax(distance - diamond.radius, FLT_MIN);
+}
+
+inline SbBool SoDiamondROAMTerrain::isCulled(const int index) const
+{
+  if (!is_frustum_culling)
+  {
+    return FALSE;
+  }
+
+  /* The sphere of the diamond contains all its descendants, so they are
+  culled with it. */
+  const SbVec3f & center = coords[index];
+  float radius = (*diamond_tree)[index].radius;
+  for (int I = 0; I < 6; ++I)
+  {
+    if (planes[I].getDistance(center) < -radius)
+    {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+inline SbBool SoDiamondROAMTerrain::hasSplitParent(const int index) const
+{
+  int parents[2];
+  int parent_count = diamond_tree->getParents(index, parents);
+  for (int I = 0; I < parent_count; ++I)
+  {
+    if ((*diamond_tree)[parents[I]].flags & SbROAMDiamond::IS_SPLIT)
+    {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+inline void SoDiamondROAMTerrain::addSplitQueue(const int index)
+{
+  SbROAMDiamond & diamond = (*diamond_tree)[index];
+  diamond.setPriority(computePriority(index));
+  diamond.flags |= SbROAMDiamond::IS_SPLIT_QUEUED;
+  split_queue.add(&diamond);
+}
+
+inline void SoDiamondROAMTerrain::removeSplitQueue(const int index)
+{
+  SbROAMDiamond & diamond = (*diamond_tree)[index];
+  diamond.flags &= ~SbROAMDiamond::IS_SPLIT_QUEUED;
+  split_queue.remove(&diamond);
+}
+
+inline void SoDiamondROAMTerrain::addMergeQueue(const int index)
+{
+  SbROAMDiamond & diamond = (*diamond_tree)[index];
+  diamond.setPriority(computePriority(index));
+  diamond.flags |= SbROAMDiamond::IS_MERGE_QUEUED;
+  merge_queue.add(&diamond);
+}
+
+inline void SoDiamondROAMTerrain::removeMergeQueue(const int index)
+{
+  SbROAMDiamond & diamond = (*diamond_tree)[index];
+  diamond.flags &= ~SbROAMDiamond::IS_MERGE_QUEUED;
+  merge_queue.remove(&diamond);
+}
+
+void SoDiamondROAMTerrain::forceSplit(const int index)
+{
+  /* All triangles of the diamond have to exist before its split. */
+  int parents[2];
+  int parent_count = diamond_tree->getParents(index, parents);
+  for (int I = 0; I < parent_count; ++I)
+  {
+    if (!((*diamond_tree)[parents[I]].flags & SbROAMDiamond::IS_SPLIT))
+    {
+      forceSplit(parents[I]);
+    }
+  }
+
+  /* Each triangle of the diamond is replaced with two halves. */
+  SbROAMDiamond & diamond = (*diamond_tree)[index];
+  removeSplitQueue(index);
+  diamond.flags |= SbROAMDiamond::IS_SPLIT;
+  triangles += parent_count;
+
+  /* Children get a split parent. */
+  int children[4];
+  int child_count = diamond_tree->getChildren(index, children);
+  for (int I = 0; I < child_count; ++I)
+  {
+    if (!((*diamond_tree)[children[I]].flags &
+      SbROAMDiamond::IS_SPLIT_QUEUED))
+    {
+      addSplitQueue(children[I]);
+    }
+  }
+
+  /* Parents get a split child and can not be merged any more. */
+  for (int I = 0; I < parent_count; ++I)
+  {
+    SbROAMDiamond & parent = (*diamond_tree)[parents[I]];
+    if (parent.flags & SbROAMDiamond::IS_MERGE_QUEUED)
+    {
+      removeMergeQueue(parents[I]);
+    }
+    ++parent.split_child_count;
+  }
+  addMergeQueue(index);
+  is_indices_dirty = TRUE;
+}
+
+void SoDiamondROAMTerrain::merge(const int index)
+{
+  /* Halves of the triangles of the diamond are joined back. */
+  SbROAMDiamond & diamond = (*diamond_tree)[index];
+  removeMergeQueue(index);
+  diamond.flags &= ~SbROAMDiamond::IS_SPLIT;
+  int parents[2];
+  int parent_count = diamond_tree->getParents(index, parents);
+  triangles -= parent_count;
+
+  /* Children without another split parent leave the triangulation. */
+  int children[4];
+  int child_count = diamond_tree->getChildren(index, children);
+  for (int I = 0; I < child_count; ++I)
+  {
+    if (!hasSplitParent(children[I]))
+    {
+      removeSplitQueue(children[I]);
+    }
+  }
+
+  /* Parents without split children can be merged. */
+  for (int I = 0; I < parent_count; ++I)
+  {
+    SbROAMDiamond & parent = (*diamond_tree)[parents[I]];
+    if ((--parent.split_child_count == 0) &&
+      !(parent.flags & SbROAMDiamond::IS_VIRTUAL))
+    {
+      addMergeQueue(parents[I]);
+    }
+  }
+  addSplitQueue(index);
+  is_indices_dirty = TRUE;
+}
+
+void SoDiamondROAMTerrain::recomputePriorities()
+{
+  /* Centers, radii and errors of the diamonds of both queues in one batch,
+  culled diamonds get zero error. */
+  int split_count = split_queue.size();
+  int merge_count = merge_queue.size();
+  priority_batch.resize(split_count + merge_count);
+  for (int I = 0; I < split_count; ++I)
+  {
+    SbROAMDiamond * diamond = static_cast<SbROAMDiamond *>(
+      split_queue[I + 1]);
+    int index = diamond_tree->getIndex(diamond);
+    priority_batch.set(I, coords[index], diamond->radius, isCulled(index) ?
+      0.0f : diamond->error);
+  }
+  for (int I = 0; I < merge_count; ++I)
+  {
+    SbROAMDiamond * diamond = static_cast<SbROAMDiamond *>(
+      merge_queue[I + 1]);
+    int index = diamond_tree->getIndex(diamond);
+    priority_batch.set(split_count + I, coords[index], diamond->radius,
+      isCulled(index) ? 0.0f : diamond->error);
+  }
+  priority_batch.compute(camera_position, lambda);
+
+  /* Priorities are stored back and both queues are sorted again. */
+  for (int I = 0; I < split_count; ++I)
+  {
+    static_cast<SbROAMDiamond *>(split_queue[I + 1])->setPriority(
+      priority_batch.getPriority(I));
+  }
+  for (int I = 0; I < merge_count; ++I)
+  {
+    static_cast<SbROAMDiamond *>(merge_queue[I + 1])->setPriority(
+      priority_batch.getPriority(split_count + I));
+  }
+  split_queue.rebuild();
+  merge_queue.rebuild();
+}
+
+void SoDiamondROAMTerrain::refine()
+{
+  /* Smycka generovani triangulace pro konstantni pocet trojuhelniku. */
+  while (TRUE)
+  {
+    /* The split queue is empty when the whole map is triangulated. */
+    SbROAMDiamond * split_diamond = static_cast<SbROAMDiamond *>(
+      split_queue.getMax());
+    if ((split_diamond == NULL) || (triangles > triangle_count) ||
+      (split_diamond->getPriority() < pixel_error))
+    {
+      /* Merge of the least important diamond if it is less important than
+      the most important unsplit one. Items of one bucket are not ordered,
+      so the priorities are compared by buckets. */
+      SbROAMDiamond * merge_diamond = static_cast<SbROAMDiamond *>(
+        merge_queue.getMin());
+      if ((merge_diamond == NULL) || ((split_diamond == NULL) ?
+        (triangles <= triangle_count) :
+        (SbROAMBucketQueue::getBucket(split_diamond->getPriority()) <=
+        SbROAMBucketQueue::getBucket(merge_diamond->getPriority()))))
+      {
+        break;
+      }
+      merge(diamond_tree->getIndex(merge_diamond));
+    }
+    else
+    {
+      forceSplit(diamond_tree->getIndex(split_diamond));
+    }
+  }
+}
+
+void SoDiamondROAMTerrain::updateIndices()
+{
+  if (!is_indices_dirty)
+  {
+    return;
+  }
+  is_indices_dirty = FALSE;
+
+  /* Every unsplit diamond of the split queue has one triangle for each
+  split parent. */
+  indices.truncate(0);
+  for (int I = 1; I <= split_queue.size(); ++I)
+  {
+    int index = diamond_tree->getIndex(static_cast<SbROAMDiamond *>(
+      split_queue[I]));
+    int first = 0;
+    int second = 0;
+    int parents[2];
+    diamond_tree->getHypotenuse(index, first, second);
+    int parent_count = diamond_tree->getParents(index, parents);
+    for (int J = 0; J < parent_count; ++J)
+    {
+      if ((*diamond_tree)[parents[J]].flags & SbROAMDiamond::IS_SPLIT)
+      {
+        appendTriangle(first, second, parents[J]);
+      }
+    }
+  }
+
+  /* Split diamonds of the finest level have no children holding their
+  halves, the halves are drawn from the merge queue. */
+  for (int I = 1; I <= merge_queue.size(); ++I)
+  {
+    int index = diamond_tree->getIndex(static_cast<SbROAMDiamond *>(
+      merge_queue[I]));
+    if (diamond_tree->isFinest(index))
+    {
+      int first = 0;
+      int second = 0;
+      int parents[2];
+      diamond_tree->getHypotenuse(index, first, second);
+      int parent_count = diamond_tree->getParents(index, parents);
+      for (int J = 0; J < parent_count; ++J)
+      {
+        appendTriangle(parents[J], first, index);
+        appendTriangle(second, parents[J], index);
+      }
+    }
+  }
+}
+
+inline void SoDiamondROAMTerrain::appendTriangle(const int first,
+  const int second, const int apex)
+{
+  /* Orientation of the triangle in the map decides the order of the
+  vertices. */
+  int first_x = first % map_size;
+  int first_y = first / map_size;
+  int cross = ((apex % map_size) - first_x) * ((second / map_size) -
+    first_y) - ((apex / map_size) - first_y) * ((second % map_size) -
+    first_x);
+  indices.append(cross > 0 ? first : second);
+  indices.append(apex);
+  indices.append(cross > 0 ? second : first);
+}
+
+/******************************************************************************
+* SoDiamondROAMTerrain - private
+******************************************************************************/
+
+SoDiamondROAMTerrain::~SoDiamondROAMTerrain()
+{
+  /* Uvolneni internich struktur. */
+  delete diamond_tree;
+}
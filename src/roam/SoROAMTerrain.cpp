@@ -0,0 +1,239 @@
+///////////////////////////////////////////////////////////////////////////////
+//  SoTerrain
+///////////////////////////////////////////////////////////////////////////////
+/// Common base of the ROAM terrain nodes.
+/// \file SoROAMTerrain.cpp
+/// \author agent
+/// \date 17.10.2026
+///
+/// The triangle based ::SoSimpleROAMTerrain and the diamond based
+/// ::SoDiamondROAMTerrain share their basic fields, the primitives of the
+/// height map and its bounding box. The abstract node keeps them in one
+/// place.
+//////////////////////////////////////////////////////////////////////////////
+// Copyright (C) 2026 agent
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+///////////////////////////////////////////////////////////////////////////////
+
+// local includes
+#include <roam/SoROAMTerrain.h>
+
+SO_NODE_ABSTRACT_SOURCE(SoROAMTerrain)
+
+/******************************************************************************
+* SoROAMTerrain - public
+******************************************************************************/
+
+void SoROAMTerrain::initClass()
+{
+  /* Both ROAM nodes initialize their common base. */
+  if (getClassTypeId() != SoType::badType())
+  {
+    return;
+  }
+
+  /* Inicializace tridy. */
+  SO_NODE_INIT_ABSTRACT_CLASS(SoROAMTerrain, SoShape, "Shape");
+}
+
+/******************************************************************************
+* SoROAMTerrain - protected
+******************************************************************************/
+
+/* Staticke konstanty. */
+const int SoROAMTerrain::DEFAULT_PIXEL_ERROR = 6;
+const int SoROAMTerrain::DEFAULT_TRIANGLE_COUNT = 5000;
+
+SoROAMTerrain::SoROAMTerrain():
+  map_size(2), pixel_error(DEFAULT_PIXEL_ERROR),
+  triangle_count(DEFAULT_TRIANGLE_COUNT), is_frustum_culling(TRUE),
+  is_freeze(FALSE), map_size_sensor(NULL), pixel_error_sensor(NULL),
+  triangle_count_sensor(NULL), frustum_culling_sensor(NULL),
+  freeze_sensor(NULL), bbox_node_id(0), bbox_map_size(0), min_height(0.0f),
+  max_height(0.0f)
+{
+  /* Inicializace tridy. */
+  SO_NODE_CONSTRUCTOR(SoROAMTerrain);
+
+  /* Inicializace poli. */
+  SO_NODE_ADD_FIELD(mapSize, (2));
+  SO_NODE_ADD_FIELD(pixelError, (DEFAULT_PIXEL_ERROR));
+  SO_NODE_ADD_FIELD(triangleCount, (DEFAULT_TRIANGLE_COUNT));
+  SO_NODE_ADD_FIELD(frustumCulling, (TRUE));
+  SO_NODE_ADD_FIELD(freeze, (FALSE));
+
+  /* Vytvoreni senzoru. */
+  map_size_sensor = new SoFieldSensor(mapSizeChangedCB, this);
+  pixel_error_sensor = new SoFieldSensor(pixelErrorChangedCB, this);
+  triangle_count_sensor = new SoFieldSensor(triangleCountChangedCB, this);
+  frustum_culling_sensor = new SoFieldSensor(frustumCullingChangedCB, this);
+  freeze_sensor = new SoFieldSensor(freezeChangedCB, this);
+
+  /* Napojeni senzoru na pole. */
+  map_size_sensor->attach(&mapSize);
+  pixel_error_sensor->attach(&pixelError);
+  triangle_count_sensor->attach(&triangleCount);
+  frustum_culling_sensor->attach(&frustumCulling);
+  freeze_sensor->attach(&freeze);
+}
+
+SoROAMTerrain::~SoROAMTerrain()
+{
+  /* Uvolneni senzoru. */
+  delete map_size_sensor;
+  delete pixel_error_sensor;
+  delete triangle_count_sensor;
+  delete frustum_culling_sensor;
+  delete freeze_sensor;
+}
+
+#define SEND_VERTEX(ind) index = (ind); \
+   vertex.setPoint(coords[index]); \
+   vertex.setTextureCoords(texture_coords[index]); \
+   vertex.setNormal(normals[index]); \
+   shapeVertex(&vertex);
+
+void SoROAMTerrain::generatePrimitives(SoAction * action)
+{
+  SoPrimitiveVertex vertex;
+  int index;
+
+  SoState * state = action->getState();
+  const SbVec3f * coords = SoCoordinateElement::getInstance(state)->
+    getArrayPtr3();
+  const SbVec2f * texture_coords = SoTextureCoordinateElement::getInstance(
+    state)->getArrayPtr2();
+  const SbVec3f * normals = SoNormalElement::getInstance(state)->
+    getArrayPtr();
+
+  /* Brutal-force vygenerovani triangle-stripu vyskove mapy. */
+  for (int Y = 0; Y < (map_size - 1); ++Y)
+  {
+    beginShape(action, QUAD_STRIP);
+
+    /* Prvni dva vrcholy pasu. */
+    SEND_VERTEX((Y + 1) * map_size);
+    SEND_VERTEX(Y * map_size);
+
+    for (int X = 1; X < map_size; ++X)
+    {
+      /* Dalsi vrcholy pasu. */
+      SEND_VERTEX(((Y + 1)  * map_size) + X);
+      SEND_VERTEX((Y * map_size) + X);
+    }
+    endShape();
+  }
+}
+
+void SoROAMTerrain::computeBBox(SoAction * action, SbBox3f & box,
+  SbVec3f & center)
+{
+  /* Vypocet ohranicujiciho kvadru a jeho stredu. */
+  SoState * state = action->getState();
+  const SoCoordinateElement * coords = SoCoordinateElement::getInstance(state);
+  int map_size = mapSize.getValue();
+  int vertex_count = SbMin(map_size * map_size, coords->getNum());
+  if (vertex_count <= 0)
+  {
+    return;
+  }
+
+  /* Heights are scanned again only for another coordinate node or map
+  size, the bounding box action runs every frame in some viewers. */
+  if ((coords->getNodeId() != bbox_node_id) || (map_size != bbox_map_size))
+  {
+    bbox_node_id = coords->getNodeId();
+    bbox_map_size = map_size;
+    min_height = max_height = coords->get3(0)[2];
+    for (int I = 1; I < vertex_count; ++I)
+    {
+      float height = coords->get3(I)[2];
+      min_height = SbMin(min_height, height);
+      max_height = SbMax(max_height, height);
+    }
+  }
+
+  /* Vypocet ohraniceni podle dvou rohu vyskove mapy. */
+  SbVec3f min = coords->get3(0);
+  SbVec3f max = coords->get3(vertex_count - 1);
+  min[2] = min_height;
+  max[2] = max_height;
+  box.setBounds(min, max);
+
+  center = box.getCenter();
+}
+
+void SoROAMTerrain::updateMapSize()
+{
+  map_size = mapSize.getValue();
+}
+
+void SoROAMTerrain::updatePixelError()
+{
+  pixel_error = pixelError.getValue();
+}
+
+void SoROAMTerrain::updateTriangleCount()
+{
+  triangle_count = triangleCount.getValue();
+}
+
+void SoROAMTerrain::updateFrustumCulling()
+{
+  is_frustum_culling = frustumCulling.getValue();
+}
+
+void SoROAMTerrain::updateFreeze()
+{
+  is_freeze = freeze.getValue();
+}
+
+void SoROAMTerrain::mapSizeChangedCB(void * _instance, SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoROAMTerrain * instance = reinterpret_cast<SoROAMTerrain *>(_instance);
+  instance->updateMapSize();
+}
+
+void SoROAMTerrain::pixelErrorChangedCB(void * _instance, SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoROAMTerrain * instance = reinterpret_cast<SoROAMTerrain *>(_instance);
+  instance->updatePixelError();
+}
+
+void SoROAMTerrain::triangleCountChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoROAMTerrain * instance = reinterpret_cast<SoROAMTerrain *>(_instance);
+  instance->updateTriangleCount();
+}
+
+void SoROAMTerrain::frustumCullingChangedCB(void * _instance,
+  SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoROAMTerrain * instance = reinterpret_cast<SoROAMTerrain *>(_instance);
+  instance->updateFrustumCulling();
+}
+
+void SoROAMTerrain::freezeChangedCB(void * _instance, SoSensor * sensor)
+{
+  /* Aktualizace vnitrni hodnoty pole. */
+  SoROAMTerrain * instance = reinterpret_cast<SoROAMTerrain *>(_instance);
+  instance->updateFreeze();
+}
@@ -38,7 +38,8 @@ SO_NODE_SOURCE(SoSimpleROAMTerrain)
 void SoSimpleROAMTerrain::initClass()
 {
     /* Inicializace tridy. */
-    SO_NODE_INIT_CLASS(SoSimpleROAMTerrain, SoShape, "Shape");
+    SoROAMTerrain::initClass();
+    SO_NODE_INIT_CLASS(SoSimpleROAMTerrain, SoROAMTerrain, "SoROAMTerrain");
     SO_ENABLE(SoGLRenderAction, SoMaterialBindingElement);
     SO_ENABLE(SoGLRenderAction, SoCoordinateElement);
     SO_ENABLE(SoGLRenderAction, SoTextureCoordinateElement);
@@ -53,42 +54,116 @@ void SoSimpleROAMTerrain::initClass()
 
 SoSimpleROAMTerrain::SoSimpleROAMTerrain():
         coords(NULL), texture_coords(NULL), normals(NULL), view_volume(NULL),
-        viewport_region(NULL), triangle_tree(NULL), tree_size(0), level(0),
-        lambda(0.0f), split_queue(NULL), merge_queue(NULL),
-        is_texture(FALSE), is_normals(FALSE),
-        map_size(2), pixel_error(DEFAULT_PIXEL_ERROR),
-        triangle_count(DEFAULT_TRIANGLE_COUNT), is_frustum_culling(TRUE),
-        is_freeze(FALSE),
-        map_size_sensor(NULL), pixel_error_sensor(NULL), triangle_count_sensor(NULL),
-        frustum_culling_sensor(NULL), freeze_sensor(NULL)
+        viewport_region(NULL), triangle_tree(NULL), level(0),
+        lambda(0.0f), split_queue(NULL), merge_queue(NULL), triangle_pool(),
+        diamond_pool(), recompute_queue(), priority_batch(),
+        batch_triangles(), camera_position(0.0f, 0.0f, 0.0f),
+        threshold(0.0f), is_recompute_all(TRUE), master_terrain(this),
+        patches(), is_registered(FALSE), refinement_count(0),
+        drawn_refinement(0), is_refined(FALSE), is_reset(FALSE),
+        patch_triangle_count(0), vertex_buffer(),
+        triangle_strips(),
+        front_indices(&index_buffers[0]), ready_indices(&index_buffers[1]),
+        back_indices(&index_buffers[2]), is_indices_dirty(TRUE),
+        refinement_thread(NULL), refinement_mutex(), snapshot_mutex(),
+        snapshot_cond(), snapshot(), is_snapshot(FALSE), is_published(FALSE),
+        is_exit_refinement(FALSE), cull_level(0), cull_spheres(NULL),
+        cull_flags(NULL), diamond_tree(NULL), task_pool(NULL),
+        split_tasks(NULL), split_task_count(0), split_threshold(0.0f),
+        is_texture(FALSE), is_normals(FALSE), culled_levels(0),
+        queue_type(HEAP),
+        max_camera_speed(0.0f), thread_count(0), cache_directory(""),
+        refinement_budget(0.0), is_async_refinement(FALSE),
+        error_metric(ISOTROPIC), patch_position(0, 0),
+        refinement_mode(INCREMENTAL),
+        culled_levels_sensor(NULL), queue_type_sensor(NULL),
+        max_camera_speed_sensor(NULL), thread_count_sensor(NULL),
+        cache_directory_sensor(NULL), refinement_budget_sensor(NULL),
+        async_refinement_sensor(NULL), error_metric_sensor(NULL),
+        master_sensor(NULL), patch_position_sensor(NULL),
+        refinement_mode_sensor(NULL)
 {
     /* Inicializace tridy. */
     SO_NODE_CONSTRUCTOR(SoSimpleROAMTerrain);
 
     /* Inicializace poli */
-    SO_NODE_ADD_FIELD(mapSize, (2));
-    SO_NODE_ADD_FIELD(pixelError, (DEFAULT_PIXEL_ERROR));
-    SO_NODE_ADD_FIELD(triangleCount, (DEFAULT_TRIANGLE_COUNT));
-    SO_NODE_ADD_FIELD(frustumCulling, (TRUE));
-    SO_NODE_ADD_FIELD(freeze, (FALSE));
+    SO_NODE_ADD_FIELD(culledLevels, (0));
+    SO_NODE_ADD_FIELD(queueType, (HEAP));
+    SO_NODE_ADD_FIELD(maxCameraSpeed, (0.0f));
+    SO_NODE_ADD_FIELD(threadCount, (0));
+    SO_NODE_ADD_FIELD(cacheDirectory, (""));
+    SO_NODE_ADD_FIELD(refinementBudget, (0.0f));
+    SO_NODE_ADD_FIELD(asyncRefinement, (FALSE));
+    SO_NODE_ADD_FIELD(errorMetric, (ISOTROPIC));
+    SO_NODE_ADD_FIELD(master, (NULL));
+    SO_NODE_ADD_FIELD(patchPosition, (0, 0));
+    SO_NODE_ADD_FIELD(refinementMode, (INCREMENTAL));
+
+    /* Definice vyctovych typu. */
+    SO_NODE_DEFINE_ENUM_VALUE(QueueType, HEAP);
+    SO_NODE_DEFINE_ENUM_VALUE(QueueType, BUCKETS);
+    SO_NODE_SET_SF_ENUM_TYPE(queueType, QueueType);
+    SO_NODE_DEFINE_ENUM_VALUE(ErrorMetric, ISOTROPIC);
+    SO_NODE_DEFINE_ENUM_VALUE(ErrorMetric, WEDGIE);
+    SO_NODE_SET_SF_ENUM_TYPE(errorMetric, ErrorMetric);
+    SO_NODE_DEFINE_ENUM_VALUE(RefinementMode, INCREMENTAL);
+    SO_NODE_DEFINE_ENUM_VALUE(RefinementMode, SPLIT_ONLY);
+    SO_NODE_SET_SF_ENUM_TYPE(refinementMode, RefinementMode);
 
     /* Vytvoreni senzoru. */
-    map_size_sensor = new SoFieldSensor(mapSizeChangedCB, this);
-    pixel_error_sensor = new SoFieldSensor(pixelErrorChangedCB, this);
-    triangle_count_sensor = new SoFieldSensor(triangleCountChangedCB, this);
-    frustum_culling_sensor = new SoFieldSensor(frustumCullingChangedCB, this);
-    freeze_sensor = new SoFieldSensor(freezeChangedCB, this);
+    culled_levels_sensor = new SoFieldSensor(culledLevelsChangedCB, this);
+    queue_type_sensor = new SoFieldSensor(queueTypeChangedCB, this);
+    max_camera_speed_sensor = new SoFieldSensor(maxCameraSpeedChangedCB,
+                                                this);
+    thread_count_sensor = new SoFieldSensor(threadCountChangedCB, this);
+    cache_directory_sensor = new SoFieldSensor(cacheDirectoryChangedCB,
+                                               this);
+    refinement_budget_sensor = new SoFieldSensor(refinementBudgetChangedCB,
+                                                 this);
+    async_refinement_sensor = new SoFieldSensor(asyncRefinementChangedCB,
+                                                this);
+    error_metric_sensor = new SoFieldSensor(errorMetricChangedCB, this);
+    master_sensor = new SoFieldSensor(masterChangedCB, this);
+    patch_position_sensor = new SoFieldSensor(patchPositionChangedCB, this);
+    refinement_mode_sensor = new SoFieldSensor(refinementModeChangedCB,
+                                               this);
 
     /* Napojeni senzoru na pole */
-    map_size_sensor->attach(&mapSize);
-    pixel_error_sensor->attach(&pixelError);
-    triangle_count_sensor->attach(&triangleCount);
-    frustum_culling_sensor->attach(&frustumCulling);
-    freeze_sensor->attach(&freeze);
+    culled_levels_sensor->attach(&culledLevels);
+    queue_type_sensor->attach(&queueType);
+    max_camera_speed_sensor->attach(&maxCameraSpeed);
+    thread_count_sensor->attach(&threadCount);
+    cache_directory_sensor->attach(&cacheDirectory);
+    refinement_budget_sensor->attach(&refinementBudget);
+    async_refinement_sensor->attach(&asyncRefinement);
+    error_metric_sensor->attach(&errorMetric);
+    master_sensor->attach(&master);
+    patch_position_sensor->attach(&patchPosition);
+    refinement_mode_sensor->attach(&refinementMode);
 
     /* Inicializace internich struktur. */
-    split_queue = new SbROAMSplitQueue();
-    merge_queue = new SbROAMMergeQueue();
+    memset(index_triangle_counts, 0, sizeof(index_triangle_counts));
+    split_queue = SbROAMSplitQueue::create(
+        static_cast<SbROAMSplitQueue::Type>(queue_type));
+    merge_queue = SbROAMMergeQueue::create(
+        static_cast<SbROAMMergeQueue::Type>(queue_type));
+}
+
+const SbROAMPool<SbROAMSplitQueueTriangle> &
+SoSimpleROAMTerrain::getTrianglePool() const
+{
+    return master_terrain->triangle_pool;
+}
+
+const SbROAMPool<SbROAMMergeQueueDiamond> &
+SoSimpleROAMTerrain::getDiamondPool() const
+{
+    return master_terrain->diamond_pool;
+}
+
+int SoSimpleROAMTerrain::getDrawnTriangleCount() const
+{
+    return index_triangle_counts[front_indices - index_buffers];
 }
 
 /******************************************************************************
@@ -96,15 +171,12 @@ SoSimpleROAMTerrain::SoSimpleROAMTerrain():
 ******************************************************************************/
 
 /* Staticke konstanty. */
-const int SoSimpleROAMTerrain::DEFAULT_PIXEL_ERROR = 6;
-const int SoSimpleROAMTerrain::DEFAULT_TRIANGLE_COUNT = 5000;
-
-#define GL_SEND_VERTEX(index) vertex_index = index; \
-  if (is_texture) \
-    glTexCoord2fv(texture_coords[vertex_index].getValue()); \
-  if (is_normals) \
-    glNormal3fv(normals[vertex_index].getValue()); \
-  glVertex3fv(coords[vertex_index].getValue());
+const int SoSimpleROAMTerrain::BUDGET_CHECK_STEPS = 16;
+const int SoSimpleROAMTerrain::CULL_LEVELS = 12;
+const int SoSimpleROAMTerrain::CULL_IN = 0x3f;
+const int SoSimpleROAMTerrain::CULL_OUT = 0x40;
+const int SoSimpleROAMTerrain::SPLIT_TASK_LEVEL = 6;
+const float SoSimpleROAMTerrain::SPLIT_THRESHOLD_STEP = 1.1f;
 
 void SoSimpleROAMTerrain::GLRender(SoGLRenderAction * action)
 {
@@ -116,15 +188,12 @@ void SoSimpleROAMTerrain::GLRender(SoGLRenderAction * action)
     /* Ziskani informaci z grafu sceny. */
     SoState * state = action->getState();
     view_volume = &SoViewVolumeElement::get(state);
-    view_volume->getViewVolumePlanes(planes);
     viewport_region = &SoViewportRegionElement::get(state);
 
     /* Pri prvnim prubehu se vygeneruje strom trojuhelniku */
-    static SbBool first_run = TRUE;
-    if (first_run)
+    if (triangle_tree == NULL)
     {
         PR_START_PROFILE(preprocess);
-        first_run = FALSE;
 
         /* Pracujeme pouze s tridimenzionalnimi geometrickymi souradnicemi
         a dvoudimenzionalnimi texturovymi souradnicemi. */
@@ -137,129 +206,147 @@ void SoSimpleROAMTerrain::GLRender(SoGLRenderAction * action)
                 getArrayPtr2();
         normals = SoNormalElement::getInstance(state)->getArrayPtr();
 
-        /* Vypocet levelu jako 2 * log2(map_size - 1) */
-        int tmp_size = map_size - 1;
-        level = 0;
-        while (tmp_size > 1)
+        /* Vertices of the height map are drawn from a vertex buffer, arrays
+        shorter than the map are not used. */
+        int vertex_count = map_size * map_size;
+        vertex_buffer.setArrays(coords,
+            (SoNormalElement::getInstance(state)->getNum() >= vertex_count) ?
+            normals : NULL,
+            (SoTextureCoordinateElement::getInstance(state)->getNum() >=
+             vertex_count) ? texture_coords : NULL, vertex_count);
+
+        /* Vytvoreni implicitniho stromu a vypocet metriky jeho
+        trojuhelniku. */
+        triangle_tree = new SbROAMTriangleTree(coords, map_size,
+                                               culled_levels);
+        if (cache_directory.getLength() > 0)
         {
-            level += 2;
-            tmp_size >>= 1;
+            /* The metric is loaded from the cache file of this height map,
+            if there is no valid one, it is computed and stored. Failure of
+            storing does not prevent rendering. */
+            uint64_t hash = triangle_tree->getHash();
+            SbString cache_name;
+            cache_name.sprintf("%s/roam_%08x%08x_%d.cache",
+                               cache_directory.getString(),
+                               static_cast<unsigned int>(hash >> 32),
+                               static_cast<unsigned int>(hash & 0xffffffff),
+                               triangle_tree->getStoredLevel());
+            if (!triangle_tree->load(cache_name.getString()))
+            {
+                triangle_tree->build(thread_count);
+                triangle_tree->save(cache_name.getString());
+            }
+        }
+        else
+        {
+            triangle_tree->build(thread_count);
+        }
+        level = triangle_tree->getLevel();
+
+        /* Bounding spheres of the triangles with culling flags in the
+        table. The sphere around the apex contains the triangle and all its
+        children. */
+        cull_level = SbMin(level, CULL_LEVELS);
+        int cull_size = (1 << (cull_level + 1)) - 1;
+        cull_spheres = new SbVec4f[cull_size];
+        cull_flags = new unsigned char[cull_size];
+        memset(cull_flags, 0, cull_size);
+        for (int I = 1; I < cull_size; ++I)
+        {
+            SbROAMTriangle triangle;
+            triangle_tree->getTriangle(I, triangle);
+            const SbVec3f & apex = coords[triangle.apex];
+            float radius = SbMax(triangle.radius, SbMax(
+                                 (coords[triangle.first] - apex).length(),
+                                 (coords[triangle.second] - apex).length()));
+            cull_spheres[I].setValue(apex[0], apex[1], apex[2], radius);
         }
-
-        /* Zjisteni poctu trojuhelniku ve stromu jako 2^(level + 1) - 1. */
-        tree_size = (1 << (level + 1)) - 1;
-
-        /* Vypocet indexu rohovych vertexu mapy. */
-        int top_left = 0;
-        int top_right = map_size;
-        int bottom_right = top_right * top_right - 1;
-        int bottom_left = bottom_right - top_right-- + 1; // !! vedlejsi efekt
-
-        /* Alokace trojuhelniku a vytvoreni stromu. */
-        triangle_tree = new SbROAMTriangle[tree_size];
-        triangle_tree[1] = SbROAMTriangle(top_left, bottom_right, top_right, 1);
-        triangle_tree[2] = SbROAMTriangle(bottom_right, top_left, bottom_left, 1);
-        initTriangle(triangle_tree, 1);
-        initTriangle(triangle_tree, 2);
-
-        /* Dva koreny binarniho stromu trojuhelniku. */
-        SbROAMTriangle * triangle_1 = &triangle_tree[1];
-        SbROAMTriangle * triangle_2 = &triangle_tree[2];
-
-        SbROAMSplitQueueTriangle * root_1 =
-                new SbROAMSplitQueueTriangle(triangle_1, computePriority(triangle_1));
-        SbROAMSplitQueueTriangle * root_2 =
-                new SbROAMSplitQueueTriangle(triangle_2, computePriority(triangle_2));
-
-        /* Jejich vzajemne propojeni. */
-        root_1->base = root_2;
-        root_2->base = root_1;
-
-        /* Vlozeni korenu do fronty trojuhelniku. */
-        split_queue->add(root_1);
-        split_queue->add(root_2);
 
         PR_STOP_PROFILE(preprocess);
     }
 
-    if (!is_freeze)
+    /* The master creates roots of the patch in its next refinement. */
+    if (!is_registered)
     {
-        /* Aktualizace lambdy pro aktualni okno. */
-        lambda = (view_volume->getNearDist() *
-                  viewport_region->getViewportSizePixels()[1]) /
-                 (view_volume->getHeight());
+        master_terrain->addPatch(this);
+        is_registered = TRUE;
+    }
 
-        /* Prepocitani priority v prioritni fronte na rozdeleni. */
-        int size = split_queue->size();
-        for (int I = 1; I <= size; ++I)
+    if (master_terrain != this)
+    {
+        /* Patches are refined by their master, they draw the index array
+        filled by its rendering or published by its refinement thread. */
+        if (refinement_thread != NULL)
         {
-            SbROAMSplitQueueTriangle * triangle = (*split_queue)[I];
-            triangle->setPriority(this->computePriority(triangle->triangle));
+            stopRefinementThread();
         }
-        split_queue->buildHeap(NULL, NULL);
 
-        /* Prepocitani priority v prioritni fronte na spojeni. */
-        size = merge_queue->size();
-        for (int J = 1; J <= size; ++J)
+        /* A patch which has already drawn the last refinement of its
+        master is rendered before the master in this frame, it runs the
+        refinement of the master instead of drawing the one of the last
+        frame. */
+        if ((master_terrain->refinement_thread == NULL) &&
+            (master_terrain->triangle_tree != NULL) &&
+            (drawn_refinement == master_terrain->refinement_count))
         {
-            SbROAMMergeQueueDiamond * diamond = (*merge_queue)[J];
+            SbROAMCamera camera;
+            computeCamera(camera);
+            master_terrain->refineFrame(camera);
+            master_terrain->is_refined = TRUE;
+        }
+        drawn_refinement = master_terrain->refinement_count;
 
-            float priority = PRIORITY_MIN;
-            float first_priority = diamond->first->getPriority();
-            float second_priority = diamond->second->getPriority();
-            priority = SbMax(priority, first_priority);
-            priority = SbMax(priority, second_priority);
+        SbThreadAutoLock lock(&snapshot_mutex);
+        if (is_published)
+        {
+            SbList<GLuint> * published_indices = ready_indices;
+            ready_indices = front_indices;
+            front_indices = published_indices;
+            is_published = FALSE;
+        }
+    }
+    else
+    {
+        /* Camera of the current frame. */
+        SbROAMCamera camera;
+        computeCamera(camera);
 
-            if (diamond->third != NULL)
-            {
-                float third_priority = diamond->third->getPriority();
-                float fourth_priority = diamond->fourth->getPriority();
-                priority = SbMax(priority, third_priority);
-                priority = SbMax(priority, fourth_priority);
-            }
-            diamond->setPriority(priority);
+        /* Start or stop of the refinement thread. */
+        if (is_async_refinement && (refinement_thread == NULL))
+        {
+            startRefinementThread();
+        }
+        else if (!is_async_refinement && (refinement_thread != NULL))
+        {
+            stopRefinementThread();
         }
-        merge_queue->buildHeap(NULL, NULL);
 
-        /* Smycka generovani triangulace pro konstantni pocet trojuhelniku. */
-        while (TRUE)
+        if (refinement_thread != NULL)
         {
-            if ((split_queue->size() > triangle_count) ||
-                (split_queue->getMax()->getPriority() < pixel_error))
-            {
-                if (merge_queue->size() > 0)
-                {
-                    if (split_queue->getMax()->getPriority() <=
-                        merge_queue->getMin()->getPriority())
-                    {
-                        break;
-                    }
-                    else
-                    {
-                        merge(merge_queue->getMin());
-                    }
-                }
-                else
-                {
-                    break;
-                }
-            }
-            else
+            /* The thread refines against the latest camera, the most recent
+            published triangulation is drawn. */
+            SbThreadAutoLock lock(&snapshot_mutex);
+            snapshot = camera;
+            is_snapshot = TRUE;
+            snapshot_cond.wakeOne();
+            if (is_published)
             {
-                /* Ziskani a rozdeleni trojuhelniku. */
-                SbROAMSplitQueueTriangle * parent = split_queue->getMax();
-                if (parent->triangle->level == level)
-                {
-                    parent->setPriority(split_queue, PRIORITY_MIN);
-                }
-                else
-                {
-                    SbROAMSplitQueueTriangle * left_child = NULL;
-                    SbROAMSplitQueueTriangle * right_child = NULL;
-                    forceSplit(parent, left_child, right_child);
-                }
+                SbList<GLuint> * published_indices = ready_indices;
+                ready_indices = front_indices;
+                front_indices = published_indices;
+                is_published = FALSE;
             }
         }
+        else if (is_refined)
+        {
+            /* A patch rendered earlier in this frame has already refined
+            the triangulation. */
+            is_refined = FALSE;
+        }
+        else
+        {
+            refineFrame(camera);
+        }
     }
 
     /* Inicializace vykreslovani. */
@@ -287,202 +374,115 @@ void SoSimpleROAMTerrain::GLRender(SoGLRenderAction * action)
     }
 
     /* Vykresleni trojuhelniku. */
-    glBegin(GL_TRIANGLES);
-    for (int I = 1; I <= split_queue->size(); ++I)
-    {
-        SbROAMTriangle * triangle = (*split_queue)[I]->triangle;
-        int vertex_index;
-
-        /* Vykresleni trojuhelniku. */
-        GL_SEND_VERTEX(triangle->first);
-        GL_SEND_VERTEX(triangle->apex);
-        GL_SEND_VERTEX(triangle->second);
-    }
-    glEnd();
+    vertex_buffer.bind(action->getCacheContext(), is_normals, is_texture);
+    glDrawElements(GL_TRIANGLE_STRIP, front_indices->getLength(),
+                   GL_UNSIGNED_INT, front_indices->getArrayPtr());
+    vertex_buffer.unbind();
 
     endSolidShape(action);
 }
 
-#define SEND_VERTEX(ind) index = (ind); \
-   vertex.setPoint(coords[index]); \
-   vertex.setTextureCoords(texture_coords[index]); \
-   vertex.setNormal(normals[index]); \
-   shapeVertex(&vertex);
+/******************************************************************************
+* SoSimpleROAMTerrain - protected
+******************************************************************************/
 
-void SoSimpleROAMTerrain::generatePrimitives(SoAction * action)
+inline int SoSimpleROAMTerrain::computeCullFlags(const SbVec3f & center,
+                                                const float radius,
+                                                int flags) const
 {
-    SoPrimitiveVertex vertex;
-    int index;
-
-    SoState * state = action->getState();
-    coords = SoCoordinateElement::getInstance(state)->getArrayPtr3();
-    texture_coords = SoTextureCoordinateElement::getInstance(state)->
-            getArrayPtr2();
-    normals = SoNormalElement::getInstance(state)->getArrayPtr();
-
-    /* Brutal-force vygenerovani triangle-stripu vyskove mapy. */
-    for (int Y = 0; Y < (map_size - 1); ++Y)
+    /* Only planes which do not contain the sphere of the parent are
+    tested. */
+    int mask = 0x01;
+    for (int I = 0; I < 6; ++I, mask <<= 1)
     {
-        beginShape(action, QUAD_STRIP);
-
-        /* Prvni dva vrcholy pasu. */
-        SEND_VERTEX((Y + 1) * map_size);
-        SEND_VERTEX(Y * map_size);
-
-        for (int X = 1; X < map_size; ++X)
+        if (!(flags & mask))
         {
-            /* Dalsi vrcholy pasu. */
-            SEND_VERTEX(((Y + 1)  * map_size) + X);
-            SEND_VERTEX((Y * map_size) + X);
+            float distance = planes[I].getDistance(center);
+            if (distance < -radius)
+            {
+                return CULL_OUT;
+            }
+            if (distance >= radius)
+            {
+                flags |= mask;
+            }
         }
-        endShape();
     }
+    return flags;
 }
 
-void SoSimpleROAMTerrain::computeBBox(SoAction * action, SbBox3f & box,
-                                      SbVec3f & center)
+inline int SoSimpleROAMTerrain::getCullFlags(const SbROAMTriangle & triangle)
+const
 {
-    /* Vypocet ohranicujiciho kvadru a jeho stredu. */
-    SoState * state = action->getState();
-    const SoCoordinateElement * coords = SoCoordinateElement::getInstance(state);
-    int map_size = mapSize.getValue();
-
-    /* Vypocet ohraniceni podle dvou rohu vyskove mapy. */
-    SbVec3f min = coords->get3(0);
-    SbVec3f max = coords->get3(map_size * map_size - 1);
-    max[2] = (max[1] - min[1]) * 0.5;
-    min[2] = -max[2];
-    box.setBounds(min, max);
-
-    center = box.getCenter();
-}
-
-/******************************************************************************
-* SoSimpleROAMTerrain - protected
-******************************************************************************/
-
-void SoSimpleROAMTerrain::initTriangle(SbROAMTriangle * triangle_tree,
-                                       const int index)
-{
-    /* Rodicovsky trojuhelnik, ktery se inicializuje */
-    SbROAMTriangle & parent = triangle_tree[index];
-
-    /* Vrcholy rodicovskeho trojuhelniku. */
-    const SbVec3f & first = coords[parent.first];
-    const SbVec3f & second = coords[parent.second];
-    const SbVec3f & apex = coords[parent.apex];
-
-    /* Dokud neni spodni patro stromu, inicializace potomku. */
-    if (parent.level < level)
-    {
-        /* Naleznuti potomku. */
-        int left_index = (index << 1) + 1;
-        int right_index = left_index + 1;
-        SbROAMTriangle & left_child = triangle_tree[left_index];
-        SbROAMTriangle & right_child = triangle_tree[right_index];
-
-        /* Nastaveni vrcholu leveho potomka */
-        left_child.first = parent.apex;
-        left_child.second = parent.first;
-        left_child.apex = (parent.first + parent.second) >> 1;
-        left_child.level = parent.level + 1;
-
-        /* Nastaveni vrcholu praveho potomka */
-        right_child.first = parent.second;
-        right_child.second = parent.apex;
-        right_child.apex = (parent.first + parent.second) >> 1;
-        right_child.level = parent.level + 1;
-
-        /* Inicializace potomku. */
-        initTriangle(triangle_tree, left_index);
-        initTriangle(triangle_tree, right_index);
-
-        /* Vypocet "podpadku" jako maximum chyby obou potomku + rozdil vysky
-        vrcholu s pravym uhlem a prumene vysky obou vrcholu prepony. */
-        parent.error = SbMax(left_child.error, right_child.error) +
-                       SbAbs(apex[2] - (first[2] + second[2]) * 0.5f);
-
-        /* Vypocet polomeru kuloplochy ohranicujici trojuhelnik. */
-        const SbVec3f & left_apex = coords[left_child.apex];
-        const SbVec3f & right_apex = coords[right_child.apex];
-        float left_radius = (apex - left_apex).length() + left_child.radius;
-        float right_radius = (apex - right_apex).length() + right_child.radius;
-        parent.radius = SbMax(left_radius, right_radius);
+    if (triangle.level <= cull_level)
+    {
+        return cull_flags[triangle.index];
     }
-    else
+
+    /* Flags of the ancestor in the table, the index of a triangle plus one
+    has one bit more for each level. */
+    int flags = cull_flags[((triangle.index + 1) >>
+                            (triangle.level - cull_level)) - 1];
+    if ((flags & CULL_OUT) || (flags == CULL_IN))
     {
-        /* Trojuhelniky na dne stromu maji nulovou metriku. */
-        parent.error = PRIORITY_MIN;
-        parent.radius = 0.0;
+        return flags;
     }
+
+    /* The sphere around the apex has to contain the whole triangle, not
+    only the apices of its children. */
+    const SbVec3f & apex = coords[triangle.apex];
+    float radius = SbMax(triangle.radius, SbMax(
+                         (coords[triangle.first] - apex).length(),
+                         (coords[triangle.second] - apex).length()));
+    return computeCullFlags(apex, radius, flags);
 }
 
-inline SbBool SoSimpleROAMTerrain::isInViewVolume(const SbVec3f first,
-                                                  const SbVec3f second, const SbVec3f apex) const
+void SoSimpleROAMTerrain::updateCullFlags()
 {
-    /* Priznaky polorovin, ve kterych se nachazeji jednotlive vrcholy
-    trojuhelniku. */
-    int first_flags = 0x00;
-    int second_flags = 0x00;
-    int apex_flags = 0x00;
-    int mask = 0x01;
-
-    /* Pro vsech sest orezavacich rovin otestujeme kazdy vrchol trojuhelniku
-    na pritomnost v poloprostoru. */
-    for (int I = 0; I < 6; ++I, mask <<= 1)
+    /* Parents precede their children in the table. */
+    int size = (1 << (cull_level + 1)) - 1;
+    for (int I = 1; I < size; ++I)
     {
-        if (!planes[I].isInHalfSpace(first))
-        {
-            first_flags |= mask;
-        }
-        if (!planes[I].isInHalfSpace(second))
+        int flags = (I > 2) ? cull_flags[(I - 1) >> 1] : 0;
+        if (!(flags & CULL_OUT) && (flags != CULL_IN))
         {
-            second_flags |= mask;
-        }
-        if (!planes[I].isInHalfSpace(apex))
-        {
-            apex_flags |= mask;
+            const SbVec4f & sphere = cull_spheres[I];
+            flags = computeCullFlags(SbVec3f(sphere[0], sphere[1],
+                                             sphere[2]), sphere[3], flags);
         }
-    }
-
-    /* Je-li nektery z vrcholu primo v pohledu kamery vykreslime vzdy. */
-    if ((first_flags & second_flags & apex_flags) == 0x00)
-    {
-        return TRUE;
-    }
-    else
-    {
-        /* Jsou-li vsechny vrcholy mimo, vratime vysledek potencialni viditelnosti
-        trojuhelniku. */
-        return !((first_flags & second_flags) && (second_flags & apex_flags)
-                 && (apex_flags & first_flags));
+        cull_flags[I] = static_cast<unsigned char>(flags);
     }
 }
 
 inline float SoSimpleROAMTerrain::computePriority(
-        const SbROAMTriangle * triangle) const
+        const SbROAMTriangle & triangle) const
 {
     /* Ziskani vrcholu trojuhelniku a pozice kamery. */
-    SbVec3f camera_position = view_volume->getProjectionPoint();
-    const SbVec3f & first = coords[triangle->first];
-    const SbVec3f & second = coords[triangle->second];
-    const SbVec3f & apex = coords[triangle->apex];
+    const SbVec3f & apex = coords[triangle.apex];
 
     /* Vzdalenost kamery od spolecneho vrcholu obou trojuhelniku. */
     float distance = (camera_position - apex).length();
 
     /* Je-li kamera prilis blizko trojuhelniku, vyresleni vzdy. */
-    if (distance < triangle->radius)
+    if (distance < triangle.radius)
     {
         return PRIORITY_MAX;
     }
     else
     {
         /* Neni-li tak blizko, zjisteni jestli je trojuhelnik videt. */
-        if (!this->is_frustum_culling || this->isInViewVolume(first, second,
-                                                              apex))
+        if (!this->is_frustum_culling ||
+            !(this->getCullFlags(triangle) & CULL_OUT))
         {
-            return lambda * triangle->error / (distance - triangle->radius);
+            /* Wedgie thickness is projected to the view ray. */
+            float error = triangle.error;
+            if (error_metric == WEDGIE)
+            {
+                error *= SbROAMPriorityBatch::getWedgieFactor(
+                    camera_position[2] - apex[2], distance, triangle.radius);
+            }
+            return lambda * error / SbMax(distance - triangle.radius,
+                FLT_MIN);
         }
         else
         {
@@ -491,6 +491,187 @@ inline float SoSimpleROAMTerrain::computePriority(
     }
 }
 
+inline float SoSimpleROAMTerrain::computePriority(
+        const SbROAMMergeQueueDiamond * diamond) const
+{
+    /* The highest priority of the triangles of the diamond. */
+    float priority = PRIORITY_MIN;
+    priority = SbMax(priority, diamond->first->getPriority());
+    priority = SbMax(priority, diamond->second->getPriority());
+
+    /* Nejde-li od degradovany diamond. */
+    if (diamond->third != NULL)
+    {
+        priority = SbMax(priority, diamond->third->getPriority());
+        priority = SbMax(priority, diamond->fourth->getPriority());
+    }
+    return priority;
+}
+
+inline int SoSimpleROAMTerrain::computeDelay(
+        const SbROAMSplitQueueTriangle * triangle) const
+{
+    /* Priority of triangles without error never changes. */
+    const SbROAMTriangle & tree_triangle = triangle->triangle;
+    if (tree_triangle.error <= 0.0f)
+    {
+        return SbROAMRecomputeQueue::SLOT_COUNT;
+    }
+
+    /* Triangles outside of the view volume can appear in it by rotation of
+    the camera, which is not limited. */
+    if ((triangle->getPriority() <= PRIORITY_MIN) || (threshold <= 0.0f))
+    {
+        return 1;
+    }
+
+    /* The priority crosses the threshold at the distance lambda * error /
+    threshold from the bounding sphere, the camera needs at least the
+    difference of the distances divided by its speed to get there. */
+    float distance = (camera_position -
+                      triangle->patch->coords[tree_triangle.apex]).length() -
+                     tree_triangle.radius;
+    float crossing = lambda * tree_triangle.error / threshold;
+    float delay = SbAbs(distance - crossing) / max_camera_speed;
+    return static_cast<int>(SbMin(delay, static_cast<float>(
+                            SbROAMRecomputeQueue::SLOT_COUNT)));
+}
+
+void SoSimpleROAMTerrain::computeBatchPriorities()
+{
+    /* Gathering of the triangles, culled ones get zero error and so the
+    lowest priority. Every triangle is culled by the table of its patch. */
+    int size = batch_triangles.getLength();
+    priority_batch.resize(size);
+    for (int I = 0; I < size; ++I)
+    {
+        const SbROAMTriangle & triangle = batch_triangles[I]->triangle;
+        const SoSimpleROAMTerrain * patch = batch_triangles[I]->patch;
+        float error = (patch->is_frustum_culling &&
+                       (patch->getCullFlags(triangle) & CULL_OUT)) ? 0.0f :
+                      triangle.error;
+        priority_batch.set(I, patch->coords[triangle.apex], triangle.radius,
+                           error);
+    }
+    priority_batch.compute(camera_position, lambda);
+}
+
+void SoSimpleROAMTerrain::recomputeAll()
+{
+    /* Prepocitani priority v prioritni fronte na rozdeleni. */
+    recompute_queue.emptyQueue();
+    int size = split_queue->size();
+    batch_triangles.truncate(0);
+    for (int I = 1; I <= size; ++I)
+    {
+        batch_triangles.append((*split_queue)[I]);
+    }
+    computeBatchPriorities();
+    for (int I = 0; I < size; ++I)
+    {
+        SbROAMSplitQueueTriangle * triangle = batch_triangles[I];
+        triangle->setPriority(priority_batch.getPriority(I));
+
+        /* Scheduling of the next recomputation. */
+        if (max_camera_speed > 0.0f)
+        {
+            recompute_queue.add(triangle, computeDelay(triangle));
+        }
+    }
+    split_queue->rebuild();
+
+    /* Prepocitani priority v prioritni fronte na spojeni. */
+    size = merge_queue->size();
+    for (int J = 1; J <= size; ++J)
+    {
+        SbROAMMergeQueueDiamond * diamond = (*merge_queue)[J];
+        diamond->setPriority(this->computePriority(diamond));
+    }
+    merge_queue->rebuild();
+}
+
+void SoSimpleROAMTerrain::recomputeScheduled()
+{
+    /* Recomputation of the triangles scheduled for this frame and their
+    diamonds. */
+    recompute_queue.nextFrame();
+    SbROAMSplitQueueTriangle * triangle = NULL;
+    batch_triangles.truncate(0);
+    while ((triangle = recompute_queue.extract()) != NULL)
+    {
+        batch_triangles.append(triangle);
+    }
+    computeBatchPriorities();
+    for (int I = 0; I < batch_triangles.getLength(); ++I)
+    {
+        triangle = batch_triangles[I];
+        triangle->setPriority(split_queue, priority_batch.getPriority(I));
+    }
+
+    /* Diamonds after all their scheduled triangles. */
+    for (int I = 0; I < batch_triangles.getLength(); ++I)
+    {
+        triangle = batch_triangles[I];
+        if (triangle->diamond != NULL)
+        {
+            triangle->diamond->setPriority(merge_queue,
+                                           this->computePriority(triangle->diamond));
+        }
+
+        /* Scheduling of the next recomputation. */
+        recompute_queue.add(triangle, computeDelay(triangle));
+    }
+}
+
+inline SbROAMSplitQueueTriangle * SoSimpleROAMTerrain::createTriangle(
+        const SbROAMTriangle & triangle, const float priority)
+{
+    /* Konstrukce trojuhelniku v pameti z poolu. */
+    SbROAMSplitQueueTriangle * split_triangle = new
+            (master_terrain->triangle_pool.allocate())
+            SbROAMSplitQueueTriangle(triangle, priority);
+    split_triangle->patch = this;
+    ++patch_triangle_count;
+    is_indices_dirty = TRUE;
+
+    /* New triangles are recomputed in the next frame. */
+    if (master_terrain->max_camera_speed > 0.0f)
+    {
+        master_terrain->recompute_queue.add(split_triangle, 1);
+    }
+    return split_triangle;
+}
+
+inline void SoSimpleROAMTerrain::destroyTriangle(
+        SbROAMSplitQueueTriangle * triangle)
+{
+    /* Vraceni trojuhelniku do poolu. The triangle can belong to another
+    patch of the same master. */
+    if (triangle != NULL)
+    {
+        master_terrain->recompute_queue.remove(triangle);
+        --triangle->patch->patch_triangle_count;
+        triangle->patch->is_indices_dirty = TRUE;
+    }
+    master_terrain->triangle_pool.free(triangle);
+}
+
+inline SbROAMMergeQueueDiamond * SoSimpleROAMTerrain::createDiamond(
+        SbROAMSplitQueueTriangle * first, SbROAMSplitQueueTriangle * second,
+        SbROAMSplitQueueTriangle * third, SbROAMSplitQueueTriangle * fourth,
+        const float priority)
+{
+    /* Konstrukce diamondu v pameti z poolu. */
+    return new (master_terrain->diamond_pool.allocate())
+            SbROAMMergeQueueDiamond(first, second, third, fourth, priority);
+}
+
+inline void SoSimpleROAMTerrain::destroyDiamond(
+        SbROAMMergeQueueDiamond * diamond)
+{
+    master_terrain->diamond_pool.free(diamond); // vraceni diamondu do poolu
+}
+
 inline void SoSimpleROAMTerrain::reconnectNeighbour(
         SbROAMSplitQueueTriangle * triangle,
         SbROAMSplitQueueTriangle * old_neighbour,
@@ -520,23 +701,24 @@ void SoSimpleROAMTerrain::simpleSplit(SbROAMSplitQueueTriangle * parent,
 {
     /* Odstraneni rodice z fronty trojuhelniku na rodeleni a diamondu
     na spojeni. */
-    split_queue->remove(parent);
-    delete merge_queue->remove(parent);
+    master_terrain->split_queue->remove(parent);
+    destroyDiamond(master_terrain->merge_queue->remove(parent));
 
     /* Ziskani potomku rozdelovaneho trojuhelniku. */
-    int child_index = ((parent->triangle - triangle_tree) << 1) + 1;
-    SbROAMTriangle * left_triangle = &triangle_tree[child_index];
-    SbROAMTriangle * right_triangle = &triangle_tree[child_index + 1];
+    SbROAMTriangle left_triangle;
+    SbROAMTriangle right_triangle;
+    triangle_tree->getChildren(parent->triangle, left_triangle, right_triangle);
+    triangle_tree->loadMetric(left_triangle);
+    triangle_tree->loadMetric(right_triangle);
 
     /* Vytvoreni a vraceni potomku.  */
-    left_child = new SbROAMSplitQueueTriangle(left_triangle,
-                                              computePriority(left_triangle));
-    right_child = new SbROAMSplitQueueTriangle(right_triangle,
-                                               computePriority(right_triangle));
+    left_child = createTriangle(left_triangle, computePriority(left_triangle));
+    right_child = createTriangle(right_triangle,
+                                 computePriority(right_triangle));
 
     /* Vlozeni potomku do fronty. */
-    split_queue->add(left_child);
-    split_queue->add(right_child);
+    master_terrain->split_queue->add(left_child);
+    master_terrain->split_queue->add(right_child);
 
     /* Propojeni potomku. */
     left_child->left = right_child;
@@ -545,6 +727,7 @@ void SoSimpleROAMTerrain::simpleSplit(SbROAMSplitQueueTriangle * parent,
     reconnectNeighbour(parent->left, parent, left_child);
     right_child->base = parent->right;
     reconnectNeighbour(parent->right, parent, right_child);
+    triangle_strips.split(parent, left_child, right_child);
 }
 
 void SoSimpleROAMTerrain::forceSplit(SbROAMSplitQueueTriangle * parent,
@@ -562,17 +745,18 @@ void SoSimpleROAMTerrain::forceSplit(SbROAMSplitQueueTriangle * parent,
     SbROAMSplitQueueTriangle * third = NULL;
     SbROAMSplitQueueTriangle * fourth = NULL;
 
-    /* Ma-li rodic bazoveho souseda. */
+    /* Ma-li rodic bazoveho souseda. The neighbour can belong to another
+    patch, which splits it in its own tree. */
     if (parent->base != NULL)
     {
         /* Je-li tento na stejne urovni ve stromu trojuhelniku. */
-        if (parent->triangle->level == parent->base->triangle->level)
+        if (parent->triangle.level == parent->base->triangle.level)
         {
             /* Rozdeli se take bazovy soused. */
             SbROAMSplitQueueTriangle * base = parent->base;
             SbROAMSplitQueueTriangle * left_base = NULL;
             SbROAMSplitQueueTriangle * right_base = NULL;
-            simpleSplit(base, left_base, right_base);
+            base->patch->simpleSplit(base, left_base, right_base);
 
             /* Propojeni diamondu. */
             left_base->right = right_child;
@@ -585,7 +769,7 @@ void SoSimpleROAMTerrain::forceSplit(SbROAMSplitQueueTriangle * parent,
             third = left_base;
             fourth = right_base;
 
-            delete base;
+            destroyTriangle(base);
         }
         else
         {
@@ -593,14 +777,14 @@ void SoSimpleROAMTerrain::forceSplit(SbROAMSplitQueueTriangle * parent,
             SbROAMSplitQueueTriangle * base = parent->base;
             SbROAMSplitQueueTriangle * left_base = NULL;
             SbROAMSplitQueueTriangle * right_base = NULL;
-            forceSplit(base, left_base, right_base);
+            base->patch->forceSplit(base, left_base, right_base);
 
             /* Nalezeni a rozdeleni propojky. */
             SbROAMSplitQueueTriangle * link = left_base->base == parent ? left_base :
                                               right_base;
             SbROAMSplitQueueTriangle * left_link = NULL;
             SbROAMSplitQueueTriangle * right_link = NULL;
-            simpleSplit(link, left_link, right_link);
+            link->patch->simpleSplit(link, left_link, right_link);
 
             /* Propojeni diamondu. */
             left_link->right = right_child;
@@ -613,16 +797,16 @@ void SoSimpleROAMTerrain::forceSplit(SbROAMSplitQueueTriangle * parent,
             third = left_link;
             fourth = right_link;
 
-            delete link;
+            destroyTriangle(link);
         }
     }
 
-    delete parent;
+    destroyTriangle(parent);
 
     /* Priprava reprezentace diamondu v prioritni fronte. */
     float priority = SbMax(first_priority, second_priority);
-    SbROAMMergeQueueDiamond * diamond = new SbROAMMergeQueueDiamond(first, second,
-                                                                    third, fourth, priority);
+    SbROAMMergeQueueDiamond * diamond = createDiamond(first, second, third,
+                                                      fourth, priority);
     first->diamond = diamond;
     second->diamond = diamond;
 
@@ -634,22 +818,24 @@ void SoSimpleROAMTerrain::forceSplit(SbROAMSplitQueueTriangle * parent,
     }
 
     /* Vlozeni diamondu do fronty na rozdeleni. */
-    merge_queue->add(diamond);
+    master_terrain->merge_queue->add(diamond);
 }
 
 void SoSimpleROAMTerrain::halfMerge(SbROAMSplitQueueTriangle * left_child,
                                     SbROAMSplitQueueTriangle * right_child,
                                     SbROAMSplitQueueTriangle *& parent)
 {
-    int parent_index = (left_child->triangle - triangle_tree - 1) / 2;
-    SbROAMTriangle * parent_triangle = &triangle_tree[parent_index];
+    SbROAMTriangle parent_triangle;
+    triangle_tree->getParent(left_child->triangle, parent_triangle);
+    triangle_tree->loadMetric(parent_triangle);
+    int parent_index = parent_triangle.index;
 
     /* Vlozeni otce do fronty na rozdeleni a odstraneni potomku */
-    parent = new SbROAMSplitQueueTriangle(parent_triangle,
-                                          computePriority(parent_triangle));
-    split_queue->remove(left_child);
-    split_queue->remove(right_child);
-    split_queue->add(parent);
+    parent = createTriangle(parent_triangle, computePriority(parent_triangle));
+    master_terrain->split_queue->remove(left_child);
+    master_terrain->split_queue->remove(right_child);
+    master_terrain->split_queue->add(parent);
+    triangle_strips.merge(left_child, right_child, parent);
 
     /* Napojeni otce na sousedy. */
     parent->left = left_child->base;
@@ -658,7 +844,7 @@ void SoSimpleROAMTerrain::halfMerge(SbROAMSplitQueueTriangle * left_child,
     reconnectNeighbour(right_child->base, right_child, parent);
 
     /* Neni-li posledni uroven. */
-    int level = parent_triangle->level;
+    int level = parent_triangle.level;
     if (level > 1)
     {
         /* Sousede a uroven spojeneho trojuhelniku. */
@@ -669,9 +855,9 @@ void SoSimpleROAMTerrain::halfMerge(SbROAMSplitQueueTriangle * left_child,
         if ((left_neighbour != NULL) && (right_neighbour != NULL))
         {
             /* Je-li rodic ze stejne urovne jako jeho nejblizsi sousede. */
-            if ((left_neighbour->triangle->level == level) &&
-                (right_neighbour->triangle->level == level) &&
-                (left_neighbour->left->triangle->level == level))
+            if ((left_neighbour->triangle.level == level) &&
+                (right_neighbour->triangle.level == level) &&
+                (left_neighbour->left->triangle.level == level))
             {
                 /* Ctyri trojuhelniky noveho diamodnu */
                 SbROAMSplitQueueTriangle * first = NULL;
@@ -696,24 +882,26 @@ void SoSimpleROAMTerrain::halfMerge(SbROAMSplitQueueTriangle * left_child,
                 }
 
                 /* Nalezeni otcovskych trojuhelniku. */
-                int left_index = (left_neighbour->triangle - triangle_tree - 1) / 2;
-                int right_index = (right_neighbour->triangle - triangle_tree - 1) / 2;
-                SbROAMTriangle * first_triangle = &triangle_tree[left_index];
-                SbROAMTriangle * second_triangle = &triangle_tree[right_index];
+                SbROAMTriangle first_triangle;
+                SbROAMTriangle second_triangle;
+                triangle_tree->getParent(left_neighbour->triangle, first_triangle);
+                triangle_tree->getParent(right_neighbour->triangle, second_triangle);
+                triangle_tree->loadMetric(first_triangle);
+                triangle_tree->loadMetric(second_triangle);
 
                 /* Vznik noveho diamondu. */
                 float first_priority = computePriority(first_triangle);
                 float second_priority = computePriority(second_triangle);
                 float priority = SbMax(first_priority, second_priority);
                 SbROAMMergeQueueDiamond * new_diamond =
-                        new SbROAMMergeQueueDiamond(first, second, third, fourth, priority);
+                        createDiamond(first, second, third, fourth, priority);
                 first->diamond = new_diamond;
                 second->diamond = new_diamond;
                 third->diamond = new_diamond;
                 fourth->diamond = new_diamond;
 
                 /* Vlozeni diamondu do fronty na rozdeleni. */
-                merge_queue->add(new_diamond);
+                master_terrain->merge_queue->add(new_diamond);
             }
         }
         else
@@ -724,40 +912,42 @@ void SoSimpleROAMTerrain::halfMerge(SbROAMSplitQueueTriangle * left_child,
                 /* Muze-li vzniknout s levym sousedem. */
                 if (left_neighbour != NULL)
                 {
-                    if (left_neighbour->triangle->level == level)
+                    if (left_neighbour->triangle.level == level)
                     {
                         /* Nalezeni otcovskeho trojuhelniku. */
-                        int first_index = (parent_index - 1) / 2;
-                        SbROAMTriangle * first_triangle = &triangle_tree[first_index];
+                        SbROAMTriangle first_triangle;
+                        triangle_tree->getParent(parent_triangle, first_triangle);
+                        triangle_tree->loadMetric(first_triangle);
 
                         /* Vznik noveho diamondu. */
                         SbROAMMergeQueueDiamond * new_diamond =
-                                new SbROAMMergeQueueDiamond(parent, left_neighbour, NULL, NULL,
-                                                            computePriority(first_triangle));
+                                createDiamond(parent, left_neighbour, NULL, NULL,
+                                              computePriority(first_triangle));
                         parent->diamond = new_diamond;
                         left_neighbour->diamond = new_diamond;
 
                         /* Vlozeni diamondu do fronty na rozdeleni. */
-                        merge_queue->add(new_diamond);
+                        master_terrain->merge_queue->add(new_diamond);
                     }
                 }
                 else // muze vzniknout s pravym sousedem
                 {
-                    if (right_neighbour->triangle->level == level)
+                    if (right_neighbour->triangle.level == level)
                     {
                         /* Nalezeni otcovskeho trojuhelniku. */
-                        int first_index = (parent_index - 1) / 2;
-                        SbROAMTriangle * first_triangle = &triangle_tree[first_index];
+                        SbROAMTriangle first_triangle;
+                        triangle_tree->getParent(parent_triangle, first_triangle);
+                        triangle_tree->loadMetric(first_triangle);
 
                         /* Vznik noveho diamondu. */
                         SbROAMMergeQueueDiamond * new_diamond =
-                                new SbROAMMergeQueueDiamond(right_neighbour, parent, NULL, NULL,
-                                                            computePriority(first_triangle));
+                                createDiamond(right_neighbour, parent, NULL, NULL,
+                                              computePriority(first_triangle));
                         right_neighbour->diamond = new_diamond;
                         parent->diamond = new_diamond;
 
                         /* Vlozeni diamondu do fronty na rozdeleni. */
-                        merge_queue->add(new_diamond);
+                        master_terrain->merge_queue->add(new_diamond);
                     }
                 }
             }
@@ -771,74 +961,819 @@ void SoSimpleROAMTerrain::merge(SbROAMMergeQueueDiamond * diamond)
     SbROAMSplitQueueTriangle * first_parent = NULL;
     SbROAMSplitQueueTriangle * second_parent = NULL;
 
-    /* Spojeni prvni poloviny diamondu */
-    halfMerge(diamond->first, diamond->second, first_parent);
+    /* Spojeni prvni poloviny diamondu. Halves of a diamond on a seam
+    belong to different patches. */
+    diamond->first->patch->halfMerge(diamond->first, diamond->second,
+                                     first_parent);
 
     /* Uvolneni potomku z pameti. */
-    delete diamond->first;
-    delete diamond->second;
+    destroyTriangle(diamond->first);
+    destroyTriangle(diamond->second);
 
     /* Neni-li diamond degradovany. */
     if (diamond->third != NULL)
     {
         /* Spojeni druhe poloviny diamondu a propojeni polovin. */
-        halfMerge(diamond->third, diamond->fourth, second_parent);
+        diamond->third->patch->halfMerge(diamond->third, diamond->fourth,
+                                         second_parent);
         second_parent->base = first_parent;
         first_parent->base = second_parent;
 
         /* Uvolneni potomku z pameti. */
-        delete diamond->third;
-        delete diamond->fourth;
+        destroyTriangle(diamond->third);
+        destroyTriangle(diamond->fourth);
     }
 
     /* Odstraneni stareho diamondu. */
     merge_queue->remove(diamond);
-    delete diamond;
+    destroyDiamond(diamond);
+}
+
+void SoSimpleROAMTerrain::changeQueues()
+{
+    /* New queues of the requested type. */
+    SbROAMSplitQueue * new_split_queue = SbROAMSplitQueue::create(
+        static_cast<SbROAMSplitQueue::Type>(queue_type));
+    SbROAMMergeQueue * new_merge_queue = SbROAMMergeQueue::create(
+        static_cast<SbROAMMergeQueue::Type>(queue_type));
+
+    /* Move the triangles and diamonds of the current triangulation, their
+    links stay untouched. */
+    for (int I = 1; I <= split_queue->size(); ++I)
+    {
+        new_split_queue->add((*split_queue)[I]);
+    }
+    for (int I = 1; I <= merge_queue->size(); ++I)
+    {
+        new_merge_queue->add((*merge_queue)[I]);
+    }
+
+    /* Release the old queues. */
+    delete split_queue;
+    delete merge_queue;
+    split_queue = new_split_queue;
+    merge_queue = new_merge_queue;
+}
+
+void SoSimpleROAMTerrain::addPatch(SoSimpleROAMTerrain * patch)
+{
+    /* Triangles of the other patches do not have the new patch as their
+    neighbour, all patches start again from their roots. */
+    SbThreadAutoLock lock(&refinement_mutex);
+    patches.append(patch);
+    is_reset = TRUE;
+}
+
+void SoSimpleROAMTerrain::removePatch(SoSimpleROAMTerrain * patch)
+{
+    /* Triangles of the removed patch stay in the queues until the next
+    refinement releases them. */
+    SbThreadAutoLock lock(&refinement_mutex);
+    int index = patches.find(patch);
+    if (index >= 0)
+    {
+        patches.remove(index);
+    }
+    is_reset = TRUE;
 }
 
-void SoSimpleROAMTerrain::mapSizeChangedCB(void * _instance,
-                                           SoSensor * sensor)
+void SoSimpleROAMTerrain::resetTriangulation()
+{
+    /* All triangles and diamonds are released at once, a removed patch
+    could not release its own ones. */
+    split_queue->emptyQueue();
+    merge_queue->emptyQueue();
+    recompute_queue.emptyQueue();
+    triangle_pool.clear();
+    diamond_pool.clear();
+
+    /* Two roots of every patch. */
+    SbList<SbROAMSplitQueueTriangle *> roots;
+    for (int I = 0; I < patches.getLength(); ++I)
+    {
+        SbROAMSplitQueueTriangle * root_1 = NULL;
+        SbROAMSplitQueueTriangle * root_2 = NULL;
+        patches[I]->createRoots(root_1, root_2);
+        roots.append(root_1);
+        roots.append(root_2);
+    }
+
+    /* The first root lies along the first row and the last column of the
+    height map, the second one along the last row and the first column.
+    Roots on a common edge of neighbouring patches are linked, so splits
+    continue across the edge and the seam has no cracks. */
+    for (int I = 0; I < patches.getLength(); ++I)
+    {
+        for (int J = 0; J < patches.getLength(); ++J)
+        {
+            if (patches[I]->level != patches[J]->level)
+            {
+                continue;
+            }
+            int column = patches[J]->patch_position[0] -
+                         patches[I]->patch_position[0];
+            int row = patches[J]->patch_position[1] -
+                      patches[I]->patch_position[1];
+            if ((column == 1) && (row == 0))
+            {
+                roots[2 * I]->right = roots[(2 * J) + 1];
+                roots[(2 * J) + 1]->right = roots[2 * I];
+            }
+            else if ((column == 0) && (row == 1))
+            {
+                roots[(2 * I) + 1]->left = roots[2 * J];
+                roots[2 * J]->left = roots[(2 * I) + 1];
+            }
+        }
+    }
+    is_reset = FALSE;
+    is_recompute_all = TRUE;
+}
+
+void SoSimpleROAMTerrain::createRoots(SbROAMSplitQueueTriangle *& root_1,
+                                      SbROAMSplitQueueTriangle *& root_2)
+{
+    SbROAMTriangle triangle_1;
+    SbROAMTriangle triangle_2;
+    triangle_tree->getRoot(1, triangle_1);
+    triangle_tree->getRoot(2, triangle_2);
+
+    /* Dva koreny binarniho stromu trojuhelniku. */
+    triangle_tree->loadMetric(triangle_1);
+    triangle_tree->loadMetric(triangle_2);
+
+    patch_triangle_count = 0;
+    root_1 = createTriangle(triangle_1, computePriority(triangle_1));
+    root_2 = createTriangle(triangle_2, computePriority(triangle_2));
+
+    /* Jejich vzajemne propojeni. */
+    root_1->base = root_2;
+    root_2->base = root_1;
+
+    /* Vlozeni korenu do fronty trojuhelniku. */
+    master_terrain->split_queue->add(root_1);
+    master_terrain->split_queue->add(root_2);
+    triangle_strips.create(level, root_1, root_2);
+}
+
+void SoSimpleROAMTerrain::recomputePriorities(const SbROAMCamera & camera)
+{
+    /* Aktualizace lambdy a pohledoveho telesa pro aktualni okno. */
+    float old_lambda = lambda;
+    lambda = camera.lambda;
+    for (int I = 0; I < 6; ++I)
+    {
+        planes[I] = camera.planes[I];
+    }
+
+    /* Change of the queue backend. */
+    if (split_queue->getType() != queue_type)
+    {
+        changeQueues();
+    }
+
+    /* Culling flags of the top levels for the current view volume. */
+    if (is_frustum_culling)
+    {
+        updateCullFlags();
+    }
+
+    /* Other patches compute priorities of their new triangles and cull by
+    their own tables with the same camera. */
+    for (int I = 0; I < patches.getLength(); ++I)
+    {
+        SoSimpleROAMTerrain * patch = patches[I];
+        if (patch != this)
+        {
+            patch->lambda = lambda;
+            for (int J = 0; J < 6; ++J)
+            {
+                patch->planes[J] = planes[J];
+            }
+            patch->camera_position = camera.position;
+            patch->error_metric = error_metric;
+            if (patch->is_frustum_culling)
+            {
+                patch->updateCullFlags();
+            }
+        }
+    }
+
+    /* All priorities are recomputed if the deferred recomputation is
+    disabled, the camera moved faster than allowed or the projection
+    changed. Otherwise only the scheduled ones are recomputed. The delays
+    bound only the isotropic priority, the wedgie one changes also with the
+    direction of the view. */
+    SbVec3f old_camera_position = camera_position;
+    camera_position = camera.position;
+    if ((max_camera_speed <= 0.0f) || is_recompute_all ||
+        (error_metric != ISOTROPIC) ||
+        (lambda != old_lambda) ||
+        ((camera_position - old_camera_position).length() >
+         max_camera_speed))
+    {
+        recomputeAll();
+    }
+    else
+    {
+        recomputeScheduled();
+    }
+    is_recompute_all = FALSE;
+}
+
+void SoSimpleROAMTerrain::refine()
+{
+    /* Smycka generovani triangulace pro konstantni pocet trojuhelniku.
+    With a time budget the loop is interrupted after the budget runs out
+    and continues from the current triangulation in the next frame. */
+    SbTime start_time = SbTime::getTimeOfDay();
+    SbBool is_converged = FALSE;
+    int step = 0;
+    while (TRUE)
+    {
+        if ((refinement_budget > 0.0) &&
+            ((++step % BUDGET_CHECK_STEPS) == 0) &&
+            ((SbTime::getTimeOfDay() - start_time).getValue() >=
+             refinement_budget))
+        {
+            break;
+        }
+        if ((split_queue->size() > triangle_count) ||
+            (split_queue->getMax()->getPriority() < pixel_error))
+        {
+            if (merge_queue->size() > 0)
+            {
+                /* Bucketed queues do not order items of one bucket, their
+                priorities are compared by buckets, otherwise two items of
+                one bucket could be split and merged forever. */
+                float split_priority = split_queue->getMax()->getPriority();
+                float merge_priority = merge_queue->getMin()->getPriority();
+                if ((split_queue->getType() == SbROAMSplitQueue::BUCKETS) ?
+                    (SbROAMBucketQueue::getBucket(split_priority) <=
+                     SbROAMBucketQueue::getBucket(merge_priority)) :
+                    (split_priority <= merge_priority))
+                {
+                    is_converged = TRUE;
+                    break;
+                }
+                else
+                {
+                    merge(merge_queue->getMin());
+                }
+            }
+            else
+            {
+                is_converged = TRUE;
+                break;
+            }
+        }
+        else
+        {
+            /* Ziskani a rozdeleni trojuhelniku. */
+            SbROAMSplitQueueTriangle * parent = split_queue->getMax();
+            if (parent->triangle.level == parent->patch->level)
+            {
+                parent->setPriority(split_queue, PRIORITY_MIN);
+            }
+            else
+            {
+                SbROAMSplitQueueTriangle * left_child = NULL;
+                SbROAMSplitQueueTriangle * right_child = NULL;
+                parent->patch->forceSplit(parent, left_child, right_child);
+            }
+        }
+    }
+
+    /* Split/merge threshold for the deferred recomputation, an
+    interrupted refinement keeps the threshold of the last converged
+    one. */
+    if (is_converged)
+    {
+        threshold = SbMax(static_cast<float>(pixel_error),
+                          split_queue->getMax()->getPriority());
+    }
+}
+
+void SoSimpleROAMTerrain::refineFrame(const SbROAMCamera & camera)
+{
+    /* Added or removed patches start a new triangulation. */
+    if (is_reset)
+    {
+        resetTriangulation();
+    }
+    if (isSplitOnly())
+    {
+        /* The triangulation of the frame is built from the roots. */
+        if (!is_freeze)
+        {
+            PR_START_PROFILE(refinement);
+            refineSplitOnly(camera, *front_indices);
+            PR_STOP_PROFILE(refinement);
+        }
+    }
+    else
+    {
+        if (!is_freeze && (split_queue->size() > 0))
+        {
+            PR_START_PROFILE(priorities);
+            recomputePriorities(camera);
+            PR_STOP_PROFILE(priorities);
+            PR_START_PROFILE(refinement);
+            refine();
+            PR_STOP_PROFILE(refinement);
+        }
+        for (int I = 0; I < patches.getLength(); ++I)
+        {
+            patches[I]->updateIndices(*patches[I]->front_indices);
+        }
+    }
+    ++refinement_count;
+}
+
+void SoSimpleROAMTerrain::computeCamera(SbROAMCamera & camera) const
+{
+    camera.position = view_volume->getProjectionPoint();
+    view_volume->getViewVolumePlanes(camera.planes);
+    camera.lambda = (view_volume->getNearDist() *
+                     viewport_region->getViewportSizePixels()[1]) /
+                    (view_volume->getHeight());
+}
+
+void SoSimpleROAMTerrain::startRefinementThread()
+{
+    /* The thread starts with the triangulation of the last frame. */
+    is_snapshot = FALSE;
+    is_published = FALSE;
+    is_exit_refinement = FALSE;
+    refinement_thread = SbThread::create(refinementThreadMain, this);
+}
+
+void SoSimpleROAMTerrain::stopRefinementThread()
+{
+    /* Wake up of the thread with the exit flag. */
+    snapshot_mutex.lock();
+    is_exit_refinement = TRUE;
+    snapshot_cond.wakeOne();
+    snapshot_mutex.unlock();
+    refinement_thread->join();
+    SbThread::destroy(refinement_thread);
+    refinement_thread = NULL;
+
+    /* Indices are rebuilt from the current triangulation in the next
+    frame, arrays published for patches are not drawn. */
+    is_indices_dirty = TRUE;
+    for (int I = 0; I < patches.getLength(); ++I)
+    {
+        patches[I]->is_indices_dirty = TRUE;
+        patches[I]->is_published = FALSE;
+    }
+}
+
+void * SoSimpleROAMTerrain::refinementThreadMain(void * _instance)
+{
+    SoSimpleROAMTerrain * instance =
+            reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
+    instance->snapshot_mutex.lock();
+    while (TRUE)
+    {
+        /* Waiting for a new camera. */
+        while (!instance->is_snapshot && !instance->is_exit_refinement)
+        {
+            instance->snapshot_cond.wait(instance->snapshot_mutex);
+        }
+        if (instance->is_exit_refinement)
+        {
+            break;
+        }
+        SbROAMCamera camera = instance->snapshot;
+        instance->is_snapshot = FALSE;
+        instance->snapshot_mutex.unlock();
+
+        /* Refinement against the camera snapshot, field callbacks wait for
+        its end. */
+        instance->refinement_mutex.lock();
+        if (instance->is_reset)
+        {
+            instance->resetTriangulation();
+        }
+        if (instance->isSplitOnly())
+        {
+            if (!instance->is_freeze)
+            {
+                instance->refineSplitOnly(camera, *instance->back_indices);
+                instance->publishIndices();
+            }
+        }
+        else
+        {
+            if (!instance->is_freeze && (instance->split_queue->size() > 0))
+            {
+                instance->recomputePriorities(camera);
+                instance->refine();
+            }
+
+            /* Publication of the new triangulation of every patch. */
+            for (int I = 0; I < instance->patches.getLength(); ++I)
+            {
+                SoSimpleROAMTerrain * patch = instance->patches[I];
+                if (patch->updateIndices(*patch->back_indices))
+                {
+                    patch->publishIndices();
+                }
+            }
+        }
+        instance->refinement_mutex.unlock();
+        instance->snapshot_mutex.lock();
+    }
+    instance->snapshot_mutex.unlock();
+    return NULL;
+}
+
+SbBool SoSimpleROAMTerrain::updateIndices(SbList<GLuint> & indices)
+{
+    if (!is_indices_dirty)
+    {
+        return FALSE;
+    }
+    is_indices_dirty = FALSE;
+
+    /* Changed strips are rebuilt, the others are copied. */
+    triangle_strips.update(indices);
+    index_triangle_counts[&indices - index_buffers] = patch_triangle_count;
+    return TRUE;
+}
+
+void SoSimpleROAMTerrain::publishIndices()
+{
+    /* The filled array replaces the published one, even if it was not
+    drawn yet. */
+    SbThreadAutoLock lock(&snapshot_mutex);
+    SbList<GLuint> * published_indices = ready_indices;
+    ready_indices = back_indices;
+    back_indices = published_indices;
+    is_published = TRUE;
+}
+
+inline SbBool SoSimpleROAMTerrain::isSplitOnly() const
+{
+    /* Seams between patches are kept only by the shared queues. */
+    return (refinement_mode == SPLIT_ONLY) && (patches.getLength() <= 1);
+}
+
+void SoSimpleROAMTerrain::refineSplitOnly(const SbROAMCamera & camera,
+                                          SbList<GLuint> & indices)
+{
+    /* Projection and view volume of the current frame. */
+    lambda = camera.lambda;
+    camera_position = camera.position;
+    for (int I = 0; I < 6; ++I)
+    {
+        planes[I] = camera.planes[I];
+    }
+
+    /* The diamond metric, the tasks and their threads are created by the
+    first split-only refinement. */
+    if (diamond_tree == NULL)
+    {
+        diamond_tree = new SbROAMDiamondTree(coords, map_size);
+        diamond_tree->build();
+    }
+    if (task_pool == NULL)
+    {
+        task_pool = new SbTaskPool(thread_count);
+    }
+    if (split_tasks == NULL)
+    {
+        split_tasks = new SbROAMSplitTask[(1 << (SPLIT_TASK_LEVEL + 1)) - 2];
+    }
+
+    /* Subtrees are traversed in parallel, the tasks are collected in the
+    order of the curve, which passes the first root before the second
+    one. */
+    split_threshold = SbMax(split_threshold, static_cast<float>(pixel_error));
+    split_task_count = 0;
+    for (int I = 1; I <= 2; ++I)
+    {
+        SbROAMTriangle root;
+        triangle_tree->getRoot(I, root);
+        collectSplitTasks(root, 0);
+    }
+    for (int I = 0; I < split_task_count; ++I)
+    {
+        task_pool->addTask(splitTask, &split_tasks[I]);
+    }
+    task_pool->waitAll();
+
+    /* Strips of the subtrees are joined to one strip. */
+    indices.truncate(0);
+    int count = 0;
+    for (int I = 0; I < split_task_count; ++I)
+    {
+        SbROAMTriangleStrips::appendStrip(indices, split_tasks[I].indices);
+        count += split_tasks[I].count;
+    }
+    index_triangle_counts[&indices - index_buffers] = count;
+
+    /* Without a queue the triangle budget is kept by the threshold of the
+    next frame. The number of triangles falls roughly with the square of
+    the threshold, so an exceeded budget is corrected at once. The threshold
+    is lowered only by one step and only if roughly the square of the step
+    more triangles fit into the budget. */
+    if (count > triangle_count)
+    {
+        split_threshold *= SbMax(SPLIT_THRESHOLD_STEP, static_cast<float>(
+                                 sqrt(static_cast<double>(count) /
+                                      triangle_count)));
+    }
+    else if ((count * SPLIT_THRESHOLD_STEP * SPLIT_THRESHOLD_STEP) <
+             triangle_count)
+    {
+        split_threshold = SbMax(split_threshold / SPLIT_THRESHOLD_STEP,
+                                static_cast<float>(pixel_error));
+    }
+}
+
+inline SbBool SoSimpleROAMTerrain::isSplit(const SbROAMTriangle & triangle,
+                                           int & flags) const
+{
+    if (triangle.level >= level)
+    {
+        return FALSE;
+    }
+
+    /* Both triangles of the diamond share the middle of the hypotenuse. */
+    int center = (triangle.first + triangle.second) >> 1;
+    const SbROAMDiamond & diamond = (*diamond_tree)[center];
+    const SbVec3f & point = coords[center];
+    float distance = (camera_position - point).length();
+
+    /* Diamonds close to the camera are always split. */
+    if (distance < diamond.radius)
+    {
+        return TRUE;
+    }
+
+    /* Children of diamonds outside of the view volume are not visible. */
+    if (is_frustum_culling)
+    {
+        flags = computeCullFlags(point, diamond.radius, flags);
+        if (flags & CULL_OUT)
+        {
+            return FALSE;
+        }
+    }
+    return (lambda * diamond.error) >
+           (split_threshold * (distance - diamond.radius));
+}
+
+void SoSimpleROAMTerrain::collectSplitTasks(const SbROAMTriangle & triangle,
+                                            int flags)
+{
+    /* Triangles above the task level are split here, the others are roots
+    of the tasks. */
+    int task_flags = flags;
+    if ((triangle.level < SPLIT_TASK_LEVEL) && isSplit(triangle, flags))
+    {
+        SbROAMTriangle left_child;
+        SbROAMTriangle right_child;
+        triangle_tree->getChildren(triangle, left_child, right_child);
+        if (triangle.level & 1)
+        {
+            collectSplitTasks(left_child, flags);
+            collectSplitTasks(right_child, flags);
+        }
+        else
+        {
+            collectSplitTasks(right_child, flags);
+            collectSplitTasks(left_child, flags);
+        }
+    }
+    else
+    {
+        SbROAMSplitTask & task = split_tasks[split_task_count++];
+        task.terrain = this;
+        task.root = triangle;
+        task.flags = task_flags;
+    }
+}
+
+void SoSimpleROAMTerrain::traverseSplitOnly(SbROAMSplitTask & task,
+                                            const SbROAMTriangle & triangle,
+                                            int flags) const
+{
+    if (isSplit(triangle, flags))
+    {
+        /* The curve enters triangles of odd levels through their left
+        child. */
+        SbROAMTriangle left_child;
+        SbROAMTriangle right_child;
+        triangle_tree->getChildren(triangle, left_child, right_child);
+        if (triangle.level & 1)
+        {
+            traverseSplitOnly(task, left_child, flags);
+            traverseSplitOnly(task, right_child, flags);
+        }
+        else
+        {
+            traverseSplitOnly(task, right_child, flags);
+            traverseSplitOnly(task, left_child, flags);
+        }
+    }
+    else
+    {
+        /* A leaf is appended when its successor is known. */
+        if (task.is_pending)
+        {
+            SbROAMTriangleStrips::appendTriangle(task.indices, task.pending,
+                                                 &triangle);
+        }
+        task.pending = triangle;
+        task.is_pending = TRUE;
+        ++task.count;
+    }
+}
+
+void SoSimpleROAMTerrain::splitTask(void * _task)
+{
+    SbROAMSplitTask * task = reinterpret_cast<SbROAMSplitTask *>(_task);
+    task->indices.truncate(0);
+    task->is_pending = FALSE;
+    task->count = 0;
+    task->terrain->traverseSplitOnly(*task, task->root, task->flags);
+
+    /* The last leaf ends the strip of the subtree. */
+    if (task->is_pending)
+    {
+        SbROAMTriangleStrips::appendTriangle(task->indices, task->pending,
+                                             NULL);
+    }
+}
+
+void SoSimpleROAMTerrain::updatePixelError()
+{
+    SbThreadAutoLock lock(&refinement_mutex);
+    pixel_error = pixelError.getValue();
+    is_recompute_all = TRUE;
+}
+
+void SoSimpleROAMTerrain::updateTriangleCount()
+{
+    SbThreadAutoLock lock(&refinement_mutex);
+    triangle_count = triangleCount.getValue();
+    is_recompute_all = TRUE;
+}
+
+void SoSimpleROAMTerrain::updateFrustumCulling()
+{
+    /* Culling of a patch changes priorities in the queues of its
+    master. */
+    SbThreadAutoLock lock(&master_terrain->refinement_mutex);
+    is_frustum_culling = frustumCulling.getValue();
+    master_terrain->is_recompute_all = TRUE;
+}
+
+void SoSimpleROAMTerrain::updateFreeze()
+{
+    SbThreadAutoLock lock(&refinement_mutex);
+    is_freeze = freeze.getValue();
+}
+
+void SoSimpleROAMTerrain::culledLevelsChangedCB(void * _instance,
+                                                SoSensor * sensor)
 {
     /* Aktualizace vnitrni hodnoty pole. */
     SoSimpleROAMTerrain * instance =
             reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
-    instance->map_size = instance->mapSize.getValue();
+    instance->culled_levels = instance->culledLevels.getValue();
 }
 
-void SoSimpleROAMTerrain::pixelErrorChangedCB(void * _instance,
-                                              SoSensor * sensor)
+void SoSimpleROAMTerrain::queueTypeChangedCB(void * _instance,
+                                             SoSensor * sensor)
 {
     /* Aktualizace vnitrni hodnoty pole. */
     SoSimpleROAMTerrain * instance =
             reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
-    instance->pixel_error = instance->pixelError.getValue();
+    SbThreadAutoLock lock(&instance->refinement_mutex);
+    instance->queue_type = instance->queueType.getValue();
 }
 
-void SoSimpleROAMTerrain::triangleCountChangedCB(void * _instance,
-                                                 SoSensor * sensor)
+void SoSimpleROAMTerrain::maxCameraSpeedChangedCB(void * _instance,
+                                                  SoSensor * sensor)
+{
+    /* Aktualizace vnitrni hodnoty pole. */
+    SoSimpleROAMTerrain * instance =
+            reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
+    SbThreadAutoLock lock(&instance->refinement_mutex);
+    instance->max_camera_speed = instance->maxCameraSpeed.getValue();
+    instance->is_recompute_all = TRUE;
+}
+
+void SoSimpleROAMTerrain::threadCountChangedCB(void * _instance,
+                                               SoSensor * sensor)
 {
     /* Aktualizace vnitrni hodnoty pole. */
     SoSimpleROAMTerrain * instance =
             reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
-    instance->triangle_count = instance->triangleCount.getValue();
+    SbThreadAutoLock lock(&instance->refinement_mutex);
+    instance->thread_count = instance->threadCount.getValue();
+
+    /* Threads of the split-only refinement are created again by its next
+    run. */
+    delete instance->task_pool;
+    instance->task_pool = NULL;
 }
 
-void SoSimpleROAMTerrain::frustumCullingChangedCB(void * _instance,
+void SoSimpleROAMTerrain::cacheDirectoryChangedCB(void * _instance,
                                                   SoSensor * sensor)
 {
     /* Aktualizace vnitrni hodnoty pole. */
     SoSimpleROAMTerrain * instance =
             reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
-    instance->is_frustum_culling = instance->frustumCulling.getValue();
+    instance->cache_directory = instance->cacheDirectory.getValue();
+}
+
+void SoSimpleROAMTerrain::refinementBudgetChangedCB(void * _instance,
+                                                    SoSensor * sensor)
+{
+    /* Aktualizace vnitrni hodnoty pole. */
+    SoSimpleROAMTerrain * instance =
+            reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
+    SbThreadAutoLock lock(&instance->refinement_mutex);
+    instance->refinement_budget = instance->refinementBudget.getValue() *
+                                  1.0e-6;
 }
 
-void SoSimpleROAMTerrain::freezeChangedCB(void * _instance,
+void SoSimpleROAMTerrain::asyncRefinementChangedCB(void * _instance,
+                                                   SoSensor * sensor)
+{
+    /* Aktualizace vnitrni hodnoty pole. */
+    SoSimpleROAMTerrain * instance =
+            reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
+    instance->is_async_refinement = instance->asyncRefinement.getValue();
+}
+
+void SoSimpleROAMTerrain::errorMetricChangedCB(void * _instance,
+                                               SoSensor * sensor)
+{
+    /* Aktualizace vnitrni hodnoty pole. */
+    SoSimpleROAMTerrain * instance =
+            reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
+    SbThreadAutoLock lock(&instance->refinement_mutex);
+    instance->error_metric = instance->errorMetric.getValue();
+    instance->priority_batch.setMetric(
+        static_cast<SbROAMPriorityBatch::Metric>(instance->error_metric));
+    instance->is_recompute_all = TRUE;
+}
+
+void SoSimpleROAMTerrain::masterChangedCB(void * _instance,
                                           SoSensor * sensor)
 {
     /* Aktualizace vnitrni hodnoty pole. */
     SoSimpleROAMTerrain * instance =
             reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
-    instance->is_freeze = instance->freeze.getValue();
+    SoNode * node = instance->master.getValue();
+    SoSimpleROAMTerrain * master_terrain = ((node != NULL) &&
+        node->isOfType(SoSimpleROAMTerrain::getClassTypeId())) ?
+        static_cast<SoSimpleROAMTerrain *>(node) : instance;
+
+    /* The sensor is triggered by changes of the master too. A new master
+    adds the patch in its next rendering. */
+    if (master_terrain != instance->master_terrain)
+    {
+        if (instance->is_registered)
+        {
+            instance->master_terrain->removePatch(instance);
+            instance->is_registered = FALSE;
+        }
+        instance->master_terrain = master_terrain;
+    }
+}
+
+void SoSimpleROAMTerrain::patchPositionChangedCB(void * _instance,
+                                                 SoSensor * sensor)
+{
+    /* Aktualizace vnitrni hodnoty pole. */
+    SoSimpleROAMTerrain * instance =
+            reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
+    SoSimpleROAMTerrain * master_terrain = instance->master_terrain;
+    SbThreadAutoLock lock(&master_terrain->refinement_mutex);
+    instance->patch_position = instance->patchPosition.getValue();
+    master_terrain->is_reset = TRUE;
+}
+
+void SoSimpleROAMTerrain::refinementModeChangedCB(void * _instance,
+                                                  SoSensor * sensor)
+{
+    /* Aktualizace vnitrni hodnoty pole. */
+    SoSimpleROAMTerrain * instance =
+            reinterpret_cast<SoSimpleROAMTerrain *>(_instance);
+    SbThreadAutoLock lock(&instance->refinement_mutex);
+    instance->refinement_mode = instance->refinementMode.getValue();
+
+    /* The incremental triangulation is drawn again after the next
+    refinement with all priorities recomputed. */
+    instance->is_indices_dirty = TRUE;
+    instance->is_recompute_all = TRUE;
 }
 
 /******************************************************************************
@@ -847,22 +1782,38 @@ void SoSimpleROAMTerrain::freezeChangedCB(void * _instance,
 
 SoSimpleROAMTerrain::~SoSimpleROAMTerrain()
 {
-    /* Uvolneni internich struktur. */
-    delete[] triangle_tree;
-    for (int I = 1; I <= split_queue->size(); ++I)
+    /* The refinement thread uses all internal structures. */
+    if (refinement_thread != NULL)
     {
-        delete (*split_queue)[I];
-
+        stopRefinementThread();
     }
-    delete split_queue;
-    for (int J = 1; J <= merge_queue->size(); ++J)
+
+    /* Triangles of the patch are released by the next refinement of its
+    master. */
+    if (is_registered)
     {
-        delete (*merge_queue)[J];
+        master_terrain->removePatch(this);
     }
+
+    /* Uvolneni internich struktur. Trojuhelniky a diamondy ve frontach
+    uvolni jejich pooly. */
+    delete triangle_tree;
+    delete[] cull_spheres;
+    delete[] cull_flags;
+    delete diamond_tree;
+    delete task_pool;
+    delete[] split_tasks;
+    delete split_queue;
     delete merge_queue;
-    delete map_size_sensor;
-    delete pixel_error_sensor;
-    delete triangle_count_sensor;
-    delete frustum_culling_sensor;
-    delete freeze_sensor;
+    delete culled_levels_sensor;
+    delete queue_type_sensor;
+    delete max_camera_speed_sensor;
+    delete thread_count_sensor;
+    delete cache_directory_sensor;
+    delete refinement_budget_sensor;
+    delete async_refinement_sensor;
+    delete error_metric_sensor;
+    delete master_sensor;
+    delete patch_position_sensor;
+    delete refinement_mode_sensor;
 }